@@ -240,6 +240,7 @@ void checkReboot() {
                     tft.fillScreen(bruceConfig.bgColor);
                     while (digitalRead(UP_BTN) == BTN_ACT || digitalRead(DW_BTN) == BTN_ACT);
                     delay(200);
+                    bruceConfig.commit();
                     powerOff();
                 }
                 delay(10);
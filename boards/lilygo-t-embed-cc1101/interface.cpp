@@ -104,8 +104,10 @@ void _setup_gpio() {
 
 #ifdef T_EMBED_1101
     pinMode(BK_BTN, INPUT);
+    inputAttachInterrupt(BK_BTN);
 #endif
     pinMode(ENCODER_KEY, INPUT);
+    inputAttachInterrupt(ENCODER_KEY);
     // use TWO03 mode when PIN_IN1, PIN_IN2 signals are both LOW or HIGH in latch position.
     encoder = new RotaryEncoder(ENCODER_INA, ENCODER_INB, RotaryEncoder::LatchMode::TWO03);
 
@@ -162,6 +164,7 @@ void _setBrightness(uint8_t brightval) {
 RotaryEncoder *encoder = nullptr;
 IRAM_ATTR void checkPosition() {
     encoder->tick(); // just call tick() to check the state.
+    inputNotifyFromISR();
 }
 
 /*********************************************************************
@@ -259,6 +262,7 @@ void checkReboot() {
                     tft.fillScreen(bruceConfig.bgColor);
                     while (digitalRead(BK_BTN) == BTN_ACT);
                     delay(200);
+                    bruceConfig.commit();
                     powerDownNFC();
                     powerDownCC1101();
                     tft.sleep(true);
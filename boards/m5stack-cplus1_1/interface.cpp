@@ -64,9 +64,15 @@ void checkReboot() {
     /* Long press power off */
     if (axp192.GetBtnPress()) {
         uint32_t time_count = millis();
+        bool committed = false;
         while (axp192.GetBtnPress()) {
             // Display poweroff bar only if holding button
             if (millis() - time_count > 500) {
+                // the power management cuts the power if the button is held, flush the config first
+                if (!committed) {
+                    bruceConfig.commit();
+                    committed = true;
+                }
                 tft.setCursor(60, 12);
                 tft.setTextSize(1);
                 tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
@@ -1,3 +1,4 @@
+#include "core/input_events.h"
 #include "core/powerSave.h"
 #include <driver/adc.h>
 #include <esp_adc_cal.h>
@@ -14,6 +15,9 @@ void _setup_gpio() {
     pinMode(UP_BTN, INPUT); // Sets the power btn as an INPUT
     pinMode(SEL_BTN, INPUT);
     pinMode(DW_BTN, INPUT);
+    inputAttachInterrupt(UP_BTN);
+    inputAttachInterrupt(SEL_BTN);
+    inputAttachInterrupt(DW_BTN);
     pinMode(4, OUTPUT);    // Keeps the Stick alive after take off the USB cable
     digitalWrite(4, HIGH); // Keeps the Stick alive after take off the USB cable
     gpio_pulldown_dis(GPIO_NUM_36);
@@ -112,9 +116,15 @@ void checkReboot() {
     /* Long press power off */
     if (digitalRead(UP_BTN) == LOW) {
         uint32_t time_count = millis();
+        bool committed = false;
         while (digitalRead(UP_BTN) == LOW) {
             // Display poweroff bar only if holding button
             if (millis() - time_count > 500) {
+                // the power management cuts the power if the button is held, flush the config first
+                if (!committed) {
+                    bruceConfig.commit();
+                    committed = true;
+                }
                 tft.setCursor(60, 12);
                 tft.setTextSize(1);
                 tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
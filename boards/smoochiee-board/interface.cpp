@@ -149,6 +149,7 @@ void checkReboot() {
                     tft.fillScreen(bruceConfig.bgColor);
                     while (digitalRead(L_BTN) == BTN_ACT || digitalRead(R_BTN) == BTN_ACT);
                     delay(200);
+                    bruceConfig.commit();
                     powerOff();
                 }
                 delay(10);
@@ -9,6 +9,7 @@
 
 #include "core/config.h"
 #include "core/configPins.h"
+#include "core/input_events.h"
 #include "core/serial_commands/cli.h"
 #include "core/startup_app.h"
 #include <Arduino.h>
@@ -206,14 +207,7 @@ extern TaskHandle_t xHandle;
 extern inline bool check(volatile bool &btn) {
 
 #ifndef USE_TFT_eSPI_TOUCH
-    if (!btn) return false;
-    vTaskSuspend(xHandle);
-    btn = false;
-    AnyKeyPress = false;
-    SerialCmdPress = false;
-    delay(10);
-    vTaskResume(xHandle);
-    return true;
+    return inputConsume(btn);
 #else
 
     InputHandler();
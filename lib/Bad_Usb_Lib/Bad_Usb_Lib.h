@@ -19,5 +19,8 @@ public:
     virtual void releaseAll(void) {};
     virtual bool isConnected() { return false; };
     virtual void setLayout(const uint8_t *layout) {};
+    virtual const uint8_t *getLayout() { return nullptr; };
+    // Sends one report as given (modifier mask and up to 6 usage codes, 0 for none), no delays
+    virtual bool sendKeys(uint8_t modifiers, const uint8_t *keys) { return false; };
 };
 #endif
@@ -212,9 +212,32 @@ void BleKeyboard::begin(const uint8_t *layout, uint16_t showAs) {
     advertising->setScanResponse(false);
     advertising->start();
     hid->setBatteryLevel(batteryLevel);
+
+#if defined(USE_NIMBLE)
+    if (reportQueue == nullptr) reportQueue = xQueueCreate(BLE_KB_QUEUE_SIZE, sizeof(QueuedReport));
+    if (reportQueue != nullptr && notifyTask == nullptr) {
+        notifyRunning = true;
+        xTaskCreate(notifyTaskMain, "bleKbNotify", 4096, this, 2, &notifyTask);
+    }
+#endif // USE_NIMBLE
 }
 
 void BleKeyboard::end(void) {
+#if defined(USE_NIMBLE)
+    if (notifyTask != nullptr) {
+        // the task leaves by itself, it could be in the middle of a notify
+        notifyRunning = false;
+        xQueueReset(reportQueue);
+        QueuedReport wake = {};
+        xQueueSend(reportQueue, &wake, 0);
+        for (int wait = 0; wait < 100 && notifyTask != nullptr; wait++) vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (notifyTask == nullptr && reportQueue != nullptr) {
+        vQueueDelete(reportQueue);
+        reportQueue = nullptr;
+    }
+    if (retransmits > 0) ESP_LOGD(LOG_TAG, "%lu reports sent again", (unsigned long)retransmits);
+#endif // USE_NIMBLE
     int i = 0;
     i = pServer->getConnectedCount();
     if (i > 0) {
@@ -238,6 +261,7 @@ void BleKeyboard::setName(String deviceName) { this->deviceName = deviceName; }
 
 /**
  * @brief Sets the waiting time (in milliseconds) between multiple keystrokes in NimBLE mode.
+ * 0 sends a few reports per connection interval, as fast as the link takes them.
  *
  * @param ms Time in milliseconds
  */
@@ -250,29 +274,91 @@ void BleKeyboard::set_product_id(uint16_t pid) { this->pid = pid; }
 void BleKeyboard::set_version(uint16_t version) { this->version = version; }
 
 void BleKeyboard::sendReport(KeyReport *keys) {
-    // if (this->isConnected())
-    if (this->isConnected() && this->inputKeyboard->getSubscribedCount() > 0) {
-        this->inputKeyboard->setValue((uint8_t *)keys, sizeof(KeyReport));
-        this->inputKeyboard->notify();
-#if defined(USE_NIMBLE)
-        // vTaskDelay(delayTicks);
-        this->delay_ms(_delay_ms);
-#endif // USE_NIMBLE
-    }
+    queueReport(this->inputKeyboard, (uint8_t *)keys, sizeof(KeyReport));
 }
 
 void BleKeyboard::sendReport(MediaKeyReport *keys) {
-    // if (this->isConnected())
-    if (this->isConnected() && this->inputKeyboard->getSubscribedCount() > 0) {
-        this->inputMediaKeys->setValue((uint8_t *)keys, sizeof(MediaKeyReport));
-        this->inputMediaKeys->notify();
+    queueReport(this->inputMediaKeys, (uint8_t *)keys, sizeof(MediaKeyReport));
+}
+
+void BleKeyboard::queueReport(BLECharacteristic *characteristic, const uint8_t *data, size_t size) {
+    if (!this->isConnected() || this->inputKeyboard->getSubscribedCount() == 0) return;
 #if defined(USE_NIMBLE)
-        // vTaskDelay(delayTicks);
-        this->delay_ms(_delay_ms);
+    if (reportQueue != nullptr) {
+        QueuedReport report;
+        report.characteristic = characteristic;
+        report.size = size;
+        memcpy(report.data, data, size);
+        // waits while the link is behind, callers type no faster than the host takes the reports
+        if (xQueueSend(reportQueue, &report, pdMS_TO_TICKS(BLE_KB_QUEUE_WAIT_MS)) != pdTRUE) {
+            ESP_LOGW(LOG_TAG, "report queue full, report dropped");
+        }
+        return;
+    }
 #endif // USE_NIMBLE
+    characteristic->setValue(data, size);
+    characteristic->notify();
+}
+
+#if defined(USE_NIMBLE)
+void BleKeyboard::notifyTaskMain(void *arg) {
+    BleKeyboard *kb = (BleKeyboard *)arg;
+    QueuedReport report;
+    while (kb->notifyRunning) {
+        if (xQueueReceive(kb->reportQueue, &report, portMAX_DELAY) != pdTRUE) continue;
+        if (kb->notifyRunning && report.characteristic != nullptr) kb->sendQueued(report);
     }
+    kb->notifyTask = nullptr;
+    vTaskDelete(NULL);
 }
 
+/*
+ * Every report carries the whole keyboard state, so one the controller had
+ * no buffer for is sent again before any later one: a missed release would
+ * otherwise merge two presses of the same key.
+ */
+void BleKeyboard::sendQueued(const QueuedReport &report) {
+    for (int attempt = 0; attempt < BLE_KB_NOTIFY_RETRIES; attempt++) {
+        if (!this->isConnected() || report.characteristic->getSubscribedCount() == 0) return;
+        pace();
+        notifyStatus = 0;
+        report.characteristic->setValue(report.data, report.size);
+        report.characteristic->notify();
+        lastNotify = millis();
+        if (notifyStatus == 0) return;
+        retransmits++;
+        // buffers are freed as the host acknowledges them, at the next connection events
+        windowCount = BLE_KB_REPORTS_PER_EVENT;
+        vTaskDelay(pdMS_TO_TICKS(connIntervalMs()));
+    }
+    ESP_LOGW(LOG_TAG, "report dropped after %d tries", BLE_KB_NOTIFY_RETRIES);
+}
+
+void BleKeyboard::pace() {
+    uint32_t now = millis();
+    if (_delay_ms > 0) {
+        if (now - lastNotify < _delay_ms) vTaskDelay(pdMS_TO_TICKS(_delay_ms - (now - lastNotify)));
+        return;
+    }
+    uint32_t interval = connIntervalMs();
+    if (now - windowStart >= interval) {
+        windowStart = now;
+        windowCount = 0;
+    } else if (windowCount >= BLE_KB_REPORTS_PER_EVENT) {
+        vTaskDelay(pdMS_TO_TICKS(interval - (now - windowStart)) + 1);
+        windowStart = millis();
+        windowCount = 0;
+    }
+    windowCount++;
+}
+
+uint32_t BleKeyboard::connIntervalMs() {
+    ble_gap_conn_desc desc;
+    if (connHandle == 0xFFFF || ble_gap_conn_find(connHandle, &desc) != 0) return 15;
+    return max<uint32_t>(1, desc.conn_itvl * 5 / 4); // 1.25ms units
+}
+#endif // USE_NIMBLE
+
 uint8_t USBPutChar(uint8_t c);
 
 // press() adds the specified key (printing, non-printing, or modifier)
@@ -395,6 +481,13 @@ void BleKeyboard::releaseAll(void) {
     sendReport(&_mediaKeyReport);
 }
 
+bool BleKeyboard::sendKeys(uint8_t modifiers, const uint8_t *keys) {
+    _keyReport.modifiers = modifiers;
+    memcpy(_keyReport.keys, keys, 6);
+    sendReport(&_keyReport);
+    return true;
+}
+
 size_t BleKeyboard::write(uint8_t c) {
     uint8_t p = press(c); // Keydown
     release(c);           // Keyup
@@ -438,6 +531,10 @@ void BleKeyboard::onConnect(BLEServer *pServer) {
 
 void BleKeyboard::onDisconnect(BLEServer *pServer) {
     this->connected = false;
+    this->connHandle = 0xFFFF;
+#if defined(USE_NIMBLE)
+    if (reportQueue != nullptr) xQueueReset(reportQueue);
+#endif // USE_NIMBLE
     // NimBLEDevice::startAdvertising();
     Serial.println("lib disconnected");
 
@@ -457,6 +554,12 @@ void BleKeyboard::onAuthenticationComplete(ble_gap_conn_desc *desc) {
     if (desc->sec_state.encrypted) {
         Serial.println("Paired successfully.");
         this->connected = true;
+        this->connHandle = desc->conn_handle;
+        ESP_LOGD(LOG_TAG, "Connection interval %.2fms, asking for a shorter one", desc->conn_itvl * 1.25);
+        // hosts pick their own, a short interval gives more connection events to send reports in
+        pServer->updateConnParams(
+            desc->conn_handle, BLE_KB_CONN_ITVL_MIN, BLE_KB_CONN_ITVL_MAX, 0, BLE_KB_CONN_TIMEOUT
+        );
     } else {
         Serial.println("Pairing failed");
         this->connected = false;
@@ -469,16 +572,13 @@ void BleKeyboard::onWrite(BLECharacteristic *me) {
     ESP_LOGI(LOG_TAG, "special keys: %d", *value);
 }
 
-void BleKeyboard::delay_ms(uint64_t ms) {
-    uint64_t m = esp_timer_get_time();
-    if (ms) {
-        uint64_t e = (m + (ms * 1000));
-        if (m > e) { // overflow
-            while (esp_timer_get_time() > e) {}
-        }
-        while (esp_timer_get_time() < e) {}
-    }
+void BleKeyboard::onStatus(NimBLECharacteristic *pCharacteristic, Status s, int code) {
+#if defined(USE_NIMBLE)
+    // called from notify(), on the notify task
+    if (s != Status::SUCCESS_NOTIFY) notifyStatus = code != 0 ? code : -1;
+#endif // USE_NIMBLE
 }
+
 void BleKeyboard::onSubscribe(
     NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue
 ) {
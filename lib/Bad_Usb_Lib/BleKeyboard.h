@@ -35,6 +35,14 @@
 #define BLE_KEYBOARD_VERSION_MINOR 0
 #define BLE_KEYBOARD_VERSION_REVISION 4
 
+#define BLE_KB_QUEUE_SIZE 64        // reports waiting for the notify task
+#define BLE_KB_QUEUE_WAIT_MS 2000   // longest a caller waits for room in the queue
+#define BLE_KB_NOTIFY_RETRIES 50    // tries of a report the controller has no buffer for
+#define BLE_KB_REPORTS_PER_EVENT 3  // notifications sent per connection interval when no delay is set
+#define BLE_KB_CONN_ITVL_MIN 6      // 7.5ms, in 1.25ms units
+#define BLE_KB_CONN_ITVL_MAX 12     // 15ms
+#define BLE_KB_CONN_TIMEOUT 400     // 4s, in 10ms units
+
 class BleKeyboard : public BLEServerCallbacks, public BLECharacteristicCallbacks, public HIDInterface {
 private:
     BLEHIDDevice *hid;
@@ -50,8 +58,30 @@ private:
     String deviceManufacturer;
     uint8_t batteryLevel;
     bool connected = false;
-    uint32_t _delay_ms = 7;
-    void delay_ms(uint64_t ms);
+    uint32_t _delay_ms = 0; // 0 paces to the connection interval
+    uint16_t connHandle = 0xFFFF;
+
+#if defined(USE_NIMBLE)
+    struct QueuedReport {
+        BLECharacteristic *characteristic;
+        uint8_t size;
+        uint8_t data[sizeof(KeyReport)];
+    };
+    QueueHandle_t reportQueue = nullptr;
+    TaskHandle_t notifyTask = nullptr;
+    volatile bool notifyRunning = false;
+    volatile int notifyStatus = 0;
+    uint32_t windowStart = 0;
+    uint8_t windowCount = 0;
+    uint32_t lastNotify = 0;
+    uint32_t retransmits = 0;
+
+    static void notifyTaskMain(void *arg);
+    void sendQueued(const QueuedReport &report);
+    void pace();
+    uint32_t connIntervalMs();
+#endif // USE_NIMBLE
+    void queueReport(BLECharacteristic *characteristic, const uint8_t *data, size_t size);
 
     uint16_t vid = 0x05ac;
     uint16_t pid = 0x820a;
@@ -70,6 +100,8 @@ public:
     void begin(const uint8_t *layout = KeyboardLayout_en_US) override { begin(layout, HID_KEYBOARD); };
     void begin(const uint8_t *layout, uint16_t showAs);
     void setLayout(const uint8_t *layout = KeyboardLayout_en_US) { _asciimap = layout; }
+    const uint8_t *getLayout() override { return _asciimap; }
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override;
     void end(void) override;
     void sendReport(KeyReport *keys);
     void sendReport(MediaKeyReport *keys);
@@ -101,6 +133,7 @@ protected:
     virtual void onDisconnect(BLEServer *pServer) override;
     virtual void onAuthenticationComplete(ble_gap_conn_desc *desc);
     virtual void onWrite(BLECharacteristic *me) override;
+    virtual void onStatus(NimBLECharacteristic *pCharacteristic, Status s, int code) override;
     virtual void
     onSubscribe(NimBLECharacteristic *pCharacteristic, ble_gap_conn_desc *desc, uint16_t subValue) override;
 };
@@ -196,6 +196,14 @@ void CH9329_Keyboard_::releaseAll(void)
 	sendReport(&_keyReport);
 }
 
+bool CH9329_Keyboard_::sendKeys(uint8_t modifiers, const uint8_t *keys)
+{
+	_keyReport.modifiers = modifiers;
+	memcpy(_keyReport.keys, keys, 6);
+	sendReport(&_keyReport);
+	return true;
+}
+
 size_t CH9329_Keyboard_::write(uint8_t c)
 {
 	uint8_t p = press(c);	// Keydown
@@ -67,6 +67,8 @@ public:
     size_t release(uint8_t k) override;
     void releaseAll(void) override;
     void setLayout(const uint8_t *layout) override { _asciimap = layout; };
+    const uint8_t *getLayout() override { return _asciimap; };
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override;
 };
 extern CH9329_Keyboard_ CH9329_Keyboard;
 
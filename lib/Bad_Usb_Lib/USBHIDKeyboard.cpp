@@ -208,6 +208,14 @@ void USBHIDKeyboard::releaseAll(void)
     sendReport(&_keyReport);
 }
 
+bool USBHIDKeyboard::sendKeys(uint8_t modifiers, const uint8_t *keys)
+{
+    _keyReport.modifiers = modifiers;
+    memcpy(_keyReport.keys, keys, 6);
+    sendReport(&_keyReport);
+    return true;
+}
+
 size_t USBHIDKeyboard::write(uint8_t c)
 {
     uint8_t p = press(c);  // Keydown
@@ -63,6 +63,8 @@ public:
     size_t release(uint8_t k) override;
     void releaseAll(void) override;
     void setLayout(const uint8_t *layout) override { _asciimap = layout; };
+    const uint8_t *getLayout() override { return _asciimap; };
+    bool sendKeys(uint8_t modifiers, const uint8_t *keys) override;
     void sendReport(KeyReport *keys);
 
     // raw functions work with TinyUSB's HID_KEY_* macros
@@ -89,10 +89,10 @@ def minify_html(html):
     return html if minify_req is False else minify_req.text.encode('utf-8')
 
 # gzip web files
-def prepare_www_files():
-    HEADER_FILE = join(env.get("PROJECT_DIR"), "include", "webFiles.h")
+def prepare_www_files(source_dir, header_name, header_guard):
+    HEADER_FILE = join(env.get("PROJECT_DIR"), "include", header_name)
     filetypes_to_gzip = ["html", "css", "js"]
-    data_src_dir = join(env.get("PROJECT_DIR"), "embedded_resources/web_interface")
+    data_src_dir = join(env.get("PROJECT_DIR"), source_dir)
     checksum_file = join(data_src_dir, "checksum.sha256")
     checksum = ""
 
@@ -118,10 +118,10 @@ def prepare_www_files():
 
     with open(HEADER_FILE, "w") as header:
         header.write(
-            "#ifndef WEB_FILES_H\n#define WEB_FILES_H\n\n#include <Arduino.h>\n\n"
+            f"#ifndef {header_guard}\n#define {header_guard}\n\n#include <Arduino.h>\n\n"
         )
         header.write(
-            "// THIS FILE IS AUTOGENERATED DO NOT MODIFY IT. MODIFY FILES IN /embedded_resources/web_interface\n\n"
+            f"// THIS FILE IS AUTOGENERATED DO NOT MODIFY IT. MODIFY FILES IN /{source_dir}\n\n"
         )
 
         for file in files_to_gzip:
@@ -159,11 +159,12 @@ def prepare_www_files():
 
             remove(gz_file)  # Clean up temporary gzip file
 
-        header.write("#endif // WEB_FILES_H\n")
+        header.write(f"#endif // {header_guard}\n")
 
     save_checksum_file(files_checksum, checksum_file)
 
     print(f"[DONE] Gzipped files embedded into {HEADER_FILE}")
 
 
-prepare_www_files()
+prepare_www_files("embedded_resources/web_interface", "webFiles.h", "WEB_FILES_H")
+prepare_www_files("embedded_resources/evil_portal", "portalFiles.h", "PORTAL_FILES_H")
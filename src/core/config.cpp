@@ -39,6 +39,7 @@ JsonDocument BruceConfig::toJson() const {
     for (auto key : evilWifiNames) _evilWifiNames.add(key);
 
     setting["bleName"] = bleName;
+    setting["badUsbReportMs"] = badUsbReportMs;
 
     JsonObject _wifi = setting["wifi"].to<JsonObject>();
     for (const auto &pair : wifi) { _wifi[pair.first] = pair.second; }
@@ -53,6 +54,7 @@ JsonDocument BruceConfig::toJson() const {
     setting["rfFreq"] = rfFreq;
     setting["rfFxdFreq"] = rfFxdFreq;
     setting["rfScanRange"] = rfScanRange;
+    setting["rfFastHop"] = rfFastHop;
 
     setting["rfidModule"] = rfidModule;
 
@@ -83,6 +85,7 @@ JsonDocument BruceConfig::toJson() const {
 
 void BruceConfig::fromFile(bool checkFS) {
     FS *fs;
+    _recoverInterruptedSave();
     if (checkFS) {
         if (!getFsStorage(fs)) {
             log_i("Fail getting filesystem for config");
@@ -276,6 +279,12 @@ void BruceConfig::fromFile(bool checkFS) {
         count++;
         log_e("Fail");
     }
+    if (!setting["badUsbReportMs"].isNull()) {
+        badUsbReportMs = setting["badUsbReportMs"].as<int>();
+    } else {
+        count++;
+        log_e("Fail");
+    }
 
     if (!setting["irTx"].isNull()) {
         irTx = setting["irTx"].as<int>();
@@ -332,6 +341,12 @@ void BruceConfig::fromFile(bool checkFS) {
         count++;
         log_e("Fail");
     }
+    if (!setting["rfFastHop"].isNull()) {
+        rfFastHop = setting["rfFastHop"].as<int>();
+    } else {
+        count++;
+        log_e("Fail");
+    }
 
     if (!setting["rfidModule"].isNull()) {
         rfidModule = setting["rfidModule"].as<int>();
@@ -418,30 +433,127 @@ void BruceConfig::fromFile(bool checkFS) {
     log_i("Using config from file");
 }
 
+/*********************************************************************
+**  Function: saveFile
+**  Snapshots the config and hands it to the save task. Bursts of setter
+**  calls (menus, sliders, web UI) end up as a single flash write
+**********************************************************************/
 void BruceConfig::saveFile() {
-    FS *fs = &LittleFS;
-    JsonDocument jsonDoc = toJson();
+    String json;
+    serializeJsonPretty(toJson(), json); // bruce.conf is edited by hand
+
+    if (_saveMutex == NULL) {
+        _pendingJson = json;
+        _pendingWrite = true;
+        return commit();
+    }
 
-    // Open file for writing
-    File file = fs->open(filepath, FILE_WRITE);
+    xSemaphoreTake(_saveMutex, portMAX_DELAY);
+    _pendingJson = json;
+    _pendingWrite = true;
+    if (_saveTask == NULL &&
+        xTaskCreate(_saveTaskHandler, "ConfigSave", 4096, this, 1, &_saveTask) != pdPASS) {
+        _saveTask = NULL;
+    }
+    TaskHandle_t task = _saveTask;
+    xSemaphoreGive(_saveMutex);
+
+    if (task == NULL) return commit();
+    xTaskNotifyGive(task);
+}
+
+void BruceConfig::_saveTaskHandler(void *param) {
+    BruceConfig *config = (BruceConfig *)param;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // Every new saveFile() restarts the quiet period
+        while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_SAVE_DELAY_MS)) > 0) {}
+        config->_writePending();
+    }
+}
+
+/*********************************************************************
+**  Function: _writePending
+**  Writes the latest snapshot to a temp file and renames it over the
+**  config, so a power loss leaves either the old or the new file.
+**  LittleFS only: SD shares the SPI bus with the display, see syncSdMirror()
+**********************************************************************/
+bool BruceConfig::_writePending() {
+    if (_saveMutex) xSemaphoreTake(_saveMutex, portMAX_DELAY);
+    if (!_pendingWrite) {
+        if (_saveMutex) xSemaphoreGive(_saveMutex);
+        return true;
+    }
+
+    FS *fs = &LittleFS;
+    bool ok = false;
+    File file = fs->open(tmpFilepath, FILE_WRITE);
     if (!file) {
         log_e("Failed to open config file");
+    } else {
+        ok = file.print(_pendingJson) == _pendingJson.length();
         file.close();
-        return;
-    };
+        if (ok && !fs->rename(tmpFilepath, filepath)) {
+            // rename() does not replace on every FS, the tmp file is recovered by fromFile() if we die here
+            fs->remove(filepath);
+            ok = fs->rename(tmpFilepath, filepath);
+        }
+        if (!ok) {
+            log_e("Failed to write config file");
+            fs->remove(tmpFilepath);
+        }
+    }
 
-    // Serialize JSON to file
-    serializeJsonPretty(jsonDoc, Serial);
-    if (serializeJsonPretty(jsonDoc, file) < 5) log_e("Failed to write config file");
-    else log_i("config file written successfully");
+    if (ok) {
+        log_i("config file written successfully");
+        _pendingWrite = false;
+        _pendingJson = "";
+        _sdMirrorPending = true;
+    }
+    if (_saveMutex) xSemaphoreGive(_saveMutex);
+    return ok;
+}
 
-    file.close();
+/*********************************************************************
+**  Function: commit
+**  Flushes any pending change right away, used before restart/power off.
+**  The web server and serial tasks only write LittleFS: the SD card
+**  shares the SPI bus with the display, which the UI task drives
+**********************************************************************/
+void BruceConfig::commit(bool sdMirror) {
+    _writePending();
+    if (sdMirror) syncSdMirror();
+}
 
+/*********************************************************************
+**  Function: syncSdMirror
+**  Copies the written config to SD, called from the main loop
+**********************************************************************/
+void BruceConfig::syncSdMirror() {
+    if (!_sdMirrorPending) return;
+    _sdMirrorPending = false;
     if (setupSdCard()) copyToFs(LittleFS, SD, filepath, false);
 }
 
+/*********************************************************************
+**  Function: _recoverInterruptedSave
+**  A leftover tmp file means a write was cut: it only replaces the
+**  config when the config itself is gone (died between remove and rename)
+**********************************************************************/
+void BruceConfig::_recoverInterruptedSave() {
+    if (!LittleFS.exists(tmpFilepath)) return;
+    if (!LittleFS.exists(filepath) && LittleFS.rename(tmpFilepath, filepath)) {
+        log_i("Recovered config from interrupted save");
+        return;
+    }
+    LittleFS.remove(tmpFilepath);
+}
+
 void BruceConfig::factoryReset() {
     FS *fs = &LittleFS;
+    if (_saveMutex) xSemaphoreTake(_saveMutex, portMAX_DELAY);
+    _pendingWrite = false;
+    _sdMirrorPending = false;
     fs->rename(String(filepath), "/bak." + String(filepath).substring(1));
     if (setupSdCard()) SD.rename(String(filepath), "/bak." + String(filepath).substring(1));
     ESP.restart();
@@ -461,6 +573,7 @@ void BruceConfig::validateConfig() {
     validateLedEffectValue();
     validateLedEffectSpeedValue();
     validateLedEffectDirectionValue();
+    validateBadUsbReportMsValue();
     validateRfScanRangeValue();
     validateRfModuleValue();
     validateRfidModuleValue();
@@ -648,6 +761,16 @@ void BruceConfig::setBleName(String value) {
     saveFile();
 }
 
+void BruceConfig::setBadUsbReportMs(int value) {
+    badUsbReportMs = value;
+    validateBadUsbReportMsValue();
+    saveFile();
+}
+
+void BruceConfig::validateBadUsbReportMsValue() {
+    if (badUsbReportMs < 1 || badUsbReportMs > 100) badUsbReportMs = 4;
+}
+
 void BruceConfig::setIrTxPin(int value) {
     irTx = value;
     saveFile();
@@ -705,6 +828,11 @@ void BruceConfig::validateRfScanRangeValue() {
     if (rfScanRange < 0 || rfScanRange > 3) rfScanRange = 3;
 }
 
+void BruceConfig::setRfFastHop(int value) {
+    rfFastHop = value ? 1 : 0;
+    saveFile();
+}
+
 void BruceConfig::setRfidModule(RFIDModules value) {
     rfidModule = value;
     validateRfidModuleValue();
@@ -8,6 +8,8 @@
 #include <set>
 #include <vector>
 
+#define CONFIG_SAVE_DELAY_MS 1500
+
 enum RFIDModules {
     M5_RFID2_MODULE = 0,
     PN532_I2C_MODULE = 1,
@@ -36,6 +38,7 @@ public:
     };
 
     const char *filepath = "/bruce.conf";
+    const char *tmpFilepath = "/bruce.conf.tmp";
 
     // Settings
     int rotation = ROTATION > 1 ? 3 : 1;
@@ -64,6 +67,9 @@ public:
     // BLE
     String bleName = String("Keyboard_" + String((uint8_t)(ESP.getEfuseMac() >> 32), HEX));
 
+    // BadUSB
+    int badUsbReportMs = 4; // minimum time between two keyboard reports of a payload
+
     // IR
     int irTx = LED;
     uint8_t irTxRepeats = 0;
@@ -76,6 +82,7 @@ public:
     float rfFreq = 433.92;
     int rfFxdFreq = 1;
     int rfScanRange = 3;
+    int rfFastHop = 0;
 
     // iButton Pin
     int iButton = 0;
@@ -105,13 +112,16 @@ public:
     /////////////////////////////////////////////////////////////////////////////////////
     // Constructor
     /////////////////////////////////////////////////////////////////////////////////////
-    BruceConfig() {};
+    // created once here, saves from several tasks at the same time share it
+    BruceConfig() : _saveMutex(xSemaphoreCreateMutex()) {};
     // ~BruceConfig();
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Operations
     /////////////////////////////////////////////////////////////////////////////////////
     void saveFile();
+    void commit(bool sdMirror = true); // false from tasks other than the UI one
+    void syncSdMirror();
     void fromFile(bool checkFS = true);
     void factoryReset();
     void validateConfig();
@@ -163,6 +173,10 @@ public:
     // BLE
     void setBleName(const String name);
 
+    // BadUSB
+    void setBadUsbReportMs(int value);
+    void validateBadUsbReportMsValue();
+
     // IR
     void setIrTxPin(int value);
     void setIrTxRepeats(uint8_t value);
@@ -177,6 +191,7 @@ public:
     void setRfFxdFreq(float value);
     void setRfScanRange(int value, int fxdFreq = 0);
     void validateRfScanRangeValue();
+    void setRfFastHop(int value);
 
     // iButton
     void setiButtonPin(int value);
@@ -200,6 +215,19 @@ public:
     void validateColorInverted();
     void addDisabledMenu(String value);
     // TODO: removeDisabledMenu(String value);
+
+private:
+    // Deferred persistence: setters only snapshot the config, a background task writes it
+    // to LittleFS once the changes stop for CONFIG_SAVE_DELAY_MS, the SD copy follows on the main loop
+    SemaphoreHandle_t _saveMutex = NULL;
+    TaskHandle_t _saveTask = NULL;
+    String _pendingJson = "";
+    bool _pendingWrite = false;
+    volatile bool _sdMirrorPending = false;
+
+    static void _saveTaskHandler(void *param);
+    bool _writePending();
+    void _recoverInterruptedSave();
 };
 
 #endif
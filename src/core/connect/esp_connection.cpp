@@ -1,6 +1,7 @@
 #include "esp_connection.h"
 #include "core/display.h"
 #include <WiFi.h>
+#include <esp32/rom/crc.h>
 
 // Initialize the static instance pointer
 EspConnection *EspConnection::instance = nullptr;
@@ -118,6 +119,32 @@ void EspConnection::sendPong(const uint8_t *mac) {
     if (response != ESP_OK) { Serial.printf("Send pong response: %s\n", esp_err_to_name(response)); }
 }
 
+bool EspConnection::sendFrame(
+    const uint8_t *mac, uint8_t type, uint32_t seq, const void *payload, uint16_t len
+) {
+    TransferFrame frame;
+    frame.magic = ESP_XFER_MAGIC;
+    frame.type = type;
+    frame.length = min(len, (uint16_t)ESP_XFER_PAYLOAD_SIZE);
+    frame.seq = seq;
+    if (payload != NULL) memcpy(frame.payload, payload, frame.length);
+    frame.crc = frameCrc(frame);
+
+    return esp_now_send(mac, (uint8_t *)&frame, sizeof(frame)) == ESP_OK;
+}
+
+// Covers type, length and seq too, so a corrupted header is dropped like a corrupted payload.
+// length must be checked against ESP_XFER_PAYLOAD_SIZE before calling this on a received frame.
+uint32_t EspConnection::frameCrc(const TransferFrame &frame) {
+    uint32_t crc = crc32_le(0, (const uint8_t *)&frame, offsetof(TransferFrame, crc));
+    return crc32_le(crc, frame.payload, frame.length);
+}
+
+// Corrupted frames are dropped by both sides, the sender retransmits them
+bool EspConnection::frameValid(const TransferFrame &frame) {
+    return frame.length <= ESP_XFER_PAYLOAD_SIZE && frameCrc(frame) == frame.crc;
+}
+
 bool EspConnection::setupPeer(const uint8_t *mac) {
     if (esp_now_is_peer_exist(mac)) return true;
 
@@ -188,6 +215,15 @@ void EspConnection::onDataSent(const uint8_t *mac_addr, esp_now_send_status_t st
 }
 
 void EspConnection::onDataRecv(const uint8_t *mac, const uint8_t *incomingData, int len) {
+    if (len == sizeof(TransferFrame) && incomingData[0] == ESP_XFER_MAGIC) {
+        // Runs in the WiFi task: only copy the frame, the UI loop validates and handles it
+        ReceivedFrame received;
+        memcpy(received.peer, mac, 6);
+        memcpy(&received.frame, incomingData, sizeof(TransferFrame));
+        if (!frameQueue.push(received)) Serial.println("ESPNOW frame queue full");
+        return;
+    }
+
     Message recvMessage;
 
     // Use reinterpret_cast and copy assignment
@@ -199,5 +235,5 @@ void EspConnection::onDataRecv(const uint8_t *mac, const uint8_t *incomingData,
     if (recvMessage.ping) return sendPong(mac);
     if (recvMessage.pong) return appendPeerToList(mac);
 
-    recvQueue.push_back(recvMessage);
+    if (!recvQueue.push(recvMessage)) Serial.println("ESPNOW message queue full");
 }
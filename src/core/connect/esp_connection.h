@@ -1,6 +1,7 @@
 #ifndef __ESP_CONNECTION_H__
 #define __ESP_CONNECTION_H__
 
+#include <atomic>
 #include <esp_now.h>
 #include <globals.h>
 #include <vector>
@@ -9,6 +10,47 @@
 #define ESP_FILEPATH_SIZE 50
 #define ESP_DATA_SIZE 150
 
+// File transfer frames fill the whole ESP-NOW payload (ESP_NOW_MAX_DATA_LEN = 250 B), which also tells
+// them apart from the smaller Message struct used by ping/pong and serial commands
+#define ESP_XFER_MAGIC 0xB5
+#define ESP_XFER_HEADER_SIZE 12
+#define ESP_XFER_PAYLOAD_SIZE (ESP_NOW_MAX_DATA_LEN - ESP_XFER_HEADER_SIZE)
+#define ESP_XFER_WINDOW 16 // frames in flight, must be <= 32 (selective ack bitmap)
+#define ESP_XFER_QUEUE_SIZE 32
+#define ESP_MSG_QUEUE_SIZE 8
+
+// Single producer (ESP-NOW receive callback, WiFi task) / single consumer (UI loop) ring buffer
+template <typename T, size_t N> class EspRing {
+public:
+    EspRing() : items(new T[N]) {}
+    ~EspRing() { delete[] items; }
+
+    bool push(const T &item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t next = (h + 1) % N;
+        if (next == tail.load(std::memory_order_acquire)) return false;
+        items[h] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+    bool pop(T &item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = items[t];
+        tail.store((t + 1) % N, std::memory_order_release);
+        return true;
+    }
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+    void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+    T *items;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
+
 class EspConnection {
 public:
     enum Status {
@@ -20,6 +62,39 @@ public:
         ABORTED,
     };
 
+    enum FrameType : uint8_t {
+        XFER_START = 1, // payload: TransferInfo
+        XFER_START_ACK, // seq: chunk to resume from
+        XFER_DATA,      // seq: chunk index, payload: file data
+        XFER_ACK,       // seq: next expected chunk, payload: uint32 bitmap of chunks seq+1..seq+32
+        XFER_END,       // seq: chunk count
+        XFER_END_ACK,   // seq: 1 if size and whole-file CRC matched
+        XFER_ABORT,
+    };
+
+    struct __attribute__((packed)) TransferFrame {
+        uint8_t magic;
+        uint8_t type;
+        uint16_t length; // payload bytes
+        uint32_t seq;
+        uint32_t crc; // CRC32 of the header fields above and the payload
+        uint8_t payload[ESP_XFER_PAYLOAD_SIZE];
+    };
+    static_assert(sizeof(TransferFrame) == ESP_NOW_MAX_DATA_LEN, "TransferFrame must fill an ESP-NOW frame");
+
+    // Queued with the MAC it came from, so a frame of another device is never taken for the peer's
+    struct ReceivedFrame {
+        uint8_t peer[6];
+        TransferFrame frame;
+    };
+
+    struct __attribute__((packed)) TransferInfo {
+        uint32_t totalBytes;
+        uint32_t fileCrc;
+        char filename[ESP_FILENAME_SIZE];
+        char filepath[ESP_FILEPATH_SIZE];
+    };
+
     // Struct has to be 250 B max
     struct Message {
         char filename[ESP_FILENAME_SIZE];
@@ -56,7 +131,9 @@ protected:
     Status sendStatus;
     uint8_t dstAddress[6];
     uint8_t broadcastAddress[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    std::vector<Message> recvQueue;
+    EspRing<Message, ESP_MSG_QUEUE_SIZE> recvQueue;
+    EspRing<ReceivedFrame, ESP_XFER_QUEUE_SIZE> frameQueue;
+    uint8_t framePeer[6]; // device of the transfer in progress
 
     bool beginSend();
     bool beginEspnow();
@@ -68,6 +145,10 @@ protected:
 
     void sendPing();
     void sendPong(const uint8_t *mac);
+    bool
+    sendFrame(const uint8_t *mac, uint8_t type, uint32_t seq, const void *payload = NULL, uint16_t len = 0);
+    static uint32_t frameCrc(const TransferFrame &frame);
+    static bool frameValid(const TransferFrame &frame);
 
     bool setupPeer(const uint8_t *mac);
     void appendPeerToList(const uint8_t *mac);
@@ -1,6 +1,7 @@
 #include "file_sharing.h"
 #include "core/display.h"
 #include <SD.h>
+#include <esp32/rom/crc.h>
 FileSharing::FileSharing() {}
 
 void FileSharing::sendFile() {
@@ -15,44 +16,114 @@ void FileSharing::sendFile() {
         return;
     }
 
-    Message message = createFileMessage(file);
-
-    esp_err_t response;
-    sendStatus = STARTED;
-
     drawMainBorderWithTitle("SEND FILE");
     padprintln("");
-    padprintln("Sending...");
-
-    delay(100);
+    padprintln("Connecting...");
+
+    TransferInfo info = {};
+    String path = String(file.path());
+    info.totalBytes = file.size();
+    info.fileCrc = fileCrc(file);
+    strncpy(info.filename, file.name(), ESP_FILENAME_SIZE - 1);
+    strncpy(info.filepath, path.substring(0, path.lastIndexOf("/")).c_str(), ESP_FILEPATH_SIZE - 1);
+
+    uint32_t chunks = (info.totalBytes + ESP_XFER_PAYLOAD_SIZE - 1) / ESP_XFER_PAYLOAD_SIZE;
+    uint32_t base = 0; // first chunk not yet confirmed by the receiver
+    frameQueue.clear();
+    sendStatus = STARTED;
 
-    while (file.available()) {
+    // The receiver answers with the chunk to resume from, 0 for a new file
+    if (!waitControlAck(dstAddress, XFER_START, XFER_START_ACK, &info, sizeof(info), 0, base)) {
+        displayError("Receiver not responding");
+        file.close();
+        delay(1000);
+        return;
+    }
+    if (base > chunks) base = 0;
+    // Answer came from the actual receiver, talk to it directly instead of broadcasting
+    if (setupPeer(framePeer)) setDstAddress(framePeer);
+
+    uint8_t *window = (uint8_t *)malloc(ESP_XFER_WINDOW * ESP_XFER_PAYLOAD_SIZE);
+    if (window == NULL) {
+        displayError("Out of memory");
+        file.close();
+        delay(1000);
+        return;
+    }
+    uint16_t windowLen[ESP_XFER_WINDOW];
+    unsigned long sentAt[ESP_XFER_WINDOW];
+    uint32_t acked = 0; // selectively acknowledged chunks, bit 0 = base
+    uint32_t next = base;
+    uint32_t firstChunk = base;
+    unsigned long startTime = millis();
+    unsigned long lastProgress = millis();
+    unsigned long lastDraw = 0;
+
+    while (base < chunks) {
         if (check(EscPress)) sendStatus = ABORTED;
-
-        if (sendStatus == ABORTED || sendStatus == FAILED) {
-            message.done = true;
-            message.dataSize = 0;
-            esp_now_send(dstAddress, (uint8_t *)&message, sizeof(message));
-            displayError("Error sending file");
-            break;
+        if (millis() - lastProgress > ESP_XFER_TIMEOUT_MS) sendStatus = FAILED;
+        if (sendStatus == ABORTED || sendStatus == FAILED) break;
+
+        // Fill the window with new chunks
+        while (next < chunks && next < base + ESP_XFER_WINDOW) {
+            uint8_t slot = next % ESP_XFER_WINDOW;
+            uint8_t *data = window + slot * ESP_XFER_PAYLOAD_SIZE;
+            file.seek(next * ESP_XFER_PAYLOAD_SIZE);
+            windowLen[slot] = file.read(data, ESP_XFER_PAYLOAD_SIZE);
+            // a send that did not make it into the ESP-NOW queue is retried with the timed out ones
+            sentAt[slot] = sendFrame(dstAddress, XFER_DATA, next, data, windowLen[slot]) ? millis() : 0;
+            next++;
         }
 
-        size_t bytesRead = file.readBytes(message.data, ESP_DATA_SIZE);
-        message.dataSize = bytesRead;
-        message.bytesSent = min(message.bytesSent + bytesRead, message.totalBytes);
-        message.done = message.bytesSent == message.totalBytes;
+        // Slide the window on acknowledgements
+        ReceivedFrame received;
+        while (frameQueue.pop(received)) {
+            const TransferFrame &frame = received.frame;
+            if (!frameValid(frame) || memcmp(received.peer, framePeer, 6) != 0) continue;
+            if (frame.type == XFER_ABORT) sendStatus = FAILED;
+            if (frame.type != XFER_ACK || frame.seq < base || frame.seq > next) continue;
+
+            uint32_t bitmap;
+            memcpy(&bitmap, frame.payload, sizeof(bitmap));
+            uint32_t advance = frame.seq - base;
+            acked = advance >= 32 ? 0 : acked >> advance;
+            acked |= bitmap << 1;
+            base = frame.seq;
+            lastProgress = millis();
+        }
 
-        response = esp_now_send(dstAddress, (uint8_t *)&message, sizeof(message));
-        if (response != ESP_OK) {
-            Serial.printf("Send file response: %s\n", esp_err_to_name(response));
-            sendStatus = FAILED;
+        // Retransmit whatever timed out
+        for (uint32_t seq = base; seq < next; seq++) {
+            if (acked & (1UL << (seq - base))) continue;
+            uint8_t slot = seq % ESP_XFER_WINDOW;
+            if (millis() - sentAt[slot] < ESP_XFER_RTO_MS) continue;
+            uint8_t *data = window + slot * ESP_XFER_PAYLOAD_SIZE;
+            sentAt[slot] = sendFrame(dstAddress, XFER_DATA, seq, data, windowLen[slot]) ? millis() : 0;
         }
 
-        progressHandler(file.position(), file.size(), "Sending...");
-        delay(100);
+        if (millis() - lastDraw > 250) {
+            uint32_t confirmed = min(base * ESP_XFER_PAYLOAD_SIZE, info.totalBytes);
+            progressHandler(confirmed, info.totalBytes, "Sending...");
+            lastDraw = millis();
+        }
+        delay(1);
     }
+    free(window);
 
-    if (message.bytesSent == message.totalBytes) displaySuccess("File sent");
+    uint32_t verified = 0;
+    if (base == chunks) {
+        waitControlAck(dstAddress, XFER_END, XFER_END_ACK, &info, sizeof(info), chunks, verified);
+    }
+    if (verified) {
+        unsigned long elapsed = max(millis() - startTime, 1UL);
+        uint32_t sentBytes = info.totalBytes - min(firstChunk * ESP_XFER_PAYLOAD_SIZE, info.totalBytes);
+        unsigned long rate = sentBytes * 1000UL / elapsed;
+        log_d("File sent: %u bytes in %lu ms (%lu B/s)", sentBytes, elapsed, rate);
+        displaySuccess("File sent");
+    } else {
+        if (sendStatus == ABORTED) sendFrame(dstAddress, XFER_ABORT, 0);
+        displayError("Error sending file");
+    }
 
     file.close();
     delay(1000);
@@ -64,17 +135,23 @@ void FileSharing::receiveFile() {
     padprintln("Waiting...");
 
     recvFileName = "";
-    recvQueue = {};
+    recvPartName = "";
+    recvQueue.clear();
+    frameQueue.clear();
     recvStatus = CONNECTING;
 
     if (!beginEspnow()) return;
 
-    delay(100);
+    unsigned long lastFrame = millis();
+    unsigned long lastDraw = 0;
 
     while (1) {
         if (check(EscPress)) recvStatus = ABORTED;
+        // Sender went away, the partial file is kept so the next transfer resumes
+        if (recvStatus == STARTED && millis() - lastFrame > 2 * ESP_XFER_TIMEOUT_MS) recvStatus = FAILED;
 
         if (recvStatus == ABORTED || recvStatus == FAILED) {
+            if (recvStatus == ABORTED && recvPartName != "") sendFrame(framePeer, XFER_ABORT, 0);
             displayError("Error receiving file");
             break;
         }
@@ -83,26 +160,47 @@ void FileSharing::receiveFile() {
             break;
         }
 
-        if (!recvQueue.empty()) {
-            Message recvFileMessage = recvQueue.front();
-            recvQueue.erase(recvQueue.begin());
-
-            progressHandler(recvFileMessage.bytesSent, recvFileMessage.totalBytes, "Receiving...");
-
-            if (!appendToFile(recvFileMessage)) {
-                recvStatus = FAILED;
-                Serial.println("Failed appending to file");
-            }
-            if (recvFileMessage.done) {
-                Serial.println("Recv done");
-                recvStatus = recvFileMessage.bytesSent == recvFileMessage.totalBytes ? SUCCESS : FAILED;
+        ReceivedFrame received;
+        while (frameQueue.pop(received)) {
+            const TransferFrame &frame = received.frame;
+            if (!frameValid(frame)) continue;
+            // once a transfer started, other devices are ignored
+            if (recvStatus == STARTED && memcmp(received.peer, framePeer, 6) != 0) continue;
+            memcpy(framePeer, received.peer, 6);
+            lastFrame = millis();
+
+            bool ok = true;
+            switch (frame.type) {
+                case XFER_START: ok = handleStart(frame); break;
+                case XFER_DATA: ok = handleData(frame); break;
+                case XFER_END: ok = handleEnd(frame); break;
+                case XFER_ABORT: ok = false; break;
+                default: break;
             }
+            if (!ok) recvStatus = FAILED;
         }
 
-        delay(100);
+        if (recvStatus == STARTED && millis() - lastDraw > 250) {
+            progressHandler(recvBytes, recvInfo.totalBytes, "Receiving...");
+            lastDraw = millis();
+        }
+        delay(1);
     }
 
-    delay(1000);
+    // Keep answering END for a moment in case our END_ACK was lost
+    unsigned long lingerStart = millis();
+    while (recvStatus == SUCCESS && millis() - lingerStart < 1000) {
+        ReceivedFrame received;
+        while (frameQueue.pop(received)) {
+            if (!frameValid(received.frame) || memcmp(received.peer, framePeer, 6) != 0) continue;
+            if (received.frame.type == XFER_END) sendFrame(framePeer, XFER_END_ACK, 1);
+        }
+        delay(10);
+    }
+
+    closeRecvFile();
+    free(recvWindow);
+    recvWindow = NULL;
 
     if (recvStatus == SUCCESS) {
         drawMainBorderWithTitle("RECEIVE FILE");
@@ -113,6 +211,8 @@ void FileSharing::receiveFile() {
         padprintln("Press any key to leave");
         while (!check(AnyKeyPress)) vTaskDelay(50 / portTICK_PERIOD_MS);
         ;
+    } else {
+        delay(1000);
     }
 }
 
@@ -133,43 +233,169 @@ File FileSharing::selectFile() {
     return file;
 }
 
-bool FileSharing::appendToFile(FileSharing::Message fileMessage) {
-    FS *fs;
-    if (!getFsStorage(fs)) return false;
+uint32_t FileSharing::fileCrc(File &file) {
+    uint8_t buf[512];
+    uint32_t crc = 0;
+    file.seek(0);
+    while (file.available()) {
+        size_t bytesRead = file.read(buf, sizeof(buf));
+        crc = crc32_le(crc, buf, bytesRead);
+    }
+    file.seek(0);
+    return crc;
+}
+
+bool FileSharing::waitControlAck(
+    const uint8_t *mac, uint8_t type, uint8_t ackType, const void *payload, uint16_t len, uint32_t seq,
+    uint32_t &ackSeq
+) {
+    unsigned long start = millis();
+    unsigned long lastSent = 0;
+
+    while (millis() - start < ESP_XFER_TIMEOUT_MS) {
+        if (check(EscPress)) {
+            sendStatus = ABORTED;
+            return false;
+        }
+        if (lastSent == 0 || millis() - lastSent > ESP_XFER_CONTROL_RETRY_MS) {
+            sendFrame(mac, type, seq, payload, len);
+            lastSent = millis();
+        }
+
+        ReceivedFrame received;
+        while (frameQueue.pop(received)) {
+            const TransferFrame &frame = received.frame;
+            if (!frameValid(frame)) continue;
+            // START may be broadcast and answered by any receiver, later ones only by that receiver
+            if (type != XFER_START && memcmp(received.peer, framePeer, 6) != 0) continue;
+            if (frame.type == XFER_ABORT) return false;
+            if (frame.type == ackType) {
+                memcpy(framePeer, received.peer, 6);
+                ackSeq = frame.seq;
+                return true;
+            }
+        }
+        delay(10);
+    }
+    return false;
+}
 
-    if (recvFileName == "") createFilename(fs, fileMessage);
+bool FileSharing::handleStart(const TransferFrame &frame) {
+    setupPeer(framePeer);
+
+    // Duplicate START (our START_ACK got lost): answer again with the current position
+    if (recvStatus == STARTED) return sendFrame(framePeer, XFER_START_ACK, recvExpected);
+
+    if (!getFsStorage(recvFs)) return false;
+    memcpy(&recvInfo, frame.payload, sizeof(recvInfo));
+    recvInfo.filename[ESP_FILENAME_SIZE - 1] = '\0';
+    recvInfo.filepath[ESP_FILEPATH_SIZE - 1] = '\0';
+
+    String dir = String(recvInfo.filepath);
+    if (dir != "" && !recvFs->exists(dir)) recvFs->mkdir(dir);
+    // Partial data is named after the source CRC, so only the very same file resumes from it
+    recvPartName = dir + "/." + String(recvInfo.filename) + "." + String(recvInfo.fileCrc, HEX) + ".part";
+
+    recvExpected = 0;
+    recvBytes = 0;
+    recvCrc = 0;
+    recvPending = 0;
+
+    if (recvFs->exists(recvPartName)) {
+        File part = recvFs->open(recvPartName, FILE_READ);
+        uint32_t chunks = part.size() / ESP_XFER_PAYLOAD_SIZE;
+        // only whole chunks can be resumed, a torn write restarts the file
+        if (part.size() == chunks * ESP_XFER_PAYLOAD_SIZE || part.size() == recvInfo.totalBytes) {
+            recvCrc = fileCrc(part);
+            recvBytes = part.size();
+            recvExpected = (recvBytes + ESP_XFER_PAYLOAD_SIZE - 1) / ESP_XFER_PAYLOAD_SIZE;
+        }
+        part.close();
+        Serial.printf("Resuming %s from chunk %u\n", recvPartName.c_str(), recvExpected);
+    }
 
-    File file = (*fs).open(recvFileName, FILE_APPEND);
-    if (!file) return false;
+    recvFile = recvFs->open(recvPartName, recvExpected ? FILE_APPEND : FILE_WRITE, true);
+    if (!recvFile) return false;
 
-    file.write((const uint8_t *)fileMessage.data, fileMessage.dataSize);
-    file.close();
+    if (recvWindow == NULL) recvWindow = (uint8_t *)malloc(ESP_XFER_WINDOW * ESP_XFER_PAYLOAD_SIZE);
+    if (recvWindow == NULL) return false;
 
+    recvStatus = STARTED;
+    return sendFrame(framePeer, XFER_START_ACK, recvExpected);
+}
+
+bool FileSharing::handleData(const TransferFrame &frame) {
+    if (recvStatus != STARTED) return true; // stray frame from an earlier session
+
+    if (frame.seq >= recvExpected && frame.seq < recvExpected + ESP_XFER_WINDOW) {
+        uint8_t slot = frame.seq % ESP_XFER_WINDOW;
+        memcpy(recvWindow + slot * ESP_XFER_PAYLOAD_SIZE, frame.payload, frame.length);
+        recvWindowLen[slot] = frame.length;
+        recvPending |= 1UL << (frame.seq - recvExpected);
+
+        // Write every chunk that is now contiguous
+        while (recvPending & 1) {
+            slot = recvExpected % ESP_XFER_WINDOW;
+            uint8_t *data = recvWindow + slot * ESP_XFER_PAYLOAD_SIZE;
+            if (recvFile.write(data, recvWindowLen[slot]) != recvWindowLen[slot]) return false;
+            recvCrc = crc32_le(recvCrc, data, recvWindowLen[slot]);
+            recvBytes += recvWindowLen[slot];
+            recvExpected++;
+            recvPending >>= 1;
+        }
+    }
+
+    // Cumulative ack plus the chunks buffered after the first gap
+    uint32_t bitmap = recvPending >> 1;
+    return sendFrame(framePeer, XFER_ACK, recvExpected, &bitmap, sizeof(bitmap));
+}
+
+bool FileSharing::handleEnd(const TransferFrame &frame) {
+    if (recvStatus != STARTED) return true;
+
+    bool complete = recvExpected == frame.seq && recvBytes == recvInfo.totalBytes;
+    bool verified = complete && recvCrc == recvInfo.fileCrc;
+    closeRecvFile();
+
+    if (verified) {
+        createFilename(recvFs, recvInfo.filename, recvInfo.filepath);
+        verified = recvFs->rename(recvPartName, recvFileName);
+    } else if (complete) {
+        Serial.println("File CRC mismatch, discarding");
+        recvFs->remove(recvPartName);
+    }
+
+    sendFrame(framePeer, XFER_END_ACK, verified ? 1 : 0);
+    recvStatus = verified ? SUCCESS : FAILED;
     return true;
 }
 
-void FileSharing::createFilename(FS *fs, FileSharing::Message fileMessage) {
-    String messageFilename = String(fileMessage.filename);
-    String messageFilepath = String(fileMessage.filepath);
+void FileSharing::closeRecvFile() {
+    if (recvFile) recvFile.close();
+}
+
+void FileSharing::createFilename(FS *fs, const char *messageFilename, const char *messageFilepath) {
+    String fullFilename = String(messageFilename);
+    String filepath = String(messageFilepath);
 
-    String filename = messageFilename.substring(0, messageFilename.lastIndexOf("."));
-    String ext = messageFilename.substring(messageFilename.lastIndexOf("."));
+    String filename = fullFilename.substring(0, fullFilename.lastIndexOf("."));
+    String ext = fullFilename.substring(fullFilename.lastIndexOf("."));
 
     Serial.println("Creating filename");
     Serial.print("Path: ");
-    Serial.println(messageFilepath);
+    Serial.println(filepath);
     Serial.print("Name: ");
     Serial.println(filename);
     Serial.print("Ext: ");
     Serial.println(ext);
 
-    if (!(*fs).exists(messageFilepath)) (*fs).mkdir(messageFilepath);
-    if ((*fs).exists(messageFilepath + "/" + filename + ext)) {
+    if (!(*fs).exists(filepath)) (*fs).mkdir(filepath);
+    if ((*fs).exists(filepath + "/" + filename + ext)) {
         int i = 1;
         filename += "_";
-        while ((*fs).exists(messageFilepath + "/" + filename + String(i) + ext)) i++;
+        while ((*fs).exists(filepath + "/" + filename + String(i) + ext)) i++;
         filename += String(i);
     }
 
-    recvFileName = messageFilepath + "/" + filename + ext;
+    recvFileName = filepath + "/" + filename + ext;
 }
@@ -3,6 +3,10 @@
 
 #include "esp_connection.h"
 
+#define ESP_XFER_RTO_MS 150           // retransmit timeout for unacknowledged chunks
+#define ESP_XFER_CONTROL_RETRY_MS 500 // START / END retransmit interval
+#define ESP_XFER_TIMEOUT_MS 5000      // give up without any progress from the peer
+
 class FileSharing : public EspConnection {
 public:
     /////////////////////////////////////////////////////////////////////////////////////
@@ -18,13 +22,32 @@ public:
 
 private:
     String recvFileName;
+    String recvPartName; // partial data, kept between sessions to resume
+    FS *recvFs = NULL;
+    File recvFile;
+    TransferInfo recvInfo;
+    uint32_t recvExpected = 0;   // next chunk to be written to recvFile
+    uint32_t recvBytes = 0;      // bytes written to recvFile
+    uint32_t recvCrc = 0;        // running CRC of recvFile contents
+    uint32_t recvPending = 0;    // buffered chunks, bit 0 = recvExpected
+    uint8_t *recvWindow = NULL;  // ESP_XFER_WINDOW chunk slots, indexed by seq % ESP_XFER_WINDOW
+    uint16_t recvWindowLen[ESP_XFER_WINDOW];
 
     /////////////////////////////////////////////////////////////////////////////////////
     // Helpers
     /////////////////////////////////////////////////////////////////////////////////////
     File selectFile();
-    bool appendToFile(Message fileMessage);
-    void createFilename(FS *fs, Message fileMessage);
+    uint32_t fileCrc(File &file);
+    bool waitControlAck(
+        const uint8_t *mac, uint8_t type, uint8_t ackType, const void *payload, uint16_t len, uint32_t seq,
+        uint32_t &ackSeq
+    );
+
+    bool handleStart(const TransferFrame &frame);
+    bool handleData(const TransferFrame &frame);
+    bool handleEnd(const TransferFrame &frame);
+    void closeRecvFile();
+    void createFilename(FS *fs, const char *messageFilename, const char *messageFilepath);
 };
 
 #endif
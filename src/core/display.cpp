@@ -2,6 +2,7 @@
 #include "core/wifi/webInterface.h" // for server
 #include "core/wifi/wg.h"           //for isConnectedWireguard to print wireguard lock
 #include "mykeyboard.h"
+#include "powerSave.h"
 #include "settings.h" //for timeStr
 #include "utils.h"
 #include <JPEGDecoder.h>
@@ -103,22 +104,7 @@ void setTftDisplay(int x, int y, uint16_t fc, int size, uint16_t bg) {
 
 void turnOffDisplay() { setBrightness(0, false); }
 
-bool wakeUpScreen() {
-    previousMillis = millis();
-    if (isScreenOff) {
-        isScreenOff = false;
-        dimmer = false;
-        getBrightness();
-        vTaskDelay(pdMS_TO_TICKS(200));
-        return true;
-    } else if (dimmer) {
-        dimmer = false;
-        getBrightness();
-        vTaskDelay(pdMS_TO_TICKS(200));
-        return true;
-    }
-    return false;
-}
+bool wakeUpScreen() { return powerWake(); }
 
 /***************************************************************************************
 ** Function name: displayRedStripe
@@ -452,6 +438,8 @@ int loopOptions(
     bool exit = false;
     int menuSize = options.size();
     static unsigned long _clock_bat_timer = millis();
+    // the clock only drops while the menu waits for input, the chosen option runs at full speed
+    powerSetPolicy(POWER_POLICY_IDLE);
     if (options.size() > MAX_MENU_SIZE) { menuSize = MAX_MENU_SIZE; }
     if (index > 0)
         tft.fillRoundRect(
@@ -468,6 +456,7 @@ int loopOptions(
     while (1) {
         // Check for shutdown before drawing menu to avoid drawing a black bar on the screen
         if (exit) break;
+        bruceConfig.syncSdMirror(); // deferred config copy, SD is only touched from this task
         if (menuType == MENU_TYPE_MAIN) {
             checkReboot();
             if (millis() - _clock_bat_timer > 30000) {
@@ -572,6 +561,7 @@ int loopOptions(
                 Serial.print("Forcely ");
             }
             Serial.println("Selected: " + String(options[index].label));
+            powerSetPolicy(POWER_POLICY_PERFORMANCE);
             options[chosen].operation();
             break;
         }
@@ -588,6 +578,7 @@ int loopOptions(
         if (pressed_number >= 0) {
             if (index == pressed_number) {
                 // press 2 times the same number to confirm
+                powerSetPolicy(POWER_POLICY_PERFORMANCE);
                 options[index].operation();
                 break;
             }
@@ -601,6 +592,7 @@ int loopOptions(
         if (menuType != MENU_TYPE_MAIN && check(EscPress)) break;
 #endif
     }
+    powerSetPolicy(POWER_POLICY_PERFORMANCE);
     return index;
 }
 
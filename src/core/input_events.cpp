@@ -0,0 +1,214 @@
+#include "input_events.h"
+#include "core/powerSave.h"
+#include <globals.h>
+
+static volatile bool *const inputFlags[] = {
+    &NextPress,
+    &PrevPress,
+    &UpPress,
+    &DownPress,
+    &SelPress,
+    &EscPress,
+    &NextPagePress,
+    &PrevPagePress,
+    &AnyKeyPress,
+    &SerialCmdPress,
+};
+static constexpr size_t inputFlagCount = sizeof(inputFlags) / sizeof(inputFlags[0]);
+
+static QueueHandle_t inputQueue = NULL;
+static SemaphoreHandle_t inputMutex = NULL;
+static SemaphoreHandle_t inputSignal = NULL; // given whenever an event is queued or shown in the flags
+static TaskHandle_t inputTask = NULL;
+static volatile bool inputHasIrq = false;
+
+static uint32_t viewSince = 0; // when the flags got their current value, 0 = empty
+static uint32_t viewTime = 0;  // detection time of the event shown in the flags
+static uint16_t lastKeys = 0;
+static uint32_t lastKeysTime = 0;
+
+static uint16_t readFlags() {
+    uint16_t keys = 0;
+    for (size_t i = 0; i < inputFlagCount; i++) {
+        if (*inputFlags[i]) keys |= 1 << i;
+    }
+    if (touchPoint.pressed) keys |= INPUT_KEY_TOUCH;
+    return keys;
+}
+
+static void writeFlags(uint16_t keys) {
+    for (size_t i = 0; i < inputFlagCount; i++) *inputFlags[i] = keys & (1 << i);
+}
+
+static void clearView() {
+    writeFlags(0);
+    touchPoint.Clear();
+    viewSince = 0;
+}
+
+static void reportLatency(uint32_t detected) {
+    uint32_t latency = millis() - detected;
+    if (detected != 0 && latency > INPUT_LATENCY_WARN_MS) log_w("Input handled after %lu ms", latency);
+}
+
+void inputEventsBegin(TaskHandle_t task) {
+    if (inputQueue == NULL) inputQueue = xQueueCreate(INPUT_QUEUE_LEN, sizeof(InputEvent));
+    if (inputMutex == NULL) inputMutex = xSemaphoreCreateMutex();
+    if (inputSignal == NULL) inputSignal = xSemaphoreCreateBinary();
+    inputTask = task;
+}
+
+void inputLock() {
+    if (inputMutex) xSemaphoreTake(inputMutex, portMAX_DELAY);
+}
+
+void inputUnlock() {
+    if (inputMutex) xSemaphoreGive(inputMutex);
+}
+
+void inputNotify() {
+    if (inputTask) xTaskNotifyGive(inputTask);
+}
+
+void IRAM_ATTR inputNotifyFromISR() {
+    if (inputTask == NULL) return;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(inputTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+/*********************************************************************
+**  Function: inputAttachInterrupt
+**  Lets a button pin wake the input task, which then only polls
+**  every INPUT_IRQ_POLL_MS for the inputs that have no interrupt
+**********************************************************************/
+void inputAttachInterrupt(uint8_t pin, int mode) {
+    attachInterrupt(digitalPinToInterrupt(pin), inputNotifyFromISR, mode);
+    inputHasIrq = true;
+}
+
+TickType_t inputPollInterval() { return pdMS_TO_TICKS(inputHasIrq ? INPUT_IRQ_POLL_MS : INPUT_POLL_MS); }
+
+/*********************************************************************
+**  Function: inputPostEvent
+**  Queues an event, the oldest one is dropped when the queue is full
+**********************************************************************/
+bool inputPostEvent(uint16_t keys, uint16_t x, uint16_t y) {
+    if (inputQueue == NULL || keys == 0) return false;
+    InputEvent event = {keys, x, y, millis()};
+    if (xQueueSend(inputQueue, &event, 0) != pdTRUE) {
+        InputEvent dropped;
+        xQueueReceive(inputQueue, &dropped, 0);
+        log_w("Input queue full, dropped event %04x", dropped.keys);
+        if (xQueueSend(inputQueue, &event, 0) != pdTRUE) return false;
+    }
+    xSemaphoreGive(inputSignal);
+    inputNotify();
+    return true;
+}
+
+/*********************************************************************
+**  Function: inputPoll
+**  One iteration of the input task: reads the hardware through
+**  InputHandler(), queues what it found and refreshes the flags view
+**********************************************************************/
+void inputPoll() {
+    if (inputQueue == NULL) return;
+    inputLock();
+    // InputHandler() writes the globals, run it on a clean state and put the view back afterwards
+    uint16_t view = readFlags();
+    TouchPoint viewTouch = touchPoint;
+    clearView();
+#ifndef USE_TFT_eSPI_TOUCH
+    InputHandler();
+#endif
+    uint16_t keys = readFlags();
+    TouchPoint touch = touchPoint;
+    writeFlags(view);
+    touchPoint = viewTouch;
+    if (view && viewSince == 0) {
+        // set from outside the queue, e.g. serial/web navigation
+        viewSince = millis();
+        viewTime = 0;
+    }
+    inputUnlock();
+
+    uint32_t now = millis();
+    if (powerInWakeGuard()) keys = 0; // still the key that woke the screen
+    if (keys) {
+        bool bounce = keys == lastKeys && now - lastKeysTime < INPUT_DEBOUNCE_MS && !LongPress;
+        lastKeys = keys;
+        lastKeysTime = now;
+        if (!bounce) inputPostEvent(keys, touch.x, touch.y);
+    }
+
+    inputLock();
+    view = readFlags();
+    if (view && now - viewSince > INPUT_VIEW_TIMEOUT_MS) {
+        clearView();
+        view = 0;
+    }
+    InputEvent event;
+    if (!view && xQueueReceive(inputQueue, &event, 0) == pdTRUE) {
+        writeFlags(event.keys);
+        if (event.keys & INPUT_KEY_TOUCH) {
+            touchPoint.pressed = true;
+            touchPoint.x = event.x;
+            touchPoint.y = event.y;
+        }
+        viewSince = millis();
+        viewTime = event.time;
+        xSemaphoreGive(inputSignal);
+    }
+    inputUnlock();
+}
+
+/*********************************************************************
+**  Function: inputWaitEvent
+**  Blocks until the next event or the timeout. Takes the event shown
+**  in the flags first, so presses are never seen twice
+**********************************************************************/
+bool inputWaitEvent(InputEvent &event, uint32_t timeoutMs) {
+    if (inputQueue == NULL) return false;
+    uint32_t start = millis();
+    for (;;) {
+        inputLock();
+        uint16_t view = readFlags();
+        bool found = false;
+        if (view) {
+            event = {view, touchPoint.x, touchPoint.y, viewTime};
+            clearView();
+            found = true;
+        } else if (xQueueReceive(inputQueue, &event, 0) == pdTRUE) {
+            found = true;
+        }
+        inputUnlock();
+        if (found) {
+            reportLatency(event.time);
+            inputNotify();
+            return true;
+        }
+
+        uint32_t elapsed = millis() - start;
+        if (elapsed >= timeoutMs) return false;
+        xSemaphoreTake(inputSignal, pdMS_TO_TICKS(timeoutMs - elapsed));
+    }
+}
+
+/*********************************************************************
+**  Function: inputConsume
+**  check() backend: an event is handled once, so the whole view is
+**  cleared with the flag and the next queued event can come in
+**********************************************************************/
+bool inputConsume(volatile bool &btn) {
+    if (!btn) return false;
+    inputLock();
+    bool pressed = btn;
+    if (pressed) {
+        reportLatency(viewTime);
+        clearView();
+    }
+    inputUnlock();
+    if (pressed) inputNotify();
+    return pressed;
+}
@@ -0,0 +1,54 @@
+#ifndef __INPUT_EVENTS_H__
+#define __INPUT_EVENTS_H__
+
+#include <Arduino.h>
+
+// The input task turns what InputHandler() reports into timestamped events in a queue.
+// The NextPress/SelPress/... flags are kept as a view of the oldest event not consumed yet:
+// the next event is only moved into the flags once they are consumed by check() or expire.
+#define INPUT_QUEUE_LEN 16
+#define INPUT_POLL_MS 10          // polling interval when the board has no input interrupts
+#define INPUT_IRQ_POLL_MS 50      // idle polling when interrupts wake the task
+#define INPUT_DEBOUNCE_MS 40      // same keys reported again within this window are dropped
+#define INPUT_VIEW_TIMEOUT_MS 150 // flags nobody checks are cleared after this
+#define INPUT_LATENCY_WARN_MS 100
+
+enum InputKey : uint16_t {
+    INPUT_KEY_NEXT = 1 << 0,
+    INPUT_KEY_PREV = 1 << 1,
+    INPUT_KEY_UP = 1 << 2,
+    INPUT_KEY_DOWN = 1 << 3,
+    INPUT_KEY_SEL = 1 << 4,
+    INPUT_KEY_ESC = 1 << 5,
+    INPUT_KEY_NEXT_PAGE = 1 << 6,
+    INPUT_KEY_PREV_PAGE = 1 << 7,
+    INPUT_KEY_ANY = 1 << 8,
+    INPUT_KEY_SERIAL = 1 << 9,
+    INPUT_KEY_TOUCH = 1 << 10,
+};
+
+struct InputEvent {
+    uint16_t keys; // InputKey bitmask
+    uint16_t x;    // touch coordinates, valid with INPUT_KEY_TOUCH
+    uint16_t y;
+    uint32_t time; // millis() when the input was detected
+};
+
+void inputEventsBegin(TaskHandle_t task);
+void inputPoll();
+TickType_t inputPollInterval();
+
+// Wakes the input task early, ISR variant for boards that attach their buttons with inputAttachInterrupt()
+void inputNotify();
+void IRAM_ATTR inputNotifyFromISR();
+void inputAttachInterrupt(uint8_t pin, int mode = CHANGE);
+
+bool inputPostEvent(uint16_t keys, uint16_t x = 0, uint16_t y = 0);
+bool inputWaitEvent(InputEvent &event, uint32_t timeoutMs);
+bool inputConsume(volatile bool &btn);
+
+// Serializes access to the input globals with the input task
+void inputLock();
+void inputUnlock();
+
+#endif
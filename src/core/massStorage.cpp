@@ -2,14 +2,44 @@
 
 #include "massStorage.h"
 #include "core/display.h"
+#include "core/mscSectorCache.h"
 #include <USB.h>
 
+extern "C" {
+#include "ff.h"
+
+#include "diskio_impl.h"
+}
+
 bool MassStorage::shouldStop = false;
 
+// SD keeps the FatFs drive of the card protected, multi-sector transfers go straight to it
+struct SdDrive : public SDFS {
+    static uint8_t of(SDFS &fs) { return fs.*(&SdDrive::_pdrv); }
+};
+
+static SemaphoreHandle_t mscLock = nullptr;
+static uint8_t mscDrive = 0;
+static uint32_t mscSecSize = 0;
+static uint32_t mscNumSectors = 0;
+static uint32_t writeLast = 0;
+
+static bool diskRead(uint8_t *buffer, uint32_t lba, uint32_t count) {
+    return ff_disk_read(mscDrive, buffer, lba, count) == RES_OK;
+}
+
+static bool diskWrite(const uint8_t *buffer, uint32_t lba, uint32_t count) {
+    return ff_disk_write(mscDrive, buffer, lba, count) == RES_OK;
+}
+
+static MscSectorCache mscCache(diskRead, diskWrite);
+
 MassStorage::MassStorage() { setup(); }
 
 MassStorage::~MassStorage() {
+    usbFlush(false);
     msc.end();
+    freeCache();
     USB.~ESPUSB();
 
     // Hack to make USB back to flash mode
@@ -34,20 +64,34 @@ void MassStorage::setup() {
 }
 
 void MassStorage::loop() {
-    while (!check(EscPress) && !shouldStop) yield();
+    while (!check(EscPress) && !shouldStop) {
+        usbFlush(true);
+        yield();
+    }
 }
 
 void MassStorage::beginUsb() {
+    if (!setupCache()) Serial.println("MSC: no memory for the sector cache, using direct transfers");
     setupUsbCallback();
     setupUsbEvent();
     drawUSBStickIcon(false);
     USB.begin();
 }
 
-void MassStorage::setupUsbCallback() {
-    uint32_t secSize = SD.sectorSize();
-    uint32_t numSectors = SD.numSectors();
+bool MassStorage::setupCache() {
+    if (!mscLock) mscLock = xSemaphoreCreateMutex();
+
+    mscDrive = SdDrive::of(SD);
+    mscSecSize = SD.sectorSize();
+    mscNumSectors = SD.numSectors();
+
+    // without the buffers every request is still a single multi-block transfer
+    return mscCache.begin(mscSecSize, mscNumSectors);
+}
+
+void MassStorage::freeCache() { mscCache.end(); }
 
+void MassStorage::setupUsbCallback() {
     msc.vendorID("ESP32");
     msc.productID("BRUCE");
     msc.productRevision("1.0");
@@ -57,7 +101,7 @@ void MassStorage::setupUsbCallback() {
     msc.onStartStop(usbStartStopCallback);
 
     msc.mediaPresent(true);
-    msc.begin(numSectors, secSize);
+    msc.begin(mscNumSectors, mscSecSize);
 }
 
 void MassStorage::setupUsbEvent() {
@@ -67,7 +111,10 @@ void MassStorage::setupUsbEvent() {
             switch (event_id) {
                 case ARDUINO_USB_STARTED_EVENT: drawUSBStickIcon(true); break;
                 case ARDUINO_USB_STOPPED_EVENT: drawUSBStickIcon(false); break;
-                case ARDUINO_USB_SUSPEND_EVENT: MassStorage::displayMessage("USB suspend"); break;
+                case ARDUINO_USB_SUSPEND_EVENT:
+                    usbFlush(false);
+                    MassStorage::displayMessage("USB suspend");
+                    break;
                 case ARDUINO_USB_RESUME_EVENT: MassStorage::displayMessage("USB resume"); break;
                 default: break;
             }
@@ -82,43 +129,39 @@ void MassStorage::displayMessage(String message) {
 }
 
 int32_t usbWriteCallback(uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize) {
-    // Verify freespace
-    uint64_t freeSpace = SD.totalBytes() - SD.usedBytes();
-    if (bufsize > freeSpace) {
-        return -1; // no space available
-    }
-
     // Verify sector size
-    const uint32_t secSize = SD.sectorSize();
-    if (secSize == 0) return -1; // disk error
-
-    // Write blocs
-    for (uint32_t x = 0; x < bufsize / secSize; ++x) {
-        uint8_t blkBuffer[secSize];
-        memcpy(blkBuffer, buffer + secSize * x, secSize);
-        if (!SD.writeRAW(blkBuffer, lba + x)) {
-            return -1; // write error
-        }
-    }
-    return bufsize;
+    if (mscSecSize == 0) return -1; // disk error
+
+    // Verify bounds
+    const uint32_t count = bufsize / mscSecSize;
+    if (lba + count > mscNumSectors) return -1; // no space available
+
+    // Write blocs, combined with the previous ones when contiguous
+    xSemaphoreTake(mscLock, portMAX_DELAY);
+    bool ok = mscCache.write(lba, buffer, count);
+    writeLast = millis();
+    xSemaphoreGive(mscLock);
+    return ok ? bufsize : -1;
 }
 
 int32_t usbReadCallback(uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize) {
     // Verify sector size
-    const uint32_t secSize = SD.sectorSize();
-    if (secSize == 0) return -1; // disk error
+    if (mscSecSize == 0) return -1; // disk error
 
-    // Read blocs
-    for (uint32_t x = 0; x < bufsize / secSize; ++x) {
-        if (!SD.readRAW(reinterpret_cast<uint8_t *>(buffer) + (x * secSize), lba + x)) {
-            return -1; // read error
-        }
-    }
-    return bufsize;
+    // Verify bounds
+    const uint32_t count = bufsize / mscSecSize;
+    if (lba + count > mscNumSectors) return -1; // read error
+
+    // Read blocs, from the read-ahead window when sequential
+    xSemaphoreTake(mscLock, portMAX_DELAY);
+    bool ok = mscCache.read(lba, reinterpret_cast<uint8_t *>(buffer), count);
+    xSemaphoreGive(mscLock);
+    return ok ? bufsize : -1;
 }
 
 bool usbStartStopCallback(uint8_t power_condition, bool start, bool load_eject) {
     if (!start && load_eject) {
+        usbFlush(false);
         MassStorage::setShouldStop(true);
         return false;
     }
@@ -126,6 +169,20 @@ bool usbStartStopCallback(uint8_t power_condition, bool start, bool load_eject)
     return true;
 }
 
+bool usbFlush(bool idleOnly) {
+    if (!mscLock) return true;
+    // the idle flush runs from the UI loop and never waits on a transfer in progress
+    if (xSemaphoreTake(mscLock, idleOnly ? 0 : portMAX_DELAY) != pdTRUE) return true;
+
+    bool ok = true;
+    if (mscCache.pending() && (!idleOnly || millis() - writeLast >= MSC_FLUSH_IDLE_MS)) {
+        ok = mscCache.flush();
+        ok = ff_disk_ioctl(mscDrive, CTRL_SYNC, nullptr) == RES_OK && ok;
+    }
+    xSemaphoreGive(mscLock);
+    return ok;
+}
+
 void drawUSBStickIcon(bool plugged) {
     MassStorage::displayMessage("");
 
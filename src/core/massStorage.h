@@ -6,6 +6,8 @@
 #include <USBMSC.h>
 #include <globals.h>
 
+#define MSC_FLUSH_IDLE_MS 250 // combined writes go to the card after this long without a new one
+
 class MassStorage {
 public:
     static bool shouldStop;
@@ -41,11 +43,14 @@ private:
     void beginUsb(void);
     void setupUsbCallback(void);
     void setupUsbEvent(void);
+    bool setupCache(void);
+    void freeCache(void);
 };
 
 int32_t usbWriteCallback(uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize);
 int32_t usbReadCallback(uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize);
 bool usbStartStopCallback(uint8_t power_condition, bool start, bool load_eject);
+bool usbFlush(bool idleOnly);
 
 void drawUSBStickIcon(bool plugged);
 
@@ -43,6 +43,7 @@ void ConfigMenu::optionsMenu() {
 #if defined(HAS_NS4168_SPKR)
         {"Sound Volume", setSoundVolume},
 #endif
+        {"BadUSB Delay", setBadUsbReportMs},
         {"Startup WiFi", setWifiStartupConfig},
         {"Startup App", setStartupApp},
         {"Hide/Show Apps", []() { mainMenu.hideAppsMenu(); }},
@@ -50,11 +51,21 @@ void ConfigMenu::optionsMenu() {
         {"Clock", setClock},
         {"Sleep", setSleepMode},
         {"Factory Reset", [=]() { bruceConfig.factoryReset(); }},
-        {"Restart", [=]() { ESP.restart(); }},
+        {"Restart",
+         [=]() {
+             bruceConfig.commit();
+             ESP.restart();
+         }},
     };
 
-    options.push_back({"Turn-off", powerOff});
-    options.push_back({"Deep Sleep", goToDeepSleep});
+    options.push_back({"Turn-off", [=]() {
+                           bruceConfig.commit();
+                           powerOff();
+                       }});
+    options.push_back({"Deep Sleep", [=]() {
+                           bruceConfig.commit();
+                           goToDeepSleep();
+                       }});
 
     if (bruceConfig.devMode) options.push_back({"Dev Mode", [=]() { devMenu(); }});
 
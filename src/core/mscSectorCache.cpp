@@ -0,0 +1,100 @@
+#include "mscSectorCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool overlaps(uint32_t lba, uint32_t count, uint32_t otherLba, uint32_t otherCount) {
+    return lba < otherLba + otherCount && otherLba < lba + count;
+}
+
+MscSectorCache::MscSectorCache(MscDiskRead diskRead, MscDiskWrite diskWrite)
+    : diskRead(diskRead), diskWrite(diskWrite) {}
+
+MscSectorCache::~MscSectorCache() { end(); }
+
+bool MscSectorCache::begin(uint32_t sectorSize, uint32_t sectors) {
+    end();
+    secSize = sectorSize;
+    numSectors = sectors;
+    readNextLba = UINT32_MAX;
+    readCache = (uint8_t *)malloc(MSC_CACHE_SECTORS * secSize);
+    writeBuffer = (uint8_t *)malloc(MSC_WRITE_SECTORS * secSize);
+    return readCache && writeBuffer;
+}
+
+void MscSectorCache::end() {
+    free(readCache);
+    free(writeBuffer);
+    readCache = nullptr;
+    writeBuffer = nullptr;
+    readCacheCount = 0;
+    writeCount = 0;
+}
+
+/*********************************************************************
+**  Function: flush
+**  Writes the combined sectors to the card
+**********************************************************************/
+bool MscSectorCache::flush() {
+    if (writeCount == 0) return true;
+    bool ok = diskWrite(writeBuffer, writeLba, writeCount);
+    writeCount = 0;
+    return ok;
+}
+
+/*********************************************************************
+**  Function: read
+**  Serves the sectors from the read-ahead window when the host reads
+**  sequentially, the card never returns sectors still in writeBuffer
+**********************************************************************/
+bool MscSectorCache::read(uint32_t lba, uint8_t *buffer, uint32_t count) {
+    if (overlaps(lba, count, writeLba, writeCount) && !flush()) return false;
+
+    bool sequential = lba == readNextLba;
+    readNextLba = lba + count;
+
+    while (count > 0) {
+        if (readCacheCount > 0 && lba >= readCacheLba && lba < readCacheLba + readCacheCount) {
+            uint32_t n = readCacheLba + readCacheCount - lba;
+            if (n > count) n = count;
+            memcpy(buffer, readCache + (lba - readCacheLba) * secSize, n * secSize);
+            lba += n;
+            buffer += n * secSize;
+            count -= n;
+            continue;
+        }
+        if (readCache && sequential && count < MSC_CACHE_SECTORS) {
+            uint32_t n = numSectors - lba;
+            if (n > MSC_CACHE_SECTORS) n = MSC_CACHE_SECTORS;
+            // the window reaches past the request, it must not pick up the old data of pending writes
+            if (overlaps(lba, n, writeLba, writeCount) && !flush()) return false;
+            readCacheCount = 0;
+            if (!diskRead(readCache, lba, n)) return false;
+            readCacheLba = lba;
+            readCacheCount = n;
+            continue;
+        }
+        return diskRead(buffer, lba, count);
+    }
+    return true;
+}
+
+/*********************************************************************
+**  Function: write
+**  Combines contiguous writes, flushed when full or when the host
+**  jumps elsewhere
+**********************************************************************/
+bool MscSectorCache::write(uint32_t lba, const uint8_t *buffer, uint32_t count) {
+    if (overlaps(lba, count, readCacheLba, readCacheCount)) readCacheCount = 0;
+
+    if (writeCount > 0 && (lba != writeLba + writeCount || writeCount + count > MSC_WRITE_SECTORS)) {
+        if (!flush()) return false;
+    }
+    if (!writeBuffer || count >= MSC_WRITE_SECTORS) return diskWrite(buffer, lba, count);
+
+    if (writeCount == 0) writeLba = lba;
+    memcpy(writeBuffer + writeCount * secSize, buffer, count * secSize);
+    writeCount += count;
+    if (writeCount == MSC_WRITE_SECTORS) return flush();
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef __MSC_SECTOR_CACHE_H__
+#define __MSC_SECTOR_CACHE_H__
+
+#include <stdint.h>
+
+#define MSC_CACHE_SECTORS 16 // sectors read ahead when the host reads sequentially
+#define MSC_WRITE_SECTORS 16 // contiguous sectors combined into one card write
+
+// Multi-sector transfers on the card, ff_disk_read/ff_disk_write on the device
+typedef bool (*MscDiskRead)(uint8_t *buffer, uint32_t lba, uint32_t count);
+typedef bool (*MscDiskWrite)(const uint8_t *buffer, uint32_t lba, uint32_t count);
+
+// Sectors the host reads or writes go through here, so that a run of contiguous sectors is one
+// multi-block command (CMD18/CMD25) instead of one command per sector. Does not depend on Arduino
+// so it can be checked on the host against a RAM disk.
+class MscSectorCache {
+public:
+    MscSectorCache(MscDiskRead diskRead, MscDiskWrite diskWrite);
+    ~MscSectorCache();
+
+    // false when the buffers could not be allocated, every request is then a direct transfer
+    bool begin(uint32_t secSize, uint32_t numSectors);
+    void end();
+
+    bool read(uint32_t lba, uint8_t *buffer, uint32_t count);
+    bool write(uint32_t lba, const uint8_t *buffer, uint32_t count);
+    bool flush();
+    bool pending() const { return writeCount > 0; }
+
+private:
+    MscDiskRead diskRead;
+    MscDiskWrite diskWrite;
+    uint32_t secSize = 0;
+    uint32_t numSectors = 0;
+
+    uint8_t *readCache = nullptr; // read-ahead window
+    uint32_t readCacheLba = 0;
+    uint32_t readCacheCount = 0;
+    uint32_t readNextLba = UINT32_MAX; // where the host continues if it reads sequentially
+
+    uint8_t *writeBuffer = nullptr; // contiguous writes not yet on the card
+    uint32_t writeLba = 0;
+    uint32_t writeCount = 0;
+};
+
+#endif // __MSC_SECTOR_CACHE_H__
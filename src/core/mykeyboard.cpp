@@ -43,11 +43,10 @@ static box_t box_list[box_count];
 // reseting the value after used
 keyStroke _getKeyPress() {
 #ifndef USE_TFT_eSPI_TOUCH
-    vTaskSuspend(xHandle);
+    inputLock();
     keyStroke key = KeyStroke;
     KeyStroke.Clear();
-    delay(10);
-    vTaskResume(xHandle);
+    inputUnlock();
     return key;
 #else
     keyStroke key = KeyStroke;
@@ -5,60 +5,170 @@
 /* Check if it's time to put the device to sleep */
 #define SCREEN_OFF_DELAY 5000
 
-void fadeOutScreen(int startValue) {
-    for (int brightValue = startValue; brightValue >= 0; brightValue -= 1) {
-        setBrightness(max(brightValue, 0), false);
-        delay(5);
+// Brightness ramps are advanced by checkPowerSaveTime() on every input task tick,
+// so dimming never blocks input polling
+struct BrightnessRamp {
+    bool active = false;
+    int from = 0;
+    int to = 0;
+    int current = -1;
+    unsigned long start = 0;
+    unsigned long duration = 0;
+};
+
+static SemaphoreHandle_t powerMutex = NULL;
+static BrightnessRamp ramp;
+static PowerState state = POWER_ACTIVE;
+static PowerPolicy policy = POWER_POLICY_PERFORMANCE;
+static PowerPolicy policyBeforeSleep = POWER_POLICY_PERFORMANCE;
+static unsigned long wokeAt = 0;
+
+static void powerLock() {
+    if (powerMutex == NULL) powerMutex = xSemaphoreCreateMutex();
+    xSemaphoreTake(powerMutex, portMAX_DELAY);
+}
+
+static void powerUnlock() { xSemaphoreGive(powerMutex); }
+
+static void applyCpuPolicy() {
+    bool idle = (state == POWER_SCREEN_OFF || state == POWER_SLEEP) && !ramp.active;
+    uint32_t mhz = idle && policy == POWER_POLICY_IDLE ? POWER_IDLE_CPU_MHZ : POWER_ACTIVE_CPU_MHZ;
+    if (getCpuFrequencyMhz() != mhz) setCpuFrequencyMhz(mhz);
+}
+
+static void setState(PowerState next) {
+    state = next;
+    dimmer = next == POWER_DIMMED || next == POWER_SCREEN_OFF;
+    isScreenOff = next == POWER_SCREEN_OFF;
+    isSleeping = next == POWER_SLEEP;
+}
+
+static void startRamp(int to, unsigned long duration) {
+    ramp.from = ramp.current >= 0 ? ramp.current : bruceConfig.bright;
+    ramp.to = to;
+    ramp.start = millis();
+    ramp.duration = duration;
+    ramp.active = true;
+}
+
+static void stepRamp() {
+    if (!ramp.active) return;
+    unsigned long elapsed = millis() - ramp.start;
+    int value = ramp.to;
+    if (elapsed < ramp.duration) {
+        value = ramp.from + (ramp.to - ramp.from) * (long)elapsed / (long)ramp.duration;
+    } else {
+        ramp.active = false;
     }
-    turnOffDisplay();
+
+    if (value != ramp.current) {
+        ramp.current = value;
+        _setBrightness(value);
+    }
+    if (!ramp.active) applyCpuPolicy();
 }
 
+void fadeOutScreen(int startValue) {
+    powerLock();
+    ramp.current = startValue;
+    startRamp(0, POWER_FADE_MS);
+    powerUnlock();
+}
+
+/*********************************************************************
+**  Function: checkPowerSaveTime
+**  Power state machine, ticked by the input task
+**********************************************************************/
 void checkPowerSaveTime() {
-    if (bruceConfig.dimmerSet == 0) return;
+    powerLock();
+    stepRamp();
+    if (bruceConfig.dimmerSet == 0 || state == POWER_SLEEP) return powerUnlock();
 
     unsigned long elapsed = millis() - previousMillis;
-    int startDimmerBright = bruceConfig.bright / 3;
-    int dimmerSetMs = bruceConfig.dimmerSet * 1000;
-
-    if (elapsed >= dimmerSetMs && !dimmer && !isSleeping) {
-        dimmer = true;
-        setBrightness(startDimmerBright, false);
-    } else if (elapsed >= (dimmerSetMs + SCREEN_OFF_DELAY) && !isScreenOff && !isSleeping) {
-        isScreenOff = true;
-        fadeOutScreen(startDimmerBright);
+    unsigned long dimmerSetMs = bruceConfig.dimmerSet * 1000;
+
+    if (state == POWER_ACTIVE && elapsed >= dimmerSetMs) {
+        setState(POWER_DIMMED);
+        startRamp(bruceConfig.bright / 3, POWER_DIM_MS);
+    } else if (state == POWER_DIMMED && elapsed >= dimmerSetMs + SCREEN_OFF_DELAY) {
+        setState(POWER_SCREEN_OFF);
+        startRamp(0, POWER_FADE_MS);
     }
+    powerUnlock();
 }
 
-void sleepModeOn() {
-    isSleeping = true;
-    setCpuFrequencyMhz(80);
+/*********************************************************************
+**  Function: powerWake
+**  Restores the brightness at once, returns true when the screen was
+**  dimmed or off, so the key that woke it is not used as a press
+**********************************************************************/
+bool powerWake() {
+    previousMillis = millis();
+    if (state != POWER_DIMMED && state != POWER_SCREEN_OFF) return false;
+
+    powerLock();
+    bool woke = state == POWER_DIMMED || state == POWER_SCREEN_OFF;
+    if (woke) {
+        ramp.active = false;
+        ramp.current = -1;
+        setState(POWER_ACTIVE);
+        applyCpuPolicy();
+        getBrightness();
+        wokeAt = millis();
+    }
+    powerUnlock();
+    return woke;
+}
 
-    int startDimmerBright = bruceConfig.bright / 3;
+bool powerRampActive() { return ramp.active; }
 
-    fadeOutScreen(startDimmerBright);
+bool powerInWakeGuard() { return wokeAt != 0 && millis() - wokeAt < POWER_WAKE_GUARD_MS; }
 
+PowerState powerState() { return state; }
 
-    panelSleep(true); //  power down screen
+void powerSetPolicy(PowerPolicy newPolicy) {
+    if (newPolicy == policy) return;
+    powerLock();
+    policy = newPolicy;
+    applyCpuPolicy();
+    powerUnlock();
+}
+
+void sleepModeOn() {
+    powerLock();
+    // Sleep waits for a key with the watchdogs off, always at the idle clock whatever the menu asked for
+    policyBeforeSleep = policy;
+    policy = POWER_POLICY_IDLE;
+    setState(POWER_SLEEP);
+    ramp.current = bruceConfig.bright / 3;
+    startRamp(0, POWER_FADE_MS);
+    powerUnlock();
+
+    // the input task runs the fade, the panel goes off once it is dark
+    while (powerRampActive()) vTaskDelay(pdMS_TO_TICKS(POWER_RAMP_STEP_MS));
 
+    panelSleep(true); //  power down screen
 
     disableCore0WDT();
     disableCore1WDT();
     disableLoopWDT();
-    delay(200);
 }
 
 void sleepModeOff() {
-    isSleeping = false;
-    setCpuFrequencyMhz(240);
-
+    powerLock();
+    ramp.active = false;
+    ramp.current = -1;
+    setState(POWER_ACTIVE);
+    policy = policyBeforeSleep;
+    applyCpuPolicy();
+    powerUnlock();
 
     panelSleep(false); // wake the screen back up
 
-
     getBrightness();
     enableCore0WDT();
     enableCore1WDT();
     enableLoopWDT();
     feedLoopWDT();
-    delay(200);
+    previousMillis = millis();
 }
@@ -1,6 +1,31 @@
+#ifndef __POWER_SAVE_H__
+#define __POWER_SAVE_H__
+
 #include "display.h"
 #include <globals.h>
 
+// Screen power states, mirrored in the dimmer / isScreenOff / isSleeping globals
+enum PowerState {
+    POWER_ACTIVE,
+    POWER_DIMMED,
+    POWER_SCREEN_OFF,
+    POWER_SLEEP,
+};
+
+// PERFORMANCE keeps the CPU at full speed, so modules running with the screen off are never throttled.
+// IDLE lowers the clock while the screen is off, only the menus waiting for input opt into it
+enum PowerPolicy {
+    POWER_POLICY_PERFORMANCE,
+    POWER_POLICY_IDLE,
+};
+
+#define POWER_DIM_MS 200         // ramp to the dimmed brightness
+#define POWER_FADE_MS 500        // ramp to screen off
+#define POWER_RAMP_STEP_MS 10    // input task tick while a ramp runs
+#define POWER_WAKE_GUARD_MS 200  // input ignored after the key that woke the screen
+#define POWER_IDLE_CPU_MHZ 80
+#define POWER_ACTIVE_CPU_MHZ 240
+
 void checkPowerSaveTime();
 
 void sleepModeOn();
@@ -8,3 +33,15 @@ void sleepModeOn();
 void sleepModeOff();
 
 void fadeOutScreen(int startValue);
+
+bool powerWake();
+
+bool powerRampActive();
+
+bool powerInWakeGuard();
+
+PowerState powerState();
+
+void powerSetPolicy(PowerPolicy policy);
+
+#endif
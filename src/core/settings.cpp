@@ -1,6 +1,7 @@
 #include "settings.h"
 #include "core/wifi/wifi_common.h"
 #include "display.h"
+#include "input_events.h"
 #include "modules/others/qrcode_menu.h"
 #include "modules/rf/rf_utils.h" // for initRfModule
 #include "mykeyboard.h"
@@ -154,13 +155,16 @@ void setBrightnessMenu() {
 **********************************************************************/
 void setSleepMode() {
     sleepModeOn();
-    while (1) {
-        if (check(AnyKeyPress)) {
-            sleepModeOff();
-            returnToMenu = true;
-            break;
-        }
-    }
+#ifndef USE_TFT_eSPI_TOUCH
+    // sleeps on the input queue until a key comes, instead of spinning on check()
+    InputEvent event;
+    while (!inputWaitEvent(event, 1000)) {}
+#else
+    // touch is read by check() itself on these boards
+    while (!check(AnyKeyPress)) vTaskDelay(pdMS_TO_TICKS(10));
+#endif
+    sleepModeOff();
+    returnToMenu = true;
 }
 
 /*********************************************************************
@@ -856,6 +860,32 @@ void setIrTxRepeats() {
 
     bruceConfig.setIrTxRepeats(chRpts);
 }
+
+/*********************************************************************
+**  Function: setBadUsbReportMs
+**  Set the delay between HID reports sent by BadUSB/BadBLE
+**********************************************************************/
+void setBadUsbReportMs() {
+    int reportMs = bruceConfig.badUsbReportMs;
+
+    options = {
+        {"Fast (2ms)",    [&]() { reportMs = 2; },  bruceConfig.badUsbReportMs == 2 },
+        {"Default (4ms)", [&]() { reportMs = 4; },  bruceConfig.badUsbReportMs == 4 },
+        {"Safe (10ms)",   [&]() { reportMs = 10; }, bruceConfig.badUsbReportMs == 10},
+        {"Custom",        [&]() {
+             // 1 to 100 ms, anything else falls back to the default
+             String ms = keyboard(String(bruceConfig.badUsbReportMs), 3, "Report delay (1-100 ms)");
+             if (ms.length() > 0) reportMs = ms.toInt();
+         }                                                                         },
+    };
+    addOptionToMainMenu();
+
+    loopOptions(options);
+
+    if (returnToMenu) return;
+
+    bruceConfig.setBadUsbReportMs(reportMs);
+}
 /*********************************************************************
 **  Function: gsetIrRxPin
 **  get or set IR Rx Pin
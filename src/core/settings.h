@@ -53,6 +53,8 @@ int gsetIrTxPin(bool set = false);
 
 void setIrTxRepeats();
 
+void setBadUsbReportMs();
+
 int gsetIrRxPin(bool set = false);
 
 int gsetRfTxPin(bool set = false);
@@ -469,6 +469,7 @@ void configureWebServer() {
     // Reinicia o ESP
     server->on("/reboot", HTTP_GET, [](AsyncWebServerRequest *request) {
         if (checkUserWebAuth(request)) {
+            bruceConfig.commit(false);
             ESP.restart();
         } else {
             request->requestAuthentication();
@@ -49,32 +49,12 @@ keyStroke KeyStroke;
 
 TaskHandle_t xHandle;
 void __attribute__((weak)) taskInputHandler(void *parameter) {
-    auto timer = millis();
     while (true) {
         checkPowerSaveTime();
-        // Sometimes this task run 2 or more times before looptask,
-        // and navigation gets stuck, the idea here is run the input detection
-        // if AnyKeyPress is false, or rerun if it was not renewed within 75ms (arbitrary)
-        // because AnyKeyPress will be true if didn´t passed through a check(bool var)
-        if (!AnyKeyPress || millis() - timer > 75) {
-            NextPress = false;
-            PrevPress = false;
-            UpPress = false;
-            DownPress = false;
-            SelPress = false;
-            EscPress = false;
-            AnyKeyPress = false;
-            SerialCmdPress = false;
-            NextPagePress = false;
-            PrevPagePress = false;
-            touchPoint.pressed = false;
-            touchPoint.Clear();
-#ifndef USE_TFT_eSPI_TOUCH
-            InputHandler();
-#endif
-            timer = millis();
-        }
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Presses are queued by inputPoll() and shown in NextPress, SelPress... one at a time,
+        // the task sleeps until a button interrupt, a consumed press or the next poll interval
+        inputPoll();
+        ulTaskNotifyTake(pdTRUE, powerRampActive() ? pdMS_TO_TICKS(POWER_RAMP_STEP_MS) : inputPollInterval());
     }
 }
 // Public Globals Variables
@@ -420,8 +400,9 @@ void setup() {
         4096,             // Stack size
         NULL,             // Task parameters
         2,                // Task priority (0 to 3), loopTask has priority 2.
-        &xHandle          // Task handle (not used)
+        &xHandle          // Task handle
     );
+    inputEventsBegin(xHandle);
     // #endif
     bruceConfig.openThemeFile(bruceConfig.themeFS(), bruceConfig.themePath);
     if (!bruceConfig.instantBoot) {
@@ -476,6 +457,7 @@ void loop() {
     }
 #endif
     tft.fillScreen(bruceConfig.bgColor);
+    bruceConfig.syncSdMirror();
 
     mainMenu.begin();
     delay(1);
@@ -511,6 +493,7 @@ void loop() {
 
     // Enable navigation through webUI
     tft.fillScreen(bruceConfig.bgColor);
+    bruceConfig.syncSdMirror();
     mainMenu.begin();
     vTaskDelay(10 / portTICK_PERIOD_MS);
 }
@@ -10,6 +10,7 @@
 #endif
 
 extern RF24 NRFradio;
+extern SPIClass *NRFSPI;
 
 bool nrf_start();
 
@@ -5,7 +5,6 @@
 
 #define CHANNELS 80
 #define RGB565(r, g, b) ((((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)))
-uint8_t channel[CHANNELS];
 
 // Register Access Functions
 inline byte getRegister(SPIClass &SSPI, byte r) {
@@ -25,36 +24,74 @@ inline void setRegister(SPIClass &SSPI, byte r, byte v) {
 
 inline void powerDown(SPIClass &SSPI) { setRegister(SSPI, 0x00, getRegister(SSPI, 0x00) & ~0x02); }
 
-// Scanning Channels
-#define _BW tftWidth / CHANNELS
-String scanChannels(SPIClass *SSPI, bool web) {
-    String result = "{";
+#define NRF_SPECTRUM_PASSES 4 // sweeps folded into each displayed frame
+#define NRF_SPECTRUM_FULL 200  // level of a channel busy on every pass
+
+// Filled by the scan, read by the screen
+struct NrfSpectrum {
+    uint8_t level[CHANNELS]; // decay averaged share of passes with a carrier, 0..NRF_SPECTRUM_FULL
+    uint32_t frames;
+};
+static NrfSpectrum spectrum;
+static portMUX_TYPE spectrumMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t scanTask = nullptr;
+static volatile bool scanRunning = false;
+
+// One sweep of the 80 channels, adds the carrier detections to passHits
+static void scanPass(uint8_t *passHits) {
     digitalWrite(NRF24_CE_PIN, LOW);
     for (int i = 0; i < CHANNELS; i++) {
         NRFradio.setChannel(i);
         NRFradio.startListening();
         delayMicroseconds(128);
         NRFradio.stopListening();
-        int rpd = 0;
-        if (NRFradio.testCarrier()) rpd = 200;
-        channel[i] = (channel[i] * 3 + rpd) / 4;
-
-        int level = (channel[i] > 125) ? 125 : channel[i]; // Clamp values
-
-        tft.drawFastVLine(i * _BW, 0, 125, (i % 8) ? TFT_BLACK : RGB565(25, 25, 25));
-        tft.drawFastVLine(
-            i * _BW, tftHeight - (10 + level), level, (i % 2 == 0) ? bruceConfig.priColor : TFT_DARKGREY
-        ); // Use green for even indices
-        tft.drawFastVLine(i * _BW, 0, tftHeight - (9 + level), (i % 8) ? TFT_BLACK : RGB565(25, 25, 25));
-        tft.drawFastVLine(i * _BW, 0, rpd ? 2 : 0, TFT_DARKGREY);
-        if (web) {
-            if (i > 0) result += ",";
-            result += String(level);
-        }
+        if (NRFradio.testCarrier()) passHits[i]++;
+    }
+}
+
+/*********************************************************************
+**  Function: scanFrame
+**  Several sweeps per frame: the level of a channel is the share of
+**  sweeps that saw a carrier on it, not a single RPD bit
+**********************************************************************/
+static void scanFrame() {
+    uint8_t passHits[CHANNELS] = {};
+    for (int p = 0; p < NRF_SPECTRUM_PASSES; p++) scanPass(passHits);
+
+    portENTER_CRITICAL(&spectrumMux);
+    for (int i = 0; i < CHANNELS; i++) {
+        uint8_t share = passHits[i] * NRF_SPECTRUM_FULL / NRF_SPECTRUM_PASSES;
+        spectrum.level[i] = (spectrum.level[i] * 3 + share) / 4;
     }
-    if (web) result += "}";
-    return result; // return a string in this format "{1,32,45,32,84,32 .... 12,54,65}" with 80 values to be
-                   // used in the WebUI (Future)
+    spectrum.frames++;
+    portEXIT_CRITICAL(&spectrumMux);
+}
+
+// param is the task waiting for the scan to end, notified right before the task deletes itself
+static void scanTaskMain(void *param) {
+    while (scanRunning) {
+        scanFrame();
+        vTaskDelay(1); // lets the idle task feed the watchdog
+    }
+    xTaskNotifyGive((TaskHandle_t)param);
+    vTaskDelete(NULL);
+}
+
+static void copySpectrum(NrfSpectrum &out) {
+    portENTER_CRITICAL(&spectrumMux);
+    out = spectrum;
+    portEXIT_CRITICAL(&spectrumMux);
+}
+
+// Scanning Channels
+#define _BW tftWidth / CHANNELS
+static void drawChannel(int i, int level, bool busy) {
+    tft.drawFastVLine(i * _BW, 0, 125, (i % 8) ? TFT_BLACK : RGB565(25, 25, 25));
+    tft.drawFastVLine(
+        i * _BW, tftHeight - (10 + level), level, (i % 2 == 0) ? bruceConfig.priColor : TFT_DARKGREY
+    ); // Use green for even indices
+    tft.drawFastVLine(i * _BW, 0, tftHeight - (9 + level), (i % 8) ? TFT_BLACK : RGB565(25, 25, 25));
+    tft.drawFastVLine(i * _BW, 0, busy ? 2 : 0, TFT_DARKGREY);
 }
 
 void nrf_spectrum(SPIClass *SSPI) {
@@ -63,7 +100,6 @@ void nrf_spectrum(SPIClass *SSPI) {
     tft.drawString("2.40Ghz", 0, tftHeight - LH);
     tft.drawCentreString("2.44Ghz", tftWidth / 2, tftHeight - LH, 1);
     tft.drawRightString("2.48Ghz", tftWidth, tftHeight - LH, 1);
-    memset(channel, 0, CHANNELS);
 
     if (nrf_start()) {
         NRFradio.setAutoAck(false);
@@ -80,7 +116,48 @@ void nrf_spectrum(SPIClass *SSPI) {
         for (uint8_t i = 0; i < 6; ++i) { NRFradio.openReadingPipe(i, noiseAddress[i]); }
         NRFradio.setDataRate(RF24_1MBPS);
 
-        while (!check(EscPress)) { scanChannels(SSPI); }
+        memset(&spectrum, 0, sizeof(spectrum));
+        // the scan can't run beside the drawing when the radio shares the display bus
+        bool ownBus = true;
+#if TFT_MOSI > 0
+        ownBus = NRFSPI != &tft.getSPIinstance();
+#endif
+        scanRunning = ownBus;
+        if (ownBus) {
+            ulTaskNotifyTake(pdTRUE, 0); // drop a stale notification so the join below waits for this task
+            if (xTaskCreate(scanTaskMain, "nrfScan", 4096, xTaskGetCurrentTaskHandle(), 1, &scanTask) !=
+                pdPASS) {
+                scanTask = nullptr;
+                scanRunning = false;
+            }
+        }
+
+        uint8_t drawn[CHANNELS];
+        memset(drawn, 0xFF, sizeof(drawn));
+        uint32_t lastFrame = 0;
+        NrfSpectrum snap;
+        while (!check(EscPress)) {
+            if (scanTask == nullptr) scanFrame();
+            copySpectrum(snap);
+            if (snap.frames == lastFrame) {
+                delay(5);
+                continue;
+            }
+            lastFrame = snap.frames;
+            // only the channels whose bar changed
+            for (int i = 0; i < CHANNELS; i++) {
+                uint8_t level = min<uint8_t>(snap.level[i], 125);
+                if (level == drawn[i]) continue;
+                drawChannel(i, level, snap.level[i] > 0);
+                drawn[i] = level;
+            }
+        }
+        // the radio can't be powered down while the task may still be in a sweep
+        scanRunning = false;
+        if (scanTask != nullptr) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            scanTask = nullptr;
+        }
         NRFradio.stopListening();
         powerDown(*SSPI); //
         delay(250);
@@ -0,0 +1,360 @@
+#include "ducky_script.h"
+#include "core/display.h"
+#include "core/mykeyboard.h"
+#include <globals.h>
+
+// same encoding as the keyboard layouts and HIDInterface::press()
+#define LAYOUT_SHIFT 0x80
+#define LAYOUT_ALT_GR 0xc0
+#define LAYOUT_ISO_KEY 0x64
+#define LAYOUT_ISO_REPLACEMENT 0x32
+#define DUCKY_NO_LINE ((size_t)-1)
+
+// what the screen shows for a DuckyOp_Line
+enum DuckyLineKind : uint8_t { DuckyLine_Command, DuckyLine_Unsupported, DuckyLine_Note };
+
+const DuckyCombination duckyComb[]{
+    {"CTRL-ALT",       KEY_LEFT_CTRL, KEY_LEFT_ALT,   0             },
+    {"CTRL-SHIFT",     KEY_LEFT_CTRL, KEY_LEFT_SHIFT, 0             },
+    {"CTRL-GUI",       KEY_LEFT_CTRL, KEY_LEFT_GUI,   0             },
+    {"CTRL-ESCAPE",    KEY_LEFT_CTRL, KEY_ESC,        0             },
+    {"ALT-SHIFT",      KEY_LEFT_ALT,  KEY_LEFT_SHIFT, 0             },
+    {"ALT-GUI",        KEY_LEFT_ALT,  KEY_LEFT_GUI,   0             },
+    {"GUI-SHIFT",      KEY_LEFT_GUI,  KEY_LEFT_SHIFT, 0             },
+    {"GUI-SPACE",      KEY_LEFT_GUI,  KEY_SPACE,      0             },
+    {"CTRL-ALT-SHIFT", KEY_LEFT_CTRL, KEY_LEFT_ALT,   KEY_LEFT_SHIFT},
+    {"CTRL-ALT-GUI",   KEY_LEFT_CTRL, KEY_LEFT_ALT,   KEY_LEFT_GUI  },
+    {"ALT-SHIFT-GUI",  KEY_LEFT_ALT,  KEY_LEFT_SHIFT, KEY_LEFT_GUI  },
+    {"CTRL-SHIFT-GUI", KEY_LEFT_CTRL, KEY_LEFT_SHIFT, KEY_LEFT_GUI  }
+};
+const size_t duckyCombCount = sizeof(duckyComb) / sizeof(duckyComb[0]);
+
+const DuckyCommand duckyCmds[]{
+    {"STRING",         0,                DuckyCommandType_Print      },
+    {"STRINGLN",       0,                DuckyCommandType_Print      },
+    {"REM",            0,                DuckyCommandType_Comment    },
+    {"DELAY",          0,                DuckyCommandType_Delay      },
+    {"DEFAULTDELAY",   DEF_DELAY,        DuckyCommandType_Delay      },
+    {"REPEAT",         0,                DuckyCommandType_Loop       },
+    {"CTRL-ALT",       0,                DuckyCommandType_Combination},
+    {"CTRL-SHIFT",     0,                DuckyCommandType_Combination},
+    {"CTRL-GUI",       0,                DuckyCommandType_Combination},
+    {"CTRL-ESCAPE",    0,                DuckyCommandType_Combination},
+    {"ALT-SHIFT",      0,                DuckyCommandType_Combination},
+    {"ALT-GUI",        0,                DuckyCommandType_Combination},
+    {"GUI-SHIFT",      0,                DuckyCommandType_Combination},
+    {"GUI-SPACE",      0,                DuckyCommandType_Combination},
+    {"CTRL-ALT-SHIFT", 0,                DuckyCommandType_Combination},
+    {"CTRL-ALT-GUI",   0,                DuckyCommandType_Combination},
+    {"ALT-SHIFT-GUI",  0,                DuckyCommandType_Combination},
+    {"CTRL-SHIFT-GUI", 0,                DuckyCommandType_Combination},
+    {"BACKSPACE",      KEYBACKSPACE,     DuckyCommandType_Cmd        },
+    {"DELETE",         KEY_DELETE,       DuckyCommandType_Cmd        },
+    {"ALT",            KEY_LEFT_ALT,     DuckyCommandType_Cmd        },
+    {"CTRL",           KEY_LEFT_CTRL,    DuckyCommandType_Cmd        },
+    {"GUI",            KEY_LEFT_GUI,     DuckyCommandType_Cmd        },
+    {"SHIFT",          KEY_LEFT_SHIFT,   DuckyCommandType_Cmd        },
+    {"ESCAPE",         KEY_ESC,          DuckyCommandType_Cmd        },
+    {"TAB",            KEYTAB,           DuckyCommandType_Cmd        },
+    {"ENTER",          KEY_RETURN,       DuckyCommandType_Cmd        },
+    {"DOWNARROW",      KEY_DOWN_ARROW,   DuckyCommandType_Cmd        },
+    {"DOWN",           KEY_DOWN_ARROW,   DuckyCommandType_Cmd        },
+    {"LEFTARROW",      KEY_LEFT_ARROW,   DuckyCommandType_Cmd        },
+    {"LEFT",           KEY_LEFT_ARROW,   DuckyCommandType_Cmd        },
+    {"RIGHTARROW",     KEY_RIGHT_ARROW,  DuckyCommandType_Cmd        },
+    {"RIGHT",          KEY_RIGHT_ARROW,  DuckyCommandType_Cmd        },
+    {"UPARROW",        KEY_UP_ARROW,     DuckyCommandType_Cmd        },
+    {"UP",             KEY_UP_ARROW,     DuckyCommandType_Cmd        },
+    {"BREAK",          KEY_PAUSE,        DuckyCommandType_Cmd        },
+    {"CAPSLOCK",       KEY_CAPS_LOCK,    DuckyCommandType_Cmd        },
+    {"PAUSE",          KEY_PAUSE,        DuckyCommandType_Cmd        },
+    {"END",            KEY_END,          DuckyCommandType_Cmd        },
+    {"HOME",           KEY_HOME,         DuckyCommandType_Cmd        },
+    {"INSERT",         KEY_INSERT,       DuckyCommandType_Cmd        },
+    {"NUMLOCK",        LED_NUMLOCK,      DuckyCommandType_Cmd        },
+    {"PAGEUP",         KEY_PAGE_UP,      DuckyCommandType_Cmd        },
+    {"PAGEDOWN",       KEY_PAGE_DOWN,    DuckyCommandType_Cmd        },
+    {"PRINTSCREEN",    KEY_PRINT_SCREEN, DuckyCommandType_Cmd        },
+    {"SCROLLOCK",      KEY_SCROLL_LOCK,  DuckyCommandType_Cmd        },
+    {"MENU",           KEY_MENU,         DuckyCommandType_Cmd        },
+    {"F1",             KEY_F1,           DuckyCommandType_Cmd        },
+    {"F2",             KEY_F2,           DuckyCommandType_Cmd        },
+    {"F3",             KEY_F3,           DuckyCommandType_Cmd        },
+    {"F4",             KEY_F4,           DuckyCommandType_Cmd        },
+    {"F5",             KEY_F5,           DuckyCommandType_Cmd        },
+    {"F6",             KEY_F6,           DuckyCommandType_Cmd        },
+    {"F7",             KEY_F7,           DuckyCommandType_Cmd        },
+    {"F8",             KEY_F8,           DuckyCommandType_Cmd        },
+    {"F9",             KEY_F9,           DuckyCommandType_Cmd        },
+    {"F10",            KEY_F10,          DuckyCommandType_Cmd        },
+    {"F11",            KEY_F11,          DuckyCommandType_Cmd        },
+    {"F12",            KEY_F12,          DuckyCommandType_Cmd        },
+    {"SPACE",          KEY_SPACE,        DuckyCommandType_Cmd        }
+};
+const size_t duckyCmdsCount = sizeof(duckyCmds) / sizeof(duckyCmds[0]);
+
+const DuckyCommand *duckyFindCommand(const char *name) {
+    for (size_t i = 0; i < duckyCmdsCount; i++) {
+        if (strcmp(name, duckyCmds[i].command) == 0) return &duckyCmds[i];
+    }
+    return nullptr;
+}
+
+const DuckyCombination *duckyFindCombination(const char *name) {
+    for (size_t i = 0; i < duckyCombCount; i++) {
+        if (strcmp(name, duckyComb[i].command) == 0) return &duckyComb[i];
+    }
+    return nullptr;
+}
+
+/*********************************************************************
+**  Function: toStroke
+**  Modifier mask and usage code that press(k) would send
+**********************************************************************/
+bool DuckyScript::toStroke(char k, DuckyStroke &s) const {
+    uint8_t c = k;
+    s = {};
+    if (c >= 0xE0 && c < 0xE8) {
+        s.key = c;
+    } else if (c >= 0x88) { // non-printing key
+        s.key = c - 0x88;
+    } else if (c >= 0x80) { // modifier
+        s.modifiers = 1 << (c - 0x80);
+    } else { // printing key, through the layout
+        c = layout[c];
+        if (!c) return false;
+        if ((c & LAYOUT_ALT_GR) == LAYOUT_ALT_GR) {
+            s.modifiers = 0x40; // AltGr = right Alt
+            c &= 0x3F;
+        } else if ((c & LAYOUT_SHIFT) == LAYOUT_SHIFT) {
+            s.modifiers = 0x02; // left shift
+            c &= 0x7F;
+        }
+        if (c == LAYOUT_ISO_REPLACEMENT) c = LAYOUT_ISO_KEY;
+        s.key = c;
+    }
+    return true;
+}
+
+void DuckyScript::addText(const String &text) {
+    DuckyOp op = {};
+    op.type = DuckyOp_Text;
+    op.arg = stroke.size();
+    for (size_t i = 0; i < text.length(); i++) {
+        DuckyStroke s;
+        // print() skips carriage returns and characters the layout lacks
+        if (text[i] != '\r' && toStroke(text[i], s) && s.key != 0) stroke.push_back(s);
+    }
+    op.count = stroke.size() - op.arg;
+    if (op.count > 0) ops.push_back(op);
+}
+
+void DuckyScript::clear() {
+    ops.clear();
+    ops.shrink_to_fit();
+    stroke.clear();
+    stroke.shrink_to_fit();
+    lines = "";
+}
+
+/*********************************************************************
+**  Function: compileLine
+**  Same commands and fallbacks key_input always had, looked up once
+**********************************************************************/
+void DuckyScript::compileLine(const String &line, size_t &lineStart) {
+    int space = line.indexOf(' ');
+    String command = space > 0 ? line.substring(0, space) : line;
+    String argument = space > 0 ? line.substring(space + 1) : "";
+
+    DuckyOp lineOp = {};
+    lineOp.type = DuckyOp_Line;
+    lineOp.arg = lines.length();
+
+    if (command == "REPEAT") {
+        DuckyOp op = {};
+        op.type = DuckyOp_Repeat;
+        op.arg = min(argument.toInt(), (long)DUCKY_MAX_REPEAT);
+        op.count = lineStart;
+        if ((int32_t)op.arg <= 0) {
+            lineOp.kind = DuckyLine_Note;
+            command = argument.length() > 0 ? "REPEAT argument NaN, repeating once"
+                                            : "REPEAT without argument, repeating once";
+            argument = "";
+            op.arg = 1;
+        }
+        lineOp.count = command.length();
+        lines += command + " " + argument + "\n";
+        ops.push_back(lineOp);
+        // a REPEAT repeats the last line that is not one, if there is any
+        if (lineStart != DUCKY_NO_LINE) ops.push_back(op);
+        return;
+    }
+
+    const DuckyCommand *cmd = duckyFindCommand(command.c_str());
+    lineOp.kind = cmd != nullptr ? DuckyLine_Command : DuckyLine_Unsupported;
+    lineOp.count = command.length();
+    lines += command + " " + argument + "\n";
+    lineStart = ops.size();
+    ops.push_back(lineOp);
+
+    if (cmd == nullptr) {
+        addText(argument.length() > 0 ? command + " " + argument + "\n" : command + "\n");
+    } else if (cmd->type == DuckyCommandType_Print) {
+        addText(strcmp(cmd->command, "STRINGLN") == 0 ? argument + "\n" : argument);
+    } else if (cmd->type == DuckyCommandType_Delay) {
+        DuckyOp op = {};
+        op.type = DuckyOp_Delay;
+        op.arg = cmd->key > 0 || argument.toInt() <= 0 ? DEF_DELAY : argument.toInt();
+        ops.push_back(op);
+    } else if (cmd->type == DuckyCommandType_Cmd || cmd->type == DuckyCommandType_Combination) {
+        DuckyOp op = {};
+        op.type = DuckyOp_Chord;
+        op.arg = stroke.size();
+        DuckyStroke s;
+        if (cmd->type == DuckyCommandType_Cmd) {
+            if (toStroke(cmd->key, s)) stroke.push_back(s);
+        } else {
+            const DuckyCombination *comb = duckyFindCombination(cmd->command);
+            const char combKeys[3] = {comb->key1, comb->key2, comb->key3};
+            for (char k : combKeys) {
+                if (k != 0 && toStroke(k, s)) stroke.push_back(s);
+            }
+        }
+        // the argument is another key command or a character pressed with it
+        const DuckyCommand *argCmd = duckyFindCommand(argument.c_str());
+        if (argCmd != nullptr) {
+            if (argCmd->type == DuckyCommandType_Cmd && toStroke(argCmd->key, s)) stroke.push_back(s);
+        } else if (argument.length() > 0 && toStroke(argument[0], s)) {
+            stroke.push_back(s);
+        }
+        op.count = stroke.size() - op.arg;
+        ops.push_back(op);
+    }
+}
+
+bool DuckyScript::compile(File &payload, const uint8_t *keyLayout) {
+    clear();
+    if (!payload || keyLayout == nullptr) return false;
+    layout = keyLayout;
+    size_t lineStart = DUCKY_NO_LINE;
+    while (payload.available()) {
+        // CRLF is a combination of two control characters: the "Carriage Return" represented by
+        // the character "\r" and the "Line Feed" represented by the character "\n".
+        String line = payload.readStringUntil('\n');
+        if (line.endsWith("\r")) line.remove(line.length() - 1);
+        compileLine(line, lineStart);
+    }
+    log_d("Ducky: %zu ops, %zu keystrokes", ops.size(), stroke.size());
+    return true;
+}
+
+/*********************************************************************
+**  Function: send
+**  Reports go out no closer than the interval, the HID driver already
+**  waits for the host to take each one
+**********************************************************************/
+void DuckyScript::send(uint8_t modifiers, const uint8_t *keys) {
+    uint32_t elapsed = micros() - lastReport;
+    if (elapsed < intervalUs) delayMicroseconds(intervalUs - elapsed);
+    hid->sendKeys(modifiers, keys);
+    lastReport = micros();
+}
+
+void DuckyScript::release() {
+    static const uint8_t none[6] = {};
+    send(0, none);
+    held = {};
+}
+
+// One key more per report, in the order press() was called for them
+void DuckyScript::chord(const DuckyStroke *s, uint32_t count) {
+    uint8_t keys[6] = {};
+    uint8_t pressed = 0;
+    uint8_t modifiers = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        modifiers |= s[i].modifiers;
+        if (s[i].key != 0 && pressed < 6) keys[pressed++] = s[i].key;
+        send(modifiers, keys);
+    }
+    release();
+}
+
+/*********************************************************************
+**  Function: type
+**  The report pressing a key also releases the one before it: the host
+**  still gets a single new key per report, so the order is kept with
+**  half the reports. A repeated key or another modifier mask needs a
+**  release report in between.
+**********************************************************************/
+void DuckyScript::type(const DuckyStroke *s, uint32_t count) {
+    uint8_t keys[6] = {};
+    for (uint32_t i = 0; i < count; i++) {
+        if (held.key != 0 && (held.key == s[i].key || held.modifiers != s[i].modifiers)) release();
+        keys[0] = s[i].key;
+        send(s[i].modifiers, keys);
+        held = s[i];
+    }
+    if (held.key != 0) release();
+}
+
+void DuckyScript::showLine(const DuckyOp &op) {
+    String command = lines.substring(op.arg, op.arg + op.count);
+    String argument = lines.substring(op.arg + op.count + 1, lines.indexOf('\n', op.arg));
+    if (op.kind == DuckyLine_Command) {
+        tft.setTextColor(bruceConfig.priColor);
+        tft.print(command);
+    } else {
+        tft.setTextColor(ALCOLOR);
+        tft.print(command);
+        if (op.kind == DuckyLine_Unsupported) tft.println(" -> Not Supported, running as STRINGLN");
+    }
+    if (argument.length() > 0) {
+        tft.setTextColor(TFT_WHITE);
+        tft.println(argument);
+    } else tft.println();
+}
+
+// Plays ops[from, to), false when the user leaves
+bool DuckyScript::play(size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+        const DuckyOp &op = ops[i];
+        switch (op.type) {
+            case DuckyOp_Line:
+                previousMillis = millis(); // resets DimScreen
+                if (check(SelPress)) {
+                    while (check(SelPress)); // hold the code in this position until release the btn
+                    options = {
+                        {"Continue", yield},
+                    };
+                    addOptionToMainMenu();
+                    loopOptions(options);
+                    if (returnToMenu) return false;
+                    tft.setTextSize(FP);
+                }
+                showLine(op);
+                break;
+            case DuckyOp_Chord: chord(&stroke[op.arg], op.count); break;
+            case DuckyOp_Text: type(&stroke[op.arg], op.count); break;
+            case DuckyOp_Delay: delay(op.arg); break;
+            case DuckyOp_Repeat: {
+                size_t end = op.count + 1;
+                while (end < ops.size() && ops[end].type != DuckyOp_Line) end++;
+                for (uint32_t r = 0; r < op.arg; r++) {
+                    if (!play(op.count, end)) return false;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void DuckyScript::run(HIDInterface *keyboard, uint16_t reportMs) {
+    hid = keyboard;
+    intervalUs = reportMs * 1000UL;
+    lastReport = micros() - intervalUs;
+    held = {};
+    hid->releaseAll();
+    play(0, ops.size());
+    hid->releaseAll();
+}
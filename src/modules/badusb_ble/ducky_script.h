@@ -0,0 +1,102 @@
+#ifndef __DUCKY_SCRIPT_H
+#define __DUCKY_SCRIPT_H
+#include <Arduino.h>
+#include <Bad_Usb_Lib.h>
+#include <FS.h>
+#include <vector>
+
+#define DEF_DELAY 100
+#define DUCKY_MAX_REPEAT 10000
+
+enum DuckyCommandType {
+    DuckyCommandType_Unknown,
+    DuckyCommandType_Cmd,
+    DuckyCommandType_Print,
+    DuckyCommandType_Delay,
+    DuckyCommandType_Comment,
+    DuckyCommandType_Loop,
+    DuckyCommandType_Combination
+};
+
+struct DuckyCommand {
+    const char *command;
+    char key;
+    DuckyCommandType type;
+};
+
+struct DuckyCombination {
+    const char *command;
+    char key1;
+    char key2;
+    char key3;
+};
+
+extern const DuckyCommand duckyCmds[];
+extern const size_t duckyCmdsCount;
+extern const DuckyCombination duckyComb[];
+extern const size_t duckyCombCount;
+
+const DuckyCommand *duckyFindCommand(const char *name);
+const DuckyCombination *duckyFindCombination(const char *name);
+
+enum DuckyOpType : uint8_t {
+    DuckyOp_Line,   // start of a script line, arg/count: its command in the line pool
+    DuckyOp_Chord,  // arg/count: keys in the stroke pool, pressed together then released
+    DuckyOp_Text,   // arg/count: keystrokes in the stroke pool, typed one after the other
+    DuckyOp_Delay,  // arg: milliseconds
+    DuckyOp_Repeat, // arg: times, count: first op of the line played again
+};
+
+struct DuckyStroke {
+    uint8_t modifiers;
+    uint8_t key; // HID usage code, 0 for a modifier alone
+};
+
+struct DuckyOp {
+    DuckyOpType type;
+    uint8_t kind; // DuckyOp_Line: how the screen shows the line
+    uint32_t arg;
+    uint32_t count;
+};
+
+/*
+ * A payload translated once into HID reports for the keyboard layout, so
+ * typing it is only sending reports: no String parsing or table lookups while
+ * it runs, and no fixed delays between key down and key up.
+ */
+class DuckyScript {
+public:
+    // Translates the payload with the layout of the keyboard, false if the file can't be read
+    bool compile(File &payload, const uint8_t *layout);
+    void clear();
+
+    // Types the payload, sending a report at most every reportMs
+    void run(HIDInterface *hid, uint16_t reportMs);
+
+    size_t strokes() const { return stroke.size(); }
+
+private:
+    const uint8_t *layout = nullptr;
+    std::vector<DuckyOp> ops;
+    std::vector<DuckyStroke> stroke;
+    String lines; // "Command\tArgument\n" of each line, for the screen log
+
+    // state of the report stream while running
+    HIDInterface *hid = nullptr;
+    uint32_t intervalUs = 0;
+    uint32_t lastReport = 0;
+    DuckyStroke held = {};
+
+    bool toStroke(char k, DuckyStroke &s) const;
+    void addText(const String &text);
+    void compileLine(const String &line, size_t &lineStart);
+
+    void send(uint8_t modifiers, const uint8_t *keys);
+    void release();
+    void chord(const DuckyStroke *s, uint32_t count);
+    void type(const DuckyStroke *s, uint32_t count);
+    void showLine(const DuckyOp &op);
+    bool play(size_t from, size_t to);
+};
+
+#endif
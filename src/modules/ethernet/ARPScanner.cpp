@@ -7,6 +7,7 @@
 
 #include "ARPScanner.h"
 #include "ARPSpoofer.h"
+#include "ARPSweeper.h"
 #include "ARPoisoner.h"
 #include "HostInfo.h"
 #include "core/display.h"
@@ -51,15 +52,6 @@ void toBytes(IPAddress ip, uint8_t *bytes) {
     bytes[3] = ip[3];
 }
 
-void ARPScanner::readArpTableETH(netif *iface) {
-    for (uint32_t i = 0; i < ARP_TABLE_SIZE; ++i) {
-        ip4_addr_t *ip_ret;
-        eth_addr *eth_ret;
-        if (etharp_get_entry(i, &ip_ret, &iface, &eth_ret)) { hostslist_eth.emplace_back(ip_ret, eth_ret); }
-    }
-    etharp_cleanup_netif(iface);
-}
-
 #include "ARPSpoofer.h"
 #include "esp_netif.h"
 #include "esp_ping.h"
@@ -100,8 +92,11 @@ void ping_target(ip_addr_t target) {
     }
 }
 
-void ARPScanner::setup() {
-
+/*********************************************************************
+**  Function: sweepHosts
+**  Fills hostslist_eth from an ARP sweep of the interface subnet
+**********************************************************************/
+void ARPScanner::sweepHosts(ARPSweeper &sweeper, bool onlyStale) {
     hostslist_eth.clear();
 
     // IPAddress uint32_t op returns number in big-endian
@@ -115,78 +110,53 @@ void ARPScanner::setup() {
         gateway = ip_info.gw.addr;
     } else {
         Serial.println("Can't get IP informations");
+        return;
     }
 
     const uint32_t networkAddress = ntohl(gateway) & ip_info.netmask.addr;
     const uint32_t broadcast = networkAddress | ~ip_info.netmask.addr;
-
-    // get iface
-    struct netif *net_iface = (struct netif *)esp_netif_get_netif_impl(esp_net_interface);
-    etharp_cleanup_netif(net_iface); // to avoid gateway duplication
-
-    // send arp requests, read table each ARP_TABLE_SIZE requests
-    uint16_t tableReadCounter = 0;
-    uint32_t hostsScanned = 0;
-    const uint32_t totalHosts = broadcast - networkAddress - 1;
     static uint32_t lastUpdate = 0;
 
-    for (uint32_t ip_le = networkAddress + 1; ip_le < broadcast; ip_le++) {
-        if (ip_le == ip_info.ip.addr || ip_le == gateway) continue;
-
-        ip4_addr_t ip_be{htonl(ip_le)}; // big endian
-
-        hostsScanned++;
-        if (millis() - lastUpdate > 500) { // Update display every 500ms
-            displayRedStripe(
-                "Probing " + String(hostsScanned) + " of " + String(totalHosts) + " hosts",
-                getComplementaryColor2(bruceConfig.priColor),
-                bruceConfig.priColor
-            );
-            lastUpdate = millis();
-        }
-
-        err_t res = etharp_request(net_iface, &ip_be);
-
-        if (res != ERR_OK) {
-            Serial.println("Arp req for: " + IPAddress(ip_be.addr).toString() + "failed with ec: " + res);
-        } else {
-            ++tableReadCounter;
-        }
-
-        vTaskDelay(arpRequestDelay);
-
-        // read table if we sent ARP_TABLE_SIZE requests
-        if (tableReadCounter == ARP_TABLE_SIZE) {
-            readArpTableETH(net_iface);
-            tableReadCounter = 0;
-        }
-    }
-
-    auto it = std::find_if(hostslist_eth.begin(), hostslist_eth.end(), [this](const Host &host) {
-        return host.ip == gateway;
-    });
-
-    // Sometimes happens that gateway is not scanned, so force ping and then read again ARP table
-    if (it == hostslist_eth.end()) {
+    std::vector<ARPEntry> found =
+        sweeper.sweep(networkAddress + 1, broadcast - 1, onlyStale, [](uint32_t done, uint32_t total) {
+            if (millis() - lastUpdate > 500) { // Update display every 500ms
+                displayRedStripe(
+                    "Probing " + String(done) + " of " + String(total) + " hosts",
+                    getComplementaryColor2(bruceConfig.priColor),
+                    bruceConfig.priColor
+                );
+                lastUpdate = millis();
+            }
+        });
+
+    ARPEntry gatewayEntry;
+    if (!sweeper.lookup(gateway, gatewayEntry)) {
+        // Sometimes happens that gateway is not scanned, so force ping, the reply comes after an ARP exchange
         ip_addr_t target;
         target.type = IPADDR_TYPE_V4;
         target.u_addr.ip4.addr = gateway;
+        wait_ping = true;
         ping_target(target); // Ping target to force ARP request
 
         while (wait_ping) { delay(1); }
 
-        struct eth_addr *eth_ret = NULL;
-        const ip4_addr_t *ipaddr_ret = NULL;
-        ip4_addr_t gateway_ip;
-        gateway_ip.addr = gateway;
-
-        // Search gateway in the ARP table
-        s8_t arp_find_result = etharp_find_addr(net_iface, &gateway_ip, &eth_ret, &ipaddr_ret);
-
-        if (arp_find_result < 0) { Serial.println("Gateway MAC not found."); }
+        if (sweeper.lookup(gateway, gatewayEntry)) found.push_back(gatewayEntry);
+        else Serial.println("Gateway MAC not found.");
+    }
 
-        readArpTableETH(net_iface); // Update hostlists
+    for (const ARPEntry &entry : found) {
+        if (ntohl(entry.ip) == ip_info.ip.addr) continue;
+        ip4_addr_t ip{entry.ip};
+        eth_addr eth;
+        memcpy(eth.addr, entry.mac, sizeof(eth.addr));
+        hostslist_eth.emplace_back(&ip, &eth);
     }
+}
+
+void ARPScanner::setup() {
+    struct netif *net_iface = (struct netif *)esp_netif_get_netif_impl(esp_net_interface);
+    ARPSweeper sweeper(net_iface);
+    sweepHosts(sweeper, true);
 
 ScanHostMenu:
     if (hostslist_eth.empty()) {
@@ -195,17 +165,23 @@ ScanHostMenu:
         return;
     }
 
+    bool resweep = false;
     options = {};
     for (auto host : hostslist_eth) {
         String result = host.ip.toString();
         if (host.ip == gateway) result += "(GTW)";
         options.push_back({result.c_str(), [=]() { afterScanOptions(host); }});
     }
+    options.push_back({"Re-sweep", [&]() { resweep = true; }});
     addOptionToMainMenu();
 
     loopOptions(options);
     options.clear();
 
+    if (resweep) {
+        sweepHosts(sweeper, true);
+        goto ScanHostMenu;
+    }
     if (!returnToMenu) goto ScanHostMenu;
     hostslist_eth.clear();
 }
@@ -241,12 +217,7 @@ void ARPScanner::afterScanOptions(const Host &host) {
     int opt = 0;
     IPAddress gw = gateway;
     options = {
-        {"Host info",
-         [=]() {
-             HostInfo(
-                 host, wifiConnected
-             ); // At this point we are sure that if user use WiFi is connected for sure
-         }},
+        {"Host info", [=]() { HostInfo info(host); }},
 #ifndef LITE_VERSION
         {"SSH Connect", lambdaHelper(ssh_setup, host.ip.toString())},
 #endif
@@ -2,6 +2,7 @@
 #define ARP_SCANNER_H
 
 #include "Arduino.h"
+#include "ARPSweeper.h"
 #include "IPAddress.h"
 #include "modules/wifi/scan_hosts.h"
 #include "stdint.h"
@@ -11,11 +12,9 @@
 class ARPScanner {
 private:
     esp_netif_t *esp_net_interface;
-    TickType_t arpRequestDelay =
-        20u / portTICK_PERIOD_MS; // can be relatively low, helps to not overwhelm the stream
 
     void setup();
-    void readArpTableETH(netif *iface);
+    void sweepHosts(ARPSweeper &sweeper, bool onlyStale);
     IPAddress gateway;
 
     std::vector<Host> hostslist_eth;
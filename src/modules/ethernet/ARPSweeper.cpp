@@ -0,0 +1,180 @@
+/**
+ * @file ARPSweeper.cpp
+ * @brief Paced ARP sweep with replies captured from the netif input path
+ */
+
+#include "ARPSweeper.h"
+#include "lwip/etharp.h"
+#include "lwip/prot/ethernet.h"
+
+#define ETH_HDRLEN 14
+#define ARP_PACKET_LEN 42 // Ethernet + ARP headers
+
+// One slot per subnet address, indexed by host order IP - arpTableBase
+struct ARPSlot {
+    uint8_t mac[6];
+    uint32_t seen; // millis() of the last ARP packet from this host, 0 = never
+};
+
+static ARPSlot *arpTable = nullptr;
+static uint32_t arpTableBase = 0;
+static uint32_t arpTableSize = 0;
+static volatile uint32_t arpTableDropped = 0;
+static netif *arpTableIface = nullptr;
+static netif_input_fn originalInput = nullptr;
+static netif *hookedIface = nullptr;
+static portMUX_TYPE arpTableMux = portMUX_INITIALIZER_UNLOCKED;
+
+/*********************************************************************
+**  Function: arpRecord
+**  Stores the sender in its slot, called from the WiFi/Ethernet driver task
+**********************************************************************/
+static void arpRecord(uint32_t ip, const uint8_t *mac) {
+    if (ip == 0) return;
+    uint32_t now = millis();
+    bool stored = false;
+    portENTER_CRITICAL(&arpTableMux);
+    uint32_t offset = ntohl(ip) - arpTableBase;
+    if (arpTable != nullptr && offset < arpTableSize) {
+        memcpy(arpTable[offset].mac, mac, 6);
+        arpTable[offset].seen = now | 1; // never 0, that marks an empty slot
+        stored = true;
+    }
+    portEXIT_CRITICAL(&arpTableMux);
+    if (!stored) arpTableDropped++;
+}
+
+static err_t arpSweepInput(struct pbuf *p, struct netif *inp) {
+    if (p != nullptr && p->len >= ARP_PACKET_LEN) {
+        const uint8_t *frame = (const uint8_t *)p->payload;
+        uint16_t type = (frame[12] << 8) | frame[13];
+        if (type == ETHTYPE_ARP) {
+            // requests announce the sender as well as replies do
+            const uint8_t *arp = frame + ETH_HDRLEN;
+            uint32_t senderIp;
+            memcpy(&senderIp, arp + 14, 4);
+            arpRecord(senderIp, arp + 8);
+        }
+    }
+    return originalInput(p, inp);
+}
+
+ARPSweeper::ARPSweeper(netif *iface) : iface(iface) {
+    if (iface == nullptr) return;
+
+    // network and broadcast addresses get a slot too, the table stays a plain offset lookup
+    uint32_t mask = ntohl(ip4_addr_get_u32(netif_ip4_netmask(iface)));
+    uint32_t base = ntohl(ip4_addr_get_u32(netif_ip4_addr(iface))) & mask;
+    uint32_t size = ~mask + 1;
+    if (size == 0 || size > ARP_SWEEP_MAX_HOSTS + 2) size = ARP_SWEEP_MAX_HOSTS + 2;
+    if (arpTable == nullptr || arpTableIface != iface || arpTableBase != base || arpTableSize != size) {
+        portENTER_CRITICAL(&arpTableMux);
+        ARPSlot *old = arpTable;
+        arpTable = nullptr;
+        arpTableSize = 0;
+        portEXIT_CRITICAL(&arpTableMux);
+        free(old);
+
+        ARPSlot *table = (ARPSlot *)calloc(size, sizeof(ARPSlot));
+        if (table == nullptr) log_e("No memory for the ARP table of %lu hosts", (unsigned long)size);
+        portENTER_CRITICAL(&arpTableMux);
+        arpTableBase = base;
+        arpTableSize = table ? size : 0;
+        arpTable = table;
+        portEXIT_CRITICAL(&arpTableMux);
+        arpTableIface = iface;
+    }
+    arpTableDropped = 0;
+
+    if (hookedIface == nullptr) {
+        originalInput = iface->input;
+        hookedIface = iface;
+        iface->input = arpSweepInput;
+    }
+}
+
+ARPSweeper::~ARPSweeper() {
+    if (hookedIface == iface && iface != nullptr) {
+        iface->input = originalInput;
+        hookedIface = nullptr;
+    }
+
+    // the hook may still be running on the driver task, the table is unlinked before it is freed
+    portENTER_CRITICAL(&arpTableMux);
+    ARPSlot *table = arpTable;
+    arpTable = nullptr;
+    arpTableSize = 0;
+    portEXIT_CRITICAL(&arpTableMux);
+    arpTableIface = nullptr;
+    free(table);
+}
+
+bool ARPSweeper::lookup(uint32_t ip, ARPEntry &entry) {
+    ARPSlot slot = {};
+    portENTER_CRITICAL(&arpTableMux);
+    uint32_t offset = ntohl(ip) - arpTableBase;
+    if (arpTable != nullptr && offset < arpTableSize) slot = arpTable[offset];
+    portEXIT_CRITICAL(&arpTableMux);
+    if (slot.seen == 0) return false;
+
+    entry.ip = ip;
+    memcpy(entry.mac, slot.mac, 6);
+    entry.seen = slot.seen;
+    return true;
+}
+
+uint32_t ARPSweeper::dropped() const { return arpTableDropped; }
+
+/*********************************************************************
+**  Function: sweep
+**  Sends ARP_SWEEP_BURST requests at a time, then collects everything
+**  the hook recorded for the range
+**********************************************************************/
+std::vector<ARPEntry> ARPSweeper::sweep(
+    uint32_t first, uint32_t last, bool onlyStale, std::function<void(uint32_t done, uint32_t total)> progress
+) {
+    std::vector<ARPEntry> hosts;
+    if (arpTable == nullptr || iface == nullptr || last < first) return hosts;
+    if (last - first >= ARP_SWEEP_MAX_HOSTS) {
+        log_w("ARP sweep: subnet cut to the first %d hosts", ARP_SWEEP_MAX_HOSTS);
+        last = first + ARP_SWEEP_MAX_HOSTS - 1;
+    }
+
+    uint32_t start = millis();
+    uint32_t total = last - first + 1;
+    uint32_t inBurst = 0;
+    for (uint32_t ip_le = first; ip_le <= last; ip_le++) {
+        ip4_addr_t ip_be{htonl(ip_le)};
+        if (progress) progress(ip_le - first, total);
+
+        ARPEntry known;
+        if (onlyStale && lookup(ip_be.addr, known) && millis() - known.seen < ARP_SWEEP_FRESH_MS) continue;
+
+        err_t res = etharp_request(iface, &ip_be);
+        if (res != ERR_OK) {
+            log_w("Arp req for %s failed with ec: %d", IPAddress(ip_be.addr).toString().c_str(), res);
+        }
+
+        if (++inBurst == ARP_SWEEP_BURST) {
+            inBurst = 0;
+            vTaskDelay(pdMS_TO_TICKS(ARP_SWEEP_BURST_GAP_MS));
+        }
+    }
+    if (progress) progress(total, total);
+    vTaskDelay(pdMS_TO_TICKS(ARP_SWEEP_LINGER_MS));
+
+    // Hosts that answered now, plus the fresh ones that were not probed again
+    uint32_t now = millis();
+    for (uint32_t ip_le = first; ip_le <= last; ip_le++) {
+        ARPEntry e;
+        if (!lookup(htonl(ip_le), e)) continue;
+        bool answered = (int32_t)(e.seen - start) >= 0;
+        if (answered || (onlyStale && now - e.seen < ARP_SWEEP_FRESH_MS)) hosts.push_back(e);
+    }
+
+    if (arpTableDropped > 0) {
+        log_w("ARP sweep: %lu packets from outside the subnet table", (unsigned long)arpTableDropped);
+    }
+    log_d("ARP sweep: %u hosts in %lu ms", (unsigned)hosts.size(), millis() - start);
+    return hosts;
+}
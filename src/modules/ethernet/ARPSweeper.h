@@ -0,0 +1,43 @@
+#ifndef ARP_SWEEPER_H
+#define ARP_SWEEPER_H
+
+#include "Arduino.h"
+#include "lwip/netif.h"
+#include <functional>
+#include <vector>
+
+#define ARP_SWEEP_BURST 16          // requests sent back to back
+#define ARP_SWEEP_BURST_GAP_MS 15   // pause between bursts, keeps the TX queue from overflowing
+#define ARP_SWEEP_LINGER_MS 1000    // late replies after the last burst
+#define ARP_SWEEP_MAX_HOSTS 4094    // largest subnet swept (/20), the reply table has a slot per address
+#define ARP_SWEEP_FRESH_MS 60000    // hosts seen more recently are not probed again
+
+struct ARPEntry {
+    uint32_t ip; // network order
+    uint8_t mac[6];
+    uint32_t seen; // millis() of the last ARP packet from this host
+};
+
+// Captures every ARP packet received by the netif into its own IP -> MAC table, so discovery
+// no longer depends on the few entries of the lwIP ARP cache. The table has one slot per
+// address of the interface subnet, indexed by host offset. It is kept between sweeps, later
+// sweeps only probe addresses that were not seen recently.
+class ARPSweeper {
+public:
+    ARPSweeper(netif *iface);
+    ~ARPSweeper();
+
+    // Probes [first, last] (host order), returns the hosts that answered or are still fresh
+    std::vector<ARPEntry> sweep(
+        uint32_t first, uint32_t last, bool onlyStale,
+        std::function<void(uint32_t done, uint32_t total)> progress = nullptr
+    );
+    bool lookup(uint32_t ip, ARPEntry &entry);
+    // ARP packets from addresses outside the table, since the sweeper was created
+    uint32_t dropped() const;
+
+private:
+    netif *iface;
+};
+
+#endif
@@ -6,82 +6,17 @@
  */
 
 #include "HostInfo.h"
-#include "ESPNetifEthernetClient.h"
+#include "PortScanner.h"
 #include "core/display.h"
 #include "core/net_utils.h"
 
-HostInfo::HostInfo(const Host &host, bool wifi) {
-#if !defined(LITE_VERSION)
-    if (!wifi) {
-        eth_client = new ESPNetifEthernetClient();
-    } else {
-        wifi_client = new WiFiClient();
-    }
-#else
-    wifi_client = new WiFiClient();
-#endif
-
-    setup(host);
-}
-
-HostInfo::~HostInfo() {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        delete eth_client;
-    } else {
-        delete wifi_client;
-    }
-#else
-    delete wifi_client;
-#endif
-}
-
-struct PortScan { // struct pra holdar info das portas
-    int port;
-    unsigned long startTime;
-    bool inProgress;
-};
-
-void HostInfo::client_stop() {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        eth_client->client_close(sockfd);
-    } else {
-        wifi_client->stop();
-    }
-#else
-    wifi_client->stop();
-#endif
-}
-
-void HostInfo::client_connect(IPAddress ip, int port) {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        sockfd = eth_client->connect(ip, port, 3000);
-    } else {
-        wifi_client->connect(ip, port);
-    }
-#else
-    wifi_client->connect(ip, port);
-#endif
-};
+// WiFi and Ethernet both end in lwIP, the scanner sockets are routed to the right netif
+HostInfo::HostInfo(const Host &host) { setup(host); }
 
-bool HostInfo::client_connected() {
-#if !defined(LITE_VERSION)
-    if (eth_client != nullptr) {
-        return eth_client->connected(sockfd);
-    } else {
-        return wifi_client->connected();
-    }
-#else
-    return wifi_client->connected();
-#endif
-}
+HostInfo::~HostInfo() {}
 
 void HostInfo::setup(const Host &host) {
-    const int MAX_SIMULTANEOUS = 10; // Number of simultaneous connection attempts
-    const int TIMEOUT_MS = 1000;     // Timeout for each connection attempt
-    int scannedPorts = 0;
+    const uint32_t UI_REFRESH_MS = 250; // footnote refresh, the TFT is not redrawn per port
     // Initialize display
     drawMainBorder();
     tft.setTextSize(FP);
@@ -96,78 +31,59 @@ void HostInfo::setup(const Host &host) {
     tft.setCursor(8, 78);
     tft.print("Ports Open: ");
 
-    std::vector<PortScan> scans(MAX_SIMULTANEOUS);
-    auto portIter = portServices.begin();
-    int activeScanCount = 0;
-
-    // Initialize scans
-    for (auto &scan : scans) { scan.inProgress = false; }
+    std::vector<uint16_t> ports;
+    ports.reserve(portServices.size());
+    for (const auto &service : portServices) ports.push_back(service.first);
+    PortScanner scanner(host.ip, ports, host.mac);
 
+    unsigned long start = millis();
+    unsigned long lastRefresh = 0;
     bool scanCanceled = false;
-    while ((portIter != portServices.end() || activeScanCount > 0) && !scanCanceled) {
+    bool running = true;
+    while (running) {
         // Check for escape press
         if (check(EscPress)) {
             scanCanceled = true;
-            // Stop all active scans
-            for (auto &scan : scans) {
-                if (scan.inProgress) {
-                    client_stop();
-                    scan.inProgress = false;
-                }
-            }
+            scanner.cancel();
             break;
         }
 
-        // Start new scans if possible
-        while (activeScanCount < MAX_SIMULTANEOUS && portIter != portServices.end()) {
-            for (auto &scan : scans) {
-                if (!scan.inProgress) {
-                    scan.port = portIter->first;
-                    scan.startTime = millis();
-                    scan.inProgress = true;
-                    printFootnote(
-                        "scannng port: " + String(scan.port) +
-                        " | remaining: " + String(portServices.size() - scannedPorts)
-                    ); // printa portas escaneadas e restantes
+        running = scanner.poll(20);
 
-                    client_connect(host.ip, scan.port);
-                    activeScanCount++;
-                    portIter++;
-                    break;
-                }
-            }
+        for (size_t idx : scanner.takeNewOpen()) {
+            uint16_t port = scanner.port(idx);
+            if (tft.getCursorX() > (240 - LW * 4)) tft.setCursor(7, tft.getCursorY() + LH);
+            tft.setCursor(7, tft.getCursorY() + LH);
+            tft.print(port);
+            String banner = scanner.banner(idx);
+            tft.print(" (" + String(banner != "" ? banner : portServices[port]) + ")");
         }
 
-        // Check ongoing scans
-        for (auto &scan : scans) {
-            if (scan.inProgress) {
-                // Check if connected
-                if (client_connected()) {
-                    if (tft.getCursorX() > (240 - LW * 4)) tft.setCursor(7, tft.getCursorY() + LH);
-                    tft.setCursor(7, tft.getCursorY() + LH);
-                    tft.print(scan.port);
-                    tft.print(" (" + String(portServices[scan.port]) + ")");
-                    client_stop();
-                    scan.inProgress = false;
-                    activeScanCount--;
-                }
-                // Check for timeout
-                else if (millis() - scan.startTime > TIMEOUT_MS) {
-                    client_stop();
-                    scan.inProgress = false;
-                    activeScanCount--;
-                    scannedPorts++;
-                }
-            }
+        if (millis() - lastRefresh > UI_REFRESH_MS) {
+            lastRefresh = millis();
+            printFootnote(
+                "scanned: " + String(scanner.finished()) + "/" + String(scanner.total()) +
+                " | timeout: " + String(scanner.timeoutMs()) + "ms"
+            );
         }
-        yield(); // Allow other tasks to run
     }
 
     tft.setCursor(8, tft.getCursorY() + 16);
     if (scanCanceled) {
         tft.print("Scan Canceled!");
     } else {
+        scanner.saveCache();
+        unsigned long elapsed = max(millis() - start, 1UL);
         tft.print("Done!");
+        printFootnote(
+            String(scanner.total() - scanner.skipped()) + " ports in " + String(elapsed / 1000.0, 1) + "s (" +
+            String(scanner.skipped()) + " cached closed)"
+        );
+        log_d(
+            "Port scan %s: %.1f ports/s",
+            host.ip.toString().c_str(),
+            (scanner.total() - scanner.skipped()) * 1000.0 / elapsed
+        );
     }
 
     while (check(SelPress)) yield();
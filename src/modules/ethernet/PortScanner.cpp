@@ -0,0 +1,278 @@
+/**
+ * @file PortScanner.cpp
+ * @brief Non-blocking TCP connect scanner over lwIP sockets, works on every esp-netif
+ */
+
+#include "PortScanner.h"
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <esp32/rom/crc.h>
+#include <lwip/sockets.h>
+
+PortScanner::PortScanner(IPAddress ip, const std::vector<uint16_t> &ports, const String &cacheKey)
+    : ip(ip), ports(ports), cacheKey(cacheKey) {
+    size_t bytes = (ports.size() + 7) / 8;
+    openBits.assign(bytes, 0);
+    closedBits.assign(bytes, 0);
+    cachedClosedBits.assign(bytes, 0);
+    listHash = crc32_le(0, (const uint8_t *)ports.data(), ports.size() * sizeof(uint16_t));
+    lastRefill = millis();
+    loadCache();
+}
+
+PortScanner::~PortScanner() { cancel(); }
+
+bool PortScanner::getBit(const std::vector<uint8_t> &bits, size_t idx) {
+    return bits[idx / 8] & (1 << (idx % 8));
+}
+
+void PortScanner::setBit(std::vector<uint8_t> &bits, size_t idx) { bits[idx / 8] |= 1 << (idx % 8); }
+
+PortState PortScanner::state(size_t idx) const {
+    if (getBit(openBits, idx)) return PORT_OPEN;
+    if (getBit(closedBits, idx)) return PORT_CLOSED;
+    if (idx < next) return PORT_FILTERED;
+    return PORT_UNKNOWN;
+}
+
+String PortScanner::banner(size_t idx) const {
+    auto it = banners.find(idx);
+    return it == banners.end() ? "" : it->second;
+}
+
+std::vector<size_t> PortScanner::takeNewOpen() {
+    std::vector<size_t> result;
+    result.swap(newOpen);
+    return result;
+}
+
+/*********************************************************************
+**  Function: loadCache
+**  Known-closed ports and banners from previous scans of this host,
+**  only used when the port list is the same one
+**********************************************************************/
+void PortScanner::loadCache() {
+    if (cacheKey == "" || !LittleFS.exists(PORT_SCAN_CACHE_FILE)) return;
+    File file = LittleFS.open(PORT_SCAN_CACHE_FILE, FILE_READ);
+    if (!file) return;
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) return;
+
+    JsonObject host = doc[cacheKey];
+    if (host.isNull() || host["list"].as<uint32_t>() != listHash) return;
+    scanCount = host["scans"] | 0;
+    // every few scans the closed ports are probed again, services come and go
+    trustCache = (scanCount % PORT_SCAN_CACHE_RESCAN) != 0;
+
+    String closed = host["closed"] | "";
+    for (size_t i = 0; i < cachedClosedBits.size() && i * 2 + 1 < closed.length(); i++) {
+        cachedClosedBits[i] = strtoul(closed.substring(i * 2, i * 2 + 2).c_str(), nullptr, 16);
+    }
+    for (JsonPair kv : host["banners"].as<JsonObject>()) {
+        uint16_t port = atoi(kv.key().c_str());
+        for (size_t i = 0; i < ports.size(); i++) {
+            if (ports[i] == port) banners[i] = kv.value().as<String>();
+        }
+    }
+}
+
+/*********************************************************************
+**  Function: saveCache
+**  Keeps the last PORT_SCAN_CACHE_HOSTS hosts, most recent last
+**********************************************************************/
+void PortScanner::saveCache() {
+    if (cacheKey == "") return;
+    JsonDocument doc;
+    File file = LittleFS.open(PORT_SCAN_CACHE_FILE, FILE_READ);
+    if (file) {
+        if (deserializeJson(doc, file)) doc.clear();
+        file.close();
+    }
+    if (!doc.is<JsonObject>()) doc.to<JsonObject>();
+
+    doc.remove(cacheKey);
+    while (doc.size() >= PORT_SCAN_CACHE_HOSTS) {
+        JsonObject root = doc.as<JsonObject>();
+        root.remove(root.begin());
+    }
+
+    // ports skipped this time keep their cached state
+    String closed;
+    char hex[3];
+    for (size_t i = 0; i < closedBits.size(); i++) {
+        snprintf(hex, sizeof(hex), "%02x", closedBits[i] | (trustCache ? cachedClosedBits[i] : 0));
+        closed += hex;
+    }
+
+    JsonObject host = doc[cacheKey].to<JsonObject>();
+    host["list"] = listHash;
+    host["scans"] = scanCount + 1;
+    host["closed"] = closed;
+    JsonObject _banners = host["banners"].to<JsonObject>();
+    for (const auto &b : banners) {
+        if (getBit(openBits, b.first)) _banners[String(ports[b.first])] = b.second;
+    }
+
+    file = LittleFS.open(PORT_SCAN_CACHE_FILE, FILE_WRITE);
+    if (!file) return;
+    serializeJson(doc, file);
+    file.close();
+}
+
+void PortScanner::sampleRtt(uint32_t rtt) {
+    if (srtt < 0) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+    } else {
+        int32_t err = (int32_t)rtt - srtt;
+        srtt += err / 8;
+        rttvar += (abs(err) - rttvar) / 4;
+    }
+    timeout = constrain(srtt + 4 * rttvar, PORT_SCAN_MIN_TIMEOUT_MS, PORT_SCAN_MAX_TIMEOUT_MS);
+}
+
+void PortScanner::finish(Slot &slot, PortState result) {
+    if (slot.fd >= 0) close(slot.fd);
+    slot.fd = -1;
+    slot.connected = false;
+    if (result == PORT_OPEN) {
+        setBit(openBits, slot.idx);
+        newOpen.push_back(slot.idx);
+    } else if (result == PORT_CLOSED) {
+        setBit(closedBits, slot.idx);
+    }
+    doneCount++;
+}
+
+/*********************************************************************
+**  Function: startNext
+**  Starts a non-blocking connect() for the next port that is not
+**  known to be closed, returns false when no socket is available
+**********************************************************************/
+bool PortScanner::startNext(Slot &slot) {
+    while (next < ports.size() && trustCache && getBit(cachedClosedBits, next)) {
+        setBit(closedBits, next);
+        skippedCount++;
+        doneCount++;
+        next++;
+    }
+    if (next >= ports.size()) return false;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false; // socket pool exhausted, retry once one is closed
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    addr.sin_port = htons(ports[next]);
+
+    slot.fd = fd;
+    slot.idx = next++;
+    slot.start = millis();
+    slot.connected = false;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        slot.connected = true; // loopback-fast answer, go straight to the banner
+        slot.start = millis();
+    } else if (errno == ECONNREFUSED) {
+        finish(slot, PORT_CLOSED);
+    } else if (errno != EINPROGRESS) {
+        finish(slot, PORT_FILTERED);
+    }
+    return true;
+}
+
+void PortScanner::readBanner(Slot &slot) {
+    char buf[PORT_SCAN_BANNER_LEN + 1];
+    int len = recv(slot.fd, buf, PORT_SCAN_BANNER_LEN, MSG_DONTWAIT);
+    if (len <= 0) return;
+
+    String line;
+    for (int i = 0; i < len && buf[i] != '\r' && buf[i] != '\n'; i++) {
+        if (isprint((unsigned char)buf[i])) line += buf[i];
+    }
+    if (line != "") banners[slot.idx] = line;
+}
+
+/*********************************************************************
+**  Function: poll
+**  One scheduling round: refills the rate limiter, opens sockets,
+**  then waits on all of them with a single select()
+**********************************************************************/
+bool PortScanner::poll(uint32_t waitMs) {
+    uint32_t now = millis();
+    tokens += (now - lastRefill) * PORT_SCAN_RATE / 1000.0f;
+    if (tokens > PORT_SCAN_MAX_SOCKETS) tokens = PORT_SCAN_MAX_SOCKETS;
+    lastRefill = now;
+
+    for (auto &slot : slots) {
+        if (slot.fd >= 0 || next >= ports.size() || tokens < 1) continue;
+        if (!startNext(slot)) break;
+        tokens -= 1;
+    }
+
+    fd_set readSet, writeSet;
+    FD_ZERO(&readSet);
+    FD_ZERO(&writeSet);
+    int maxFd = -1;
+    uint32_t wait = waitMs;
+    for (auto &slot : slots) {
+        if (slot.fd < 0) continue;
+        FD_SET(slot.fd, slot.connected ? &readSet : &writeSet);
+        if (slot.fd > maxFd) maxFd = slot.fd;
+        uint32_t limit = slot.connected ? PORT_SCAN_BANNER_MS : timeout;
+        uint32_t elapsed = now - slot.start;
+        wait = min(wait, elapsed >= limit ? 0 : limit - elapsed);
+    }
+    if (maxFd < 0) {
+        if (doneCount >= ports.size()) return false;
+        if (tokens < 1) delay(min(waitMs, (uint32_t)(1000 / PORT_SCAN_RATE + 1)));
+        return true;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = wait / 1000;
+    tv.tv_usec = (wait % 1000) * 1000;
+    if (select(maxFd + 1, &readSet, &writeSet, nullptr, &tv) < 0) {
+        log_e("select errno: %d", errno);
+        return doneCount < ports.size();
+    }
+
+    now = millis();
+    for (auto &slot : slots) {
+        if (slot.fd < 0) continue;
+        uint32_t elapsed = now - slot.start;
+        if (slot.connected) {
+            if (FD_ISSET(slot.fd, &readSet)) readBanner(slot);
+            if (FD_ISSET(slot.fd, &readSet) || elapsed >= PORT_SCAN_BANNER_MS) finish(slot, PORT_OPEN);
+        } else if (FD_ISSET(slot.fd, &writeSet)) {
+            int sockerr = 0;
+            socklen_t len = sizeof(sockerr);
+            getsockopt(slot.fd, SOL_SOCKET, SO_ERROR, &sockerr, &len);
+            if (sockerr == 0) {
+                sampleRtt(elapsed);
+                slot.connected = true;
+                slot.start = now;
+            } else if (sockerr == ECONNREFUSED) {
+                sampleRtt(elapsed);
+                finish(slot, PORT_CLOSED);
+            } else {
+                finish(slot, PORT_FILTERED);
+            }
+        } else if (elapsed >= timeout) {
+            finish(slot, PORT_FILTERED);
+        }
+    }
+    return doneCount < ports.size();
+}
+
+void PortScanner::cancel() {
+    for (auto &slot : slots) {
+        if (slot.fd >= 0) close(slot.fd);
+        slot.fd = -1;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef PORT_SCANNER_H
+#define PORT_SCANNER_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+#define PORT_SCAN_MAX_SOCKETS 12       // lwIP socket pool is small, keep some for the rest of the firmware
+#define PORT_SCAN_RATE 150             // new connection attempts per second
+#define PORT_SCAN_INIT_TIMEOUT_MS 1000 // used until the first RTT sample
+#define PORT_SCAN_MIN_TIMEOUT_MS 150
+#define PORT_SCAN_MAX_TIMEOUT_MS 1500
+#define PORT_SCAN_BANNER_MS 300 // how long an open port gets to send a banner
+#define PORT_SCAN_BANNER_LEN 48
+#define PORT_SCAN_CACHE_FILE "/bruce_ports.cache"
+#define PORT_SCAN_CACHE_HOSTS 32
+#define PORT_SCAN_CACHE_RESCAN 4 // known-closed ports are probed again every N scans
+
+enum PortState : uint8_t {
+    PORT_UNKNOWN,
+    PORT_OPEN,
+    PORT_CLOSED,   // RST received
+    PORT_FILTERED, // no answer before the timeout
+};
+
+class PortScanner {
+public:
+    PortScanner(IPAddress ip, const std::vector<uint16_t> &ports, const String &cacheKey);
+    ~PortScanner();
+
+    bool poll(uint32_t waitMs); // runs the scan for up to waitMs, false once everything is finished
+    void cancel();
+    void saveCache();
+
+    size_t total() const { return ports.size(); }
+    size_t finished() const { return doneCount; }
+    size_t skipped() const { return skippedCount; }
+    uint32_t timeoutMs() const { return timeout; }
+    uint16_t port(size_t idx) const { return ports[idx]; }
+    PortState state(size_t idx) const;
+    String banner(size_t idx) const;
+    std::vector<size_t> takeNewOpen(); // ports found open since the last call
+
+private:
+    struct Slot {
+        int fd = -1;
+        size_t idx = 0;
+        uint32_t start = 0;
+        bool connected = false; // waiting for a banner
+    };
+
+    IPAddress ip;
+    std::vector<uint16_t> ports;
+    String cacheKey;
+    uint32_t listHash = 0;
+    uint32_t scanCount = 0;
+    bool trustCache = false;
+
+    std::vector<uint8_t> openBits;
+    std::vector<uint8_t> closedBits;
+    std::vector<uint8_t> cachedClosedBits;
+    std::map<size_t, String> banners;
+    std::vector<size_t> newOpen;
+
+    Slot slots[PORT_SCAN_MAX_SOCKETS];
+    size_t next = 0;
+    size_t doneCount = 0;
+    size_t skippedCount = 0;
+
+    // Jacobson/Karels estimator over connect() round trips, RST and SYN-ACK alike
+    int32_t srtt = -1;
+    int32_t rttvar = 0;
+    uint32_t timeout = PORT_SCAN_INIT_TIMEOUT_MS;
+    float tokens = PORT_SCAN_MAX_SOCKETS;
+    uint32_t lastRefill = 0;
+
+    static bool getBit(const std::vector<uint8_t> &bits, size_t idx);
+    static void setBit(std::vector<uint8_t> &bits, size_t idx);
+
+    void loadCache();
+    bool startNext(Slot &slot);
+    void finish(Slot &slot, PortState result);
+    void sampleRtt(uint32_t rtt);
+    void readBanner(Slot &slot);
+};
+
+#endif
@@ -7,13 +7,20 @@
 #include <esp_heap_caps.h>
 
 #define FFT_SIZE 1024
+#define FFT_HOP (FFT_SIZE / 2) // 50% overlap between frames
 #define SPECTRUM_WIDTH 200
 #define SPECTRUM_HEIGHT 124
 #define HISTORY_LEN (SPECTRUM_WIDTH + 1)
+#define MIC_SAMPLE_RATE 48000
+#define SPECTRUM_DB_FLOOR -90.0f // dB below a full scale tone shown as the darkest color
+#define SPECTRUM_DB_RANGE 70.0f
 
 static int8_t *i2s_buffer = nullptr;
 static uint8_t *fftHistory = nullptr; // Linear buffer [WIDTH + 1][HEIGHT]
 static uint16_t posData = 0;
+static float *fftWindow = nullptr;           // Hann window, with the int16 to float scale
+static uint16_t rowBin[SPECTRUM_HEIGHT + 1]; // first FFT bin of each spectrum row, log spaced
+static uint16_t palette[256];
 
 #ifndef PIN_CLK
 #define PIN_CLK I2S_PIN_NO_CHANGE
@@ -86,13 +93,13 @@ bool deinitMicroPhone() {
 bool InitI2SMicroPhone() {
     i2s_config_t i2s_config = {
         .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_PDM),
-        .sample_rate = 48000,
+        .sample_rate = MIC_SAMPLE_RATE,
         .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
         .channel_format = I2S_CHANNEL_FMT_ALL_RIGHT,
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
         .dma_buf_count = 8,
-        .dma_buf_len = SPECTRUM_HEIGHT,
+        .dma_buf_len = FFT_HOP / 2, // the DMA ring holds four hops, the spectrum reads one at a time
     };
 
     i2s_pin_config_t pin_config = {
@@ -110,11 +117,49 @@ bool InitI2SMicroPhone() {
     esp_err_t err = ESP_OK;
     err |= i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL);
     err |= i2s_set_pin(I2S_NUM_0, &pin_config);
-    err |= i2s_set_clk(I2S_NUM_0, 48000, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
+    err |= i2s_set_clk(I2S_NUM_0, MIC_SAMPLE_RATE, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
 
     return (err == ESP_OK);
 }
 
+/*********************************************************************
+**  Function: spectrumSetup
+**  Everything a frame would otherwise compute again: the window, the
+**  rows to FFT bins map and the colors
+**********************************************************************/
+static void spectrumSetup() {
+    for (int i = 0; i < FFT_SIZE; i++) {
+        fftWindow[i] = (0.5f - 0.5f * cosf(2.0f * PI * i / (FFT_SIZE - 1))) / 32768.0f;
+    }
+    // rows from bin 1 (47Hz) to the last bin (24kHz), each octave gets the same height
+    const float lastBin = FFT_SIZE / 2 - 1;
+    for (int r = 0; r <= SPECTRUM_HEIGHT; r++) {
+        rowBin[r] = (uint16_t)roundf(powf(lastBin, (float)r / SPECTRUM_HEIGHT));
+        if (r > 0 && rowBin[r] <= rowBin[r - 1]) rowBin[r] = rowBin[r - 1] + 1;
+    }
+    for (int i = 0; i < 256; i++) {
+        palette[i] = rgb565(ImageData[i * 3 + 0], ImageData[i * 3 + 1], ImageData[i * 3 + 2]);
+    }
+}
+
+// Loudest bin of each row in dB, scaled to the palette
+static void spectrumColumn(const float *output, uint8_t *column) {
+    // a full scale tone through the Hann window peaks at FFT_SIZE / 4
+    const float fullScale = 10.0f * log10f((FFT_SIZE / 4.0f) * (FFT_SIZE / 4.0f));
+    for (int r = 0; r < SPECTRUM_HEIGHT; r++) {
+        float peak = 1e-12f;
+        for (int bin = rowBin[r]; bin < rowBin[r + 1] && bin < FFT_SIZE / 2; bin++) {
+            float re = output[2 * bin];
+            float im = output[2 * bin + 1];
+            peak = max(peak, re * re + im * im);
+        }
+        float db = 10.0f * log10f(peak) - fullScale;
+        float level = (db - SPECTRUM_DB_FLOOR) * 255.0f / SPECTRUM_DB_RANGE;
+        // low frequencies at the bottom
+        column[SPECTRUM_HEIGHT - 1 - r] = (uint8_t)constrain(level, 0.0f, 255.0f);
+    }
+}
+
 void mic_test_one_task() {
     tft.fillScreen(TFT_BLACK);
 
@@ -124,10 +169,15 @@ void mic_test_one_task() {
         frameBuffer = (uint16_t *)ps_malloc(SPECTRUM_WIDTH * SPECTRUM_HEIGHT * sizeof(uint16_t));
     else frameBuffer = (uint16_t *)malloc(SPECTRUM_WIDTH * SPECTRUM_HEIGHT * sizeof(uint16_t));
 
-    if (!frameBuffer) {
+    // the plan is made once, fft_init allocates its buffers and twiddle factors
+    fft_config_t *plan = fft_init(FFT_SIZE, FFT_REAL, FFT_FORWARD, NULL, NULL);
+    if (!frameBuffer || !plan) {
         Serial.println("Error alloc drawing frameBuffer, exiting");
+        free(frameBuffer);
+        if (plan) fft_destroy(plan);
         return;
     }
+    spectrumSetup();
     tft.drawRect(
         tftWidth / 2 - SPECTRUM_WIDTH / 2 - 2,
         tftHeight / 2 - SPECTRUM_HEIGHT / 2 - 2,
@@ -136,37 +186,35 @@ void mic_test_one_task() {
         bruceConfig.priColor
     );
 
+    int16_t *samples = (int16_t *)i2s_buffer;
+    memset(samples, 0, FFT_SIZE * sizeof(int16_t));
+    uint32_t frames = 0;
+    uint32_t fpsStart = millis();
+
     while (1) {
-        fft_config_t *plan = fft_init(FFT_SIZE, FFT_REAL, FFT_FORWARD, NULL, NULL);
+        // keep the newer half of the last frame, read one hop after it
+        memmove(samples, samples + FFT_HOP, (FFT_SIZE - FFT_HOP) * sizeof(int16_t));
         size_t bytesread;
-        i2s_read(I2S_NUM_0, (char *)i2s_buffer, FFT_SIZE * sizeof(int16_t), &bytesread, portMAX_DELAY);
-        int16_t *samples = (int16_t *)i2s_buffer;
+        i2s_read(
+            I2S_NUM_0,
+            (char *)(samples + FFT_SIZE - FFT_HOP),
+            FFT_HOP * sizeof(int16_t),
+            &bytesread,
+            portMAX_DELAY
+        );
 
-        for (int i = 0; i < FFT_SIZE; i++) { plan->input[i] = (float)samples[i] / 32768.0f; }
+        for (int i = 0; i < FFT_SIZE; i++) { plan->input[i] = samples[i] * fftWindow[i]; }
 
         fft_execute(plan);
 
-        for (int i = 1; i < FFT_SIZE / 4 && i < SPECTRUM_HEIGHT; i++) {
-            float re = plan->output[2 * i];
-            float im = plan->output[2 * i + 1];
-            float mag = re * re + im * im;
-            if (mag > 1.0f) mag = 1.0f;
-            uint8_t value = map(mag * 2000, 0, 2000, 0, 255);
-            fftHistory[posData * SPECTRUM_HEIGHT + (SPECTRUM_HEIGHT - i)] = value;
-        }
-
+        spectrumColumn(plan->output, &fftHistory[posData * SPECTRUM_HEIGHT]);
         posData = (posData + 1) % HISTORY_LEN;
 
-        fft_destroy(plan);
-
         // Render
-        for (int y = 0; y < SPECTRUM_HEIGHT; y++) {
-            for (int x = 0; x < SPECTRUM_WIDTH; x++) {
-                int index = (x + posData) % HISTORY_LEN;
-                uint8_t val = fftHistory[index * SPECTRUM_HEIGHT + y];
-                uint16_t color =
-                    rgb565(ImageData[val * 3 + 0], ImageData[val * 3 + 1], ImageData[val * 3 + 2]);
-                frameBuffer[y * SPECTRUM_WIDTH + x] = color;
+        for (int x = 0; x < SPECTRUM_WIDTH; x++) {
+            const uint8_t *column = &fftHistory[((x + posData) % HISTORY_LEN) * SPECTRUM_HEIGHT];
+            for (int y = 0; y < SPECTRUM_HEIGHT; y++) {
+                frameBuffer[y * SPECTRUM_WIDTH + x] = palette[column[y]];
             }
         }
 
@@ -177,10 +225,16 @@ void mic_test_one_task() {
             SPECTRUM_HEIGHT,
             frameBuffer
         );
+        if (++frames == 100) {
+            log_d("Mic spectrum: %.1f fps", frames * 1000.0f / (millis() - fpsStart));
+            frames = 0;
+            fpsStart = millis();
+        }
         wakeUpScreen();
         if (check(SelPress) || check(EscPress)) break;
     }
     i2s_stop(I2S_NUM_0);
+    fft_destroy(plan);
     free(frameBuffer);
 }
 
@@ -214,7 +268,13 @@ void mic_test() {
         i2s_buffer = (int8_t *)malloc(FFT_SIZE * sizeof(int16_t));
         fftHistory = (uint8_t *)malloc(HISTORY_LEN * SPECTRUM_HEIGHT);
     }
-    if (!i2s_buffer || !fftHistory) {
+    // read for every sample of every frame, internal RAM
+    fftWindow = (float *)malloc(FFT_SIZE * sizeof(float));
+    if (!i2s_buffer || !fftHistory || !fftWindow) {
+        free(i2s_buffer);
+        free(fftHistory);
+        free(fftWindow);
+        fftWindow = nullptr;
         displayError("Fail to alloc buffers, exiting", true);
         return;
     }
@@ -225,6 +285,8 @@ void mic_test() {
 
     free(i2s_buffer);
     free(fftHistory);
+    free(fftWindow);
+    fftWindow = nullptr;
 
     delay(10);
     if (deinitMicroPhone()) Serial.println("Fail disabling I2S Driver");
@@ -204,7 +204,6 @@ void brucegotchi_start() {
     }
 
     // Turn off WiFi
-    esp_wifi_set_promiscuous(false);
-    esp_wifi_set_promiscuous_rx_cb(nullptr);
+    stopPwngrid();
     wifiDisconnect();
 }
@@ -11,71 +11,95 @@ Thanks to @bmorcelli (Pirata) for his help doing a better code.
 
 #include "pwngrid.h"
 #include "../wifi/sniffer.h"
-
-uint8_t pwngrid_friends_tot = 0;
-std::vector<pwngrid_peer> pwngrid_peers;
-String pwngrid_last_friend_name = "";
+#include <atomic>
+
+static pwngrid_peer pwngrid_peers[PWNGRID_MAX_PEERS];
+static uint8_t pwngrid_friends_tot = 0;
+static char pwngrid_last_friend_name[32] = "";
+static portMUX_TYPE pwngridPeersMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Vendor IEs of pwnagotchi beacons, single producer (WiFi task) and single consumer (parser task)
+struct PwngridFrame {
+    uint16_t len;
+    int8_t rssi;
+    uint8_t data[PWNGRID_PAYLOAD_MAX];
+};
+static PwngridFrame *pwngridRing = nullptr;
+static std::atomic<uint32_t> pwngridRingHead{0};
+static std::atomic<uint32_t> pwngridRingTail{0};
+static uint32_t pwngridRingDrops = 0;
+static TaskHandle_t pwngridTask = NULL;
+static volatile bool pwngridTaskStop = false;
 
 uint8_t getPwngridTotalPeers() { return pwngrid_friends_tot; }
 uint8_t getPwngridRunTotalPeers() { return pwngrid_friends_tot; }
-String getPwngridLastFriendName() { return pwngrid_last_friend_name; }
-std::vector<pwngrid_peer> getPwngridPeers() { return pwngrid_peers; }
-
-// Add pwngrid peers
-void add_new_peer(JsonDocument &json, signed int rssi) {
-    // Check if it exists in the list
-    bool exists = false;
-    for (auto peer_list : pwngrid_peers) {
-        if (peer_list.identity == json["identity"].as<String>()) {
-            exists = true;
-            peer_list.last_ping = millis();
-            peer_list.gone = false;
-            peer_list.rssi = rssi;
-            return;
-        }
-    }
-    // Check if doesn't exists AND there are room in RAM memory to save
-    if (!exists && pwngrid_peers.size() < 50) {
-        pwngrid_peers.push_back((pwngrid_peer){
-            json["epoch"].as<int>(),
-            json["face"].as<String>(),
-            json["grid_version"].as<String>(),
-            json["identity"].as<String>(),
-            json["name"].as<String>(),
-            json["pwnd_run"].as<int>(),
-            json["pwnd_tot"].as<int>(),
-            json["session_id"].as<String>(),
-            json["timestamp"].as<int>(),
-            json["uptime"].as<int>(),
-            json["version"].as<String>(),
-            rssi,
-            millis(),
-            false,
-        }); // Add the local object into the vector
-        // Update last friend and increment counter
-        pwngrid_last_friend_name = json["name"].as<String>();
-        pwngrid_friends_tot = pwngrid_peers.size();
+
+String getPwngridLastFriendName() {
+    char name[sizeof(pwngrid_last_friend_name)];
+    portENTER_CRITICAL(&pwngridPeersMux);
+    memcpy(name, pwngrid_last_friend_name, sizeof(name));
+    portEXIT_CRITICAL(&pwngridPeersMux);
+    return String(name);
+}
+
+std::vector<pwngrid_peer> getPwngridPeers() {
+    std::vector<pwngrid_peer> peers(PWNGRID_MAX_PEERS);
+    portENTER_CRITICAL(&pwngridPeersMux);
+    uint8_t count = pwngrid_friends_tot;
+    memcpy(peers.data(), pwngrid_peers, count * sizeof(pwngrid_peer));
+    portEXIT_CRITICAL(&pwngridPeersMux);
+    peers.resize(count);
+    return peers;
+}
+
+static uint32_t identityHash(const char *identity) {
+    uint32_t hash = 2166136261u;
+    while (*identity) {
+        hash ^= (uint8_t)*identity++;
+        hash *= 16777619u;
     }
+    return hash;
 }
 
-// Delete pwngrid peers
-void delete_peer_gone() { // Delete peers wigh pwngrid_peers.gone = true
-    std::vector<int>
-        peer_gone; // Create a vector of integers to save the index value of the element to be deleted
-    int index = 0;
-    for (const auto &peer_list : pwngrid_peers) {
-        if (peer_list.gone) peer_gone.push_back(index); // Saves the index value into the vector
-        index++;
+/*********************************************************************
+**  Function: update_peer
+**  Refreshes a known peer or takes a slot for a new one, the least
+**  recently seen peer is replaced when the table is full
+**********************************************************************/
+static void update_peer(JsonDocument &json, signed int rssi) {
+    const char *identity = json["identity"] | "";
+    if (*identity == '\0') return;
+
+    pwngrid_peer peer = {};
+    peer.id = identityHash(identity);
+    strlcpy(peer.name, json["name"] | "", sizeof(peer.name));
+    strlcpy(peer.face, json["face"] | "", sizeof(peer.face));
+    strlcpy(peer.grid_version, json["grid_version"] | "", sizeof(peer.grid_version));
+    strlcpy(peer.version, json["version"] | "", sizeof(peer.version));
+    peer.epoch = json["epoch"] | 0;
+    peer.pwnd_run = json["pwnd_run"] | 0;
+    peer.pwnd_tot = json["pwnd_tot"] | 0;
+    peer.uptime = json["uptime"] | 0;
+    peer.rssi = rssi;
+    peer.last_ping = millis();
+
+    portENTER_CRITICAL(&pwngridPeersMux);
+    int slot = -1;
+    int oldest = 0;
+    for (int i = 0; i < pwngrid_friends_tot; i++) {
+        if (pwngrid_peers[i].id == peer.id) {
+            slot = i;
+            break;
+        }
+        if (pwngrid_peers[i].last_ping < pwngrid_peers[oldest].last_ping) oldest = i;
     }
-    std::reverse(
-        peer_gone.begin(), peer_gone.end()
-    ); // Reverse the vector to iterate from the end to the beginning
-    for (auto ind : peer_gone) {
-        pwngrid_peers.erase(pwngrid_peers.begin() + ind); // Delete the peer from the list
-        // Update counter;
-        pwngrid_friends_tot = pwngrid_peers.size();
+    if (slot < 0) {
+        // new friend
+        slot = pwngrid_friends_tot < PWNGRID_MAX_PEERS ? pwngrid_friends_tot++ : oldest;
+        memcpy(pwngrid_last_friend_name, peer.name, sizeof(pwngrid_last_friend_name));
     }
-    peer_gone.clear();
+    pwngrid_peers[slot] = peer;
+    portEXIT_CRITICAL(&pwngridPeersMux);
 }
 
 // Had to remove Radiotap headers, since its automatically added
@@ -175,66 +199,45 @@ esp_err_t pwngridAdvertise(uint8_t channel, String face) {
     return result;
 }
 
-const int away_threshold = 120000;
+const unsigned long away_threshold = 120000;
 
 void checkPwngridGoneFriends() {
-    for (auto peer_list : pwngrid_peers) {
-        // Check if peer is away
-        int away_secs = peer_list.last_ping - millis();
-        if (away_secs > away_threshold) {
-            peer_list.gone = true;
-            delete_peer_gone();
-            return;
+    portENTER_CRITICAL(&pwngridPeersMux);
+    unsigned long now = millis();
+    for (int i = 0; i < pwngrid_friends_tot;) {
+        // Drop peers that went away, the last one fills the hole
+        if (now - pwngrid_peers[i].last_ping > away_threshold) {
+            pwngrid_peers[i] = pwngrid_peers[--pwngrid_friends_tot];
+        } else {
+            i++;
         }
     }
+    portEXIT_CRITICAL(&pwngridPeersMux);
 }
 
 signed int getPwngridClosestRssi() {
     signed int closest = -1000;
 
-    for (auto peer_list : pwngrid_peers) {
-        // Check if peer is away
-        if (peer_list.gone == false && peer_list.rssi > closest) { closest = peer_list.rssi; }
+    portENTER_CRITICAL(&pwngridPeersMux);
+    for (int i = 0; i < pwngrid_friends_tot; i++) {
+        if (pwngrid_peers[i].rssi > closest) { closest = pwngrid_peers[i].rssi; }
     }
+    portEXIT_CRITICAL(&pwngridPeersMux);
 
     return closest;
 }
 
+#define PWNGRID_IE_OFFSET 36 // tagged parameters start after the fixed beacon fields
+#define PWNGRID_IE_TAG 0xde
+
+static const uint8_t pwngridSource[6] = {0xde, 0xad, 0xbe, 0xef, 0xde, 0xad};
+
 // Detect pwnagotchi adapted from Marauder
 // https://github.com/justcallmekoko/ESP32Marauder/wiki/detect-pwnagotchi
 // https://github.com/justcallmekoko/ESP32Marauder/blob/master/esp32_marauder/WiFiScan.cpp#L2255
-typedef struct {
-    int16_t fctl;
-    int16_t duration;
-    uint8_t da;
-    uint8_t sa;
-    uint8_t bssid;
-    int16_t seqctl;
-    unsigned char payload[];
-} __attribute__((packed)) WifiMgmtHdr;
-
-typedef struct {
-    uint8_t payload[0];
-    WifiMgmtHdr hdr;
-} wifi_ieee80211_packet_t;
-
-void getMAC(char *addr, uint8_t *data, uint16_t offset) {
-    sprintf(
-        addr,
-        "%02x:%02x:%02x:%02x:%02x:%02x",
-        data[offset + 0],
-        data[offset + 1],
-        data[offset + 2],
-        data[offset + 3],
-        data[offset + 4],
-        data[offset + 5]
-    );
-}
-
 void pwnSnifferCallback(void *buf, wifi_promiscuous_pkt_type_t type) {
     sniffer(buf, type);
     wifi_promiscuous_pkt_t *snifferPacket = (wifi_promiscuous_pkt_t *)buf;
-    WifiMgmtHdr *frameControl = (WifiMgmtHdr *)snifferPacket->payload;
 
     const uint8_t *frame = snifferPacket->payload;
     const uint16_t frameCtrl = (uint16_t)frame[0] | ((uint16_t)frame[1] << 8);
@@ -260,50 +263,120 @@ void pwnSnifferCallback(void *buf, wifi_promiscuous_pkt_type_t type) {
         }
     }
 
-    String src = "";
-    String essid = "";
-
-    if (type == WIFI_PKT_MGMT) {
-        // Remove frame check sequence bytes
-        int len = snifferPacket->rx_ctrl.sig_len - 4;
-        int fctl = ntohs(frameControl->fctl);
-        const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)snifferPacket->payload;
-        const WifiMgmtHdr *hdr = &ipkt->hdr;
-
-        // if ((snifferPacket->payload[0] == 0x80) && (buf == 0)) {
-        if ((snifferPacket->payload[0] == 0x80)) {
-            char addr[] = "00:00:00:00:00:00";
-            getMAC(addr, snifferPacket->payload, 10);
-            src.concat(addr);
-            if (src == "de:ad:be:ef:de:ad") {
-                // Just grab the first 255 bytes of the pwnagotchi beacon
-                // because that is where the name is
-                for (int i = 38; i < len; i++) {
-                    if (isAscii(snifferPacket->payload[i])) { essid.concat((char)snifferPacket->payload[i]); }
-                }
-
-                JsonDocument sniffed_json; // ArduinoJson v6s
-                DeserializationError result = deserializeJson(sniffed_json, essid);
-
-                if (result == DeserializationError::Ok) {
-                    // Serial.println("\nSuccessfully parsed json");
-                    // serializeJson(json, Serial);  // ArduinoJson v6
-                    add_new_peer(sniffed_json, snifferPacket->rx_ctrl.rssi);
-                } else if (result == DeserializationError::IncompleteInput) {
-                    Serial.println("Deserialization error: incomplete input");
-                } else if (result == DeserializationError::NoMemory) {
-                    Serial.println("Deserialization error: no memory");
-                } else if (result == DeserializationError::InvalidInput) {
-                    Serial.println("Deserialization error: invalid input");
-                } else if (result == DeserializationError::TooDeep) {
-                    Serial.println("Deserialization error: too deep");
-                } else {
-                    Serial.println(essid);
-                    Serial.println("Deserialization error");
-                }
+    // Only the vendor IEs of pwnagotchi beacons are copied, the parser task does the rest
+    if (type != WIFI_PKT_MGMT || frame[0] != 0x80 || pwngridRing == nullptr) return;
+    if (memcmp(frame + 10, pwngridSource, 6) != 0) return;
+
+    uint32_t head = pwngridRingHead.load(std::memory_order_relaxed);
+    if (head - pwngridRingTail.load(std::memory_order_acquire) >= PWNGRID_RING_SLOTS) {
+        pwngridRingDrops++;
+        return;
+    }
+    PwngridFrame &slot = pwngridRing[head % PWNGRID_RING_SLOTS];
+    int len = snifferPacket->rx_ctrl.sig_len - 4; // Remove frame check sequence bytes
+    slot.len = 0;
+    slot.rssi = snifferPacket->rx_ctrl.rssi;
+    for (int i = PWNGRID_IE_OFFSET; i + 2 <= len; i += 2 + frame[i + 1]) {
+        uint8_t ieLen = frame[i + 1];
+        if (frame[i] != PWNGRID_IE_TAG || i + 2 + ieLen > len) continue;
+        if (slot.len + 2 + ieLen > PWNGRID_PAYLOAD_MAX) break;
+        memcpy(slot.data + slot.len, frame + i, 2 + ieLen);
+        slot.len += 2 + ieLen;
+    }
+    if (slot.len == 0) return;
+    pwngridRingHead.store(head + 1, std::memory_order_release);
+    if (pwngridTask != NULL) xTaskNotifyGive(pwngridTask);
+}
+
+// Bump allocator over a fixed buffer, reset after every beacon so parsing never touches the heap
+class PwngridArena : public ArduinoJson::Allocator {
+public:
+    void *allocate(size_t size) override {
+        size = align(size);
+        if (used + HEADER + size > sizeof(buffer)) return nullptr;
+        *(size_t *)(buffer + used) = size;
+        last = buffer + used + HEADER;
+        used += HEADER + size;
+        return last;
+    }
+
+    void deallocate(void *ptr) override {}
+
+    void *reallocate(void *ptr, size_t newSize) override {
+        if (ptr == nullptr) return allocate(newSize);
+        uint8_t *block = (uint8_t *)ptr;
+        size_t oldSize = *(size_t *)(block - HEADER);
+        newSize = align(newSize);
+        if (block == last) {
+            // the most recent block can grow or shrink in place
+            if (block - buffer + newSize > sizeof(buffer)) return nullptr;
+            *(size_t *)(block - HEADER) = newSize;
+            used = block - buffer + newSize;
+            return ptr;
+        }
+        if (newSize <= oldSize) return ptr;
+        void *moved = allocate(newSize);
+        if (moved != nullptr) memcpy(moved, ptr, oldSize);
+        return moved;
+    }
+
+    void reset() {
+        used = 0;
+        last = nullptr;
+    }
+
+private:
+    static constexpr size_t HEADER = 8; // block size, keeps every block 8 byte aligned
+    static size_t align(size_t size) { return (size + 7) & ~(size_t)7; }
+
+    alignas(8) uint8_t buffer[PWNGRID_ARENA_SIZE];
+    size_t used = 0;
+    uint8_t *last = nullptr;
+};
+
+/*********************************************************************
+**  Function: pwngridParserTask
+**  Joins the IE fragments of each queued beacon and parses only the
+**  fields the peer table keeps
+**********************************************************************/
+static void pwngridParserTask(void *param) {
+    PwngridArena *arena = new PwngridArena;
+    char *json = (char *)malloc(PWNGRID_PAYLOAD_MAX);
+    JsonDocument filter;
+    const char *fields[] = {
+        "identity", "name", "face", "grid_version", "version", "epoch", "pwnd_run", "pwnd_tot", "uptime"
+    };
+    for (const char *field : fields) filter[field] = true;
+
+    while (!pwngridTaskStop) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(500));
+        uint32_t tail = pwngridRingTail.load(std::memory_order_relaxed);
+        while (json != nullptr && tail != pwngridRingHead.load(std::memory_order_acquire)) {
+            const PwngridFrame &slot = pwngridRing[tail % PWNGRID_RING_SLOTS];
+            size_t jsonLen = 0;
+            for (size_t i = 0; i + 2 <= slot.len; i += 2 + slot.data[i + 1]) {
+                memcpy(json + jsonLen, slot.data + i + 2, slot.data[i + 1]);
+                jsonLen += slot.data[i + 1];
+            }
+            signed int rssi = slot.rssi;
+            pwngridRingTail.store(++tail, std::memory_order_release);
+
+            arena->reset();
+            JsonDocument sniffed_json(arena);
+            DeserializationError result =
+                deserializeJson(sniffed_json, json, jsonLen, DeserializationOption::Filter(filter));
+            if (result == DeserializationError::Ok) {
+                update_peer(sniffed_json, rssi);
+            } else {
+                Serial.printf("Pwngrid deserialization error: %s\n", result.c_str());
             }
         }
     }
+
+    free(json);
+    delete arena;
+    pwngridTask = NULL;
+    vTaskDelete(NULL);
 }
 
 const wifi_promiscuous_filter_t filter = {
@@ -311,6 +384,17 @@ const wifi_promiscuous_filter_t filter = {
 };
 
 void initPwngrid() {
+    if (pwngridRing == nullptr) {
+        pwngridRing = (PwngridFrame *)malloc(PWNGRID_RING_SLOTS * sizeof(PwngridFrame));
+    }
+    pwngridRingHead = 0;
+    pwngridRingTail = 0;
+    pwngridRingDrops = 0;
+    if (pwngridTask == NULL) {
+        pwngridTaskStop = false;
+        xTaskCreate(pwngridParserTask, "pwngridParser", 4096, NULL, 1, &pwngridTask);
+    }
+
     wifi_init_config_t WIFI_INIT_CONFIG = WIFI_INIT_CONFIG_DEFAULT();
     esp_wifi_init(&WIFI_INIT_CONFIG);
     esp_wifi_set_storage(WIFI_STORAGE_RAM);
@@ -323,3 +407,16 @@ void initPwngrid() {
     esp_wifi_set_channel(random(0, 14), WIFI_SECOND_CHAN_NONE);
     vTaskDelay(1 / portTICK_RATE_MS);
 }
+
+void stopPwngrid() {
+    esp_wifi_set_promiscuous(false);
+    esp_wifi_set_promiscuous_rx_cb(nullptr);
+    if (pwngridRingDrops > 0) log_d("Pwngrid: %lu beacons dropped", (unsigned long)pwngridRingDrops);
+    if (pwngridTask != NULL) {
+        pwngridTaskStop = true;
+        xTaskNotifyGive(pwngridTask);
+        while (pwngridTask != NULL) vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    free(pwngridRing);
+    pwngridRing = nullptr;
+}
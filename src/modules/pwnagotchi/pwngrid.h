@@ -13,24 +13,27 @@ Thanks to @bmorcelli for his help doing a better code.
 #include <Arduino.h>
 #include <vector>
 
+#define PWNGRID_MAX_PEERS 32     // fixed peer table, the least recently seen peer makes room
+#define PWNGRID_RING_SLOTS 8     // beacons waiting for the parser task
+#define PWNGRID_PAYLOAD_MAX 1280 // vendor IE bytes kept per beacon
+#define PWNGRID_ARENA_SIZE 8192  // fixed buffer the JSON parser allocates from
+
 typedef struct {
+    uint32_t id; // FNV-1a hash of the identity
+    char name[32];
+    char face[32];
+    char grid_version[16];
+    char version[16];
     int epoch;
-    String face;
-    String grid_version;
-    String identity;
-    String name;
     int pwnd_run;
     int pwnd_tot;
-    String session_id;
-    int timestamp;
     int uptime;
-    String version;
     signed int rssi;
     unsigned long last_ping;
-    bool gone;
 } pwngrid_peer;
 
 void initPwngrid();
+void stopPwngrid();
 esp_err_t pwngridAdvertise(uint8_t channel, String face);
 std::vector<pwngrid_peer> getPwngridPeers();
 uint8_t getPwngridRunTotalPeers();
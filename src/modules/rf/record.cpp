@@ -1,4 +1,5 @@
 #include "record.h"
+#include "rf_hop_cache.h"
 #include "rf_utils.h"
 #include <ELECHOUSE_CC1101_SRC_DRV.h>
 
@@ -97,9 +98,10 @@ float rf_freq_scan() {
             idx = range_limits[bruceConfig.rfScanRange][0];
         }
         float checkFrequency = subghz_frequency_list[idx];
-        setMHZ(checkFrequency);
+        setFrequencyIndex(idx);
         tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
-        vTaskDelay(5 / portTICK_PERIOD_MS);
+        // no synthesizer calibration when hopping, RSSI settles much faster
+        vTaskDelay((bruceConfig.rfFastHop ? 1 : 5) / portTICK_PERIOD_MS);
         rssi = ELECHOUSE_cc1101.getRssi();
         if (rssi > rssiThreshold) {
             best_frequencies[attempt].freq = checkFrequency;
@@ -122,6 +124,9 @@ float rf_freq_scan() {
         bruceConfig.setRfFreq(433.92, 2);
 #endif
     }
+#if defined(USE_CC1101_VIA_SPI)
+    rfHopEnd();
+#endif
     return frequency;
 }
 
@@ -136,11 +141,19 @@ void rf_range_selection(float currentFrequency = 0.0) {
         {subghz_frequency_ranges[1],                                   [=]() { bruceConfig.setRfScanRange(1); }},
         {subghz_frequency_ranges[2],                                   [=]() { bruceConfig.setRfScanRange(2); }},
         {subghz_frequency_ranges[3],                                   [=]() { bruceConfig.setRfScanRange(3); }},
+        {String("Fast hop [" + String(bruceConfig.rfFastHop ? "ON" : "OFF") + "]").c_str(),
+         [&]() { option = 2; }                                                                                   },
     };
 
     loopOptions(options);
     options.clear();
 
+    if (option == 2) {
+        bruceConfig.setRfFastHop(!bruceConfig.rfFastHop);
+        displayTextLine(String("Fast hop ") + (bruceConfig.rfFastHop ? "enabled" : "disabled"));
+        return rf_range_selection(currentFrequency);
+    }
+
     if (option == 1) { // Fixed Frequency Selector
         options = {};
         int ind = 0;
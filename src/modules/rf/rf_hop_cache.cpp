@@ -0,0 +1,159 @@
+#include "rf_hop_cache.h"
+#include "core/display.h"
+#include "core/settings.h"
+
+#define CC1101_MARCSTATE_IDLE 0x01
+#define CC1101_FS_AUTOCAL_MASK 0x30
+
+static RfHopEntry hop_table[RF_HOP_CHANNELS];
+static bool hop_active = false;
+static uint8_t saved_mcsm0 = 0;
+static unsigned long calibrated_at = 0;
+static float calibrated_temp = 0;
+static int calibrated_bat = 0;
+static int calibrated_first = 0;
+static int calibrated_last = -1;
+static unsigned long drift_checked_at = 0;
+static uint32_t spi_transactions = 0;
+
+static inline void hopStrobe(uint8_t strobe) {
+    ELECHOUSE_cc1101.SpiStrobe(strobe);
+    spi_transactions++;
+}
+
+static inline uint8_t hopRead(uint8_t addr) {
+    spi_transactions++;
+    return ELECHOUSE_cc1101.SpiReadReg(addr);
+}
+
+static inline void hopWriteBurst(uint8_t addr, uint8_t *buf, uint8_t len) {
+    ELECHOUSE_cc1101.SpiWriteBurstReg(addr, buf, len);
+    spi_transactions++;
+}
+
+static bool waitIdle() {
+    unsigned long start = micros();
+    while ((ELECHOUSE_cc1101.SpiReadStatus(CC1101_MARCSTATE) & 0x1F) != CC1101_MARCSTATE_IDLE) {
+        if (micros() - start > 2000) return false;
+    }
+    return true;
+}
+
+/*********************************************************************
+**  Function: rfHopCalibrate
+**  Runs one manual calibration per entry of subghz_frequency_list[first..last]
+**  and stores the registers needed to return to it without calibrating.
+**  Leaves the radio in RX with autocalibration disabled until rfHopEnd()
+**********************************************************************/
+bool rfHopCalibrate(int first, int last) {
+    if (bruceConfig.rfModule != CC1101_SPI_MODULE) return false;
+    if (first < 0) first = 0;
+    if (last >= (int)RF_HOP_CHANNELS) last = RF_HOP_CHANNELS - 1;
+
+    if (!hop_active) saved_mcsm0 = ELECHOUSE_cc1101.SpiReadReg(CC1101_MCSM0);
+    // FS_AUTOCAL = 00: never calibrate automatically, the cached FSCAL values are used instead
+    ELECHOUSE_cc1101.SpiWriteReg(CC1101_MCSM0, saved_mcsm0 & ~CC1101_FS_AUTOCAL_MASK);
+    hop_active = true;
+
+    bool ok = true;
+    for (int i = first; i <= last; i++) {
+        hopStrobe(CC1101_SIDLE);
+        setMHZ(subghz_frequency_list[i]);
+        hopStrobe(CC1101_SCAL);
+        if (!waitIdle()) {
+            hop_table[i].valid = false;
+            ok = false;
+            continue;
+        }
+        hop_table[i].fsctrl0 = hopRead(CC1101_FSCTRL0);
+        hop_table[i].freq[0] = hopRead(CC1101_FREQ2);
+        hop_table[i].freq[1] = hopRead(CC1101_FREQ1);
+        hop_table[i].freq[2] = hopRead(CC1101_FREQ0);
+        hop_table[i].fscal[0] = hopRead(CC1101_FSCAL3);
+        hop_table[i].fscal[1] = hopRead(CC1101_FSCAL2);
+        hop_table[i].fscal[2] = hopRead(CC1101_FSCAL1);
+        hop_table[i].valid = true;
+    }
+    hopStrobe(CC1101_SRX);
+
+    calibrated_at = millis();
+    drift_checked_at = calibrated_at;
+    calibrated_temp = temperatureRead();
+    calibrated_bat = getBattery ? getBattery() : 0;
+    calibrated_first = first;
+    calibrated_last = last;
+    log_d("CC1101 hop table calibrated: %d channels", last - first + 1);
+    return ok;
+}
+
+/*********************************************************************
+**  Function: rfHopIsStale
+**  The synthesizer drifts with temperature and supply voltage, so the cached
+**  FSCAL values are only trusted for a limited time and environment window
+**********************************************************************/
+bool rfHopIsStale() {
+    if (!hop_active) return true;
+    if (millis() - calibrated_at > RF_HOP_MAX_AGE_MS) return true;
+    // temperature and battery are slow to read and slow to drift
+    if (millis() - drift_checked_at < RF_HOP_DRIFT_CHECK_MS) return false;
+    drift_checked_at = millis();
+    if (fabs(temperatureRead() - calibrated_temp) > RF_HOP_MAX_TEMP_DRIFT) return true;
+    if (getBattery && abs(getBattery() - calibrated_bat) > RF_HOP_MAX_BAT_DRIFT) return true;
+    return false;
+}
+
+void rfHopInvalidate() {
+    for (size_t i = 0; i < RF_HOP_CHANNELS; i++) hop_table[i].valid = false;
+}
+
+/*********************************************************************
+**  Function: rfHopEnd
+**  Restores autocalibration so regular setMHZ() callers keep working
+**********************************************************************/
+void rfHopEnd() {
+    if (!hop_active) return;
+    ELECHOUSE_cc1101.SpiWriteReg(CC1101_MCSM0, saved_mcsm0);
+    hop_active = false;
+    calibrated_last = -1;
+    rfHopInvalidate();
+}
+
+/*********************************************************************
+**  Function: rfHopTo
+**  IDLE, two register bursts and RX: 4 SPI transactions, no calibration.
+**  The whole scan range is calibrated on the first hop, when idx is out
+**  of the calibrated range, and when the table goes stale
+**********************************************************************/
+void rfHopTo(int idx) {
+    if (idx < 0 || idx >= (int)RF_HOP_CHANNELS) return;
+    if (idx < calibrated_first || idx > calibrated_last || rfHopIsStale()) {
+        int first = range_limits[bruceConfig.rfScanRange][0];
+        int last = range_limits[bruceConfig.rfScanRange][1];
+        rfHopCalibrate(min(first, idx), max(last, idx));
+    }
+    // a channel that failed to calibrate is tuned the slow way, the others stay cached
+    if (!hop_table[idx].valid) {
+        setMHZ(subghz_frequency_list[idx]);
+        return;
+    }
+
+    RfHopEntry &e = hop_table[idx];
+    uint8_t freqRegs[4] = {e.fsctrl0, e.freq[0], e.freq[1], e.freq[2]};
+    rfSelectAntenna(subghz_frequency_list[idx]);
+    hopStrobe(CC1101_SIDLE);
+    hopWriteBurst(CC1101_FSCTRL0, freqRegs, sizeof(freqRegs));
+    hopWriteBurst(CC1101_FSCAL3, e.fscal, sizeof(e.fscal));
+    hopStrobe(CC1101_SRX);
+}
+
+/*********************************************************************
+**  Function: setFrequencyIndex
+**  Scan helper: tunes to subghz_frequency_list[idx], through the hop
+**  table when fast hop is enabled, or through setMHZ() otherwise
+**********************************************************************/
+void setFrequencyIndex(int idx) {
+    if (bruceConfig.rfFastHop && bruceConfig.rfModule == CC1101_SPI_MODULE) rfHopTo(idx);
+    else setMHZ(subghz_frequency_list[idx]);
+}
+
+uint32_t rfHopSpiTransactions() { return spi_transactions; }
@@ -0,0 +1,33 @@
+#ifndef __RF_HOP_CACHE_H__
+#define __RF_HOP_CACHE_H__
+
+#include "rf_utils.h"
+
+// CC1101 fast frequency hopping (datasheet section 28.2).
+// Each entry of subghz_frequency_list is calibrated once, the resulting frequency and FSCAL registers are
+// stored, and later hops write them back in a burst with autocalibration disabled, skipping the ~800us
+// synthesizer calibration on every IDLE->RX transition.
+
+#define RF_HOP_CHANNELS (sizeof(subghz_frequency_list) / sizeof(subghz_frequency_list[0]))
+#define RF_HOP_MAX_AGE_MS 300000   // recalibrate at least every 5 minutes
+#define RF_HOP_MAX_TEMP_DRIFT 10   // degrees Celsius since last calibration
+#define RF_HOP_MAX_BAT_DRIFT 20    // battery percent since last calibration (supply voltage proxy)
+#define RF_HOP_DRIFT_CHECK_MS 2000 // temperature and battery are read at most this often
+
+struct RfHopEntry {
+    uint8_t fsctrl0; // FSCTRL0 -> FREQ0 are contiguous, written as one burst
+    uint8_t freq[3];
+    uint8_t fscal[3]; // FSCAL3 -> FSCAL1
+    bool valid;
+};
+
+bool rfHopCalibrate(int first, int last);
+bool rfHopIsStale();
+void rfHopInvalidate();
+void rfHopEnd();
+void rfHopTo(int idx);
+void setFrequencyIndex(int idx);
+
+uint32_t rfHopSpiTransactions();
+
+#endif
@@ -2,13 +2,17 @@
 #include "core/led_control.h"
 #include "core/sd_functions.h"
 #include "core/type_convertion.h"
+#include "rf_hop_cache.h"
 #include "rf_send.h"
 #include <globals.h>
 #include <sstream>
 
 RFScan::RFScan() { setup(); }
 
-RFScan::~RFScan() { deinitRfModule(); }
+RFScan::~RFScan() {
+    rfHopEnd();
+    deinitRfModule();
+}
 
 void RFScan::setup() {
     if (!initRfModule("rx", bruceConfig.rfFreq)) { return; }
@@ -87,9 +91,9 @@ bool RFScan::fast_scan() {
         idx = range_limits[bruceConfig.rfScanRange][0];
     }
     float checkFrequency = subghz_frequency_list[idx];
-    setMHZ(checkFrequency);
+    setFrequencyIndex(idx);
     tft.drawPixel(0, 0, 0); // To make sure CC1101 shared with TFT works properly
-    vTaskDelay(5 / portTICK_PERIOD_MS);
+    vTaskDelay((bruceConfig.rfFastHop ? 1 : 5) / portTICK_PERIOD_MS);
     rssi = ELECHOUSE_cc1101.getRssi();
     if (rssi > rssiThreshold) {
         _freqs[_try].freq = checkFrequency;
@@ -103,6 +107,7 @@ bool RFScan::fast_scan() {
 
             bruceConfig.setRfFreq(_freqs[max_index].freq, 2); // change to fixed frequency
             frequency = _freqs[max_index].freq;
+            rfHopEnd();
             setMHZ(frequency);
             Serial.println("Frequency Found: " + String(frequency));
             rcswitch.resetAvailable();
@@ -343,6 +348,7 @@ void RFScan::set_threshold() {
 
 void RFScan::set_range() {
     bool chooseFixedOpt = false;
+    bool toggleFastHop = false;
 
     options = {
         {String("Fxd [" + String(bruceConfig.rfFreq) + "]").c_str(),
@@ -352,10 +358,19 @@ void RFScan::set_range() {
         {subghz_frequency_ranges[1],                                 [=]() { bruceConfig.setRfScanRange(1); }},
         {subghz_frequency_ranges[2],                                 [=]() { bruceConfig.setRfScanRange(2); }},
         {subghz_frequency_ranges[3],                                 [=]() { bruceConfig.setRfScanRange(3); }},
+        {String("Fast hop [" + String(bruceConfig.rfFastHop ? "ON" : "OFF") + "]").c_str(),
+         [&]() { toggleFastHop = true; }                                                                     },
     };
 
     loopOptions(options);
 
+    // same as rf_range_selection: the menu comes back so a range can be picked with the new mode
+    if (toggleFastHop) {
+        bruceConfig.setRfFastHop(!bruceConfig.rfFastHop);
+        displayTextLine(String("Fast hop ") + (bruceConfig.rfFastHop ? "enabled" : "disabled"));
+        return set_range();
+    }
+
     if (chooseFixedOpt) { // Range
         options.clear();
         int ind = 0;
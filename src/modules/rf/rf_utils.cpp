@@ -267,11 +267,7 @@ void initRMT() {
     }
 }
 
-void setMHZ(float frequency) {
-    if (frequency > 928 || frequency < 280) {
-        frequency = 433.92;
-        Serial.println("Frequency out of band");
-    }
+void rfSelectAntenna(float frequency) {
 #if defined(T_EMBED)
     static uint8_t antenna = 200; // 0=(<300), 1=(350-468), 2=(>778), 200=start to settle at the fisrt time
     bool change = true;
@@ -302,7 +298,14 @@ void setMHZ(float frequency) {
         vTaskDelay(10 / portTICK_PERIOD_MS); // time to settle the antenna signal
     }
 #endif
+}
 
+void setMHZ(float frequency) {
+    if (frequency > 928 || frequency < 280) {
+        frequency = 433.92;
+        Serial.println("Frequency out of band");
+    }
+    rfSelectAntenna(frequency);
     ELECHOUSE_cc1101.setMHZ(frequency);
 }
 
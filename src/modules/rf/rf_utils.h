@@ -24,6 +24,7 @@ void initRMT();
 void deinitRMT();
 
 void setMHZ(float frequency);
+void rfSelectAntenna(float frequency);
 int find_pulse_index(const std::vector<int> &indexed_durations, int duration);
 uint64_t crc64_ecma(const std::vector<int> &data);
 
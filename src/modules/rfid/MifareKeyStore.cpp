@@ -0,0 +1,263 @@
+/**
+ * @file MifareKeyStore.cpp
+ * @brief Mifare Classic key dictionary, ranked by hits and cached per card UID
+ */
+
+#include "MifareKeyStore.h"
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <algorithm>
+#include <globals.h>
+
+static const char sectorKeyChars[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+static String keyToHex(const uint8_t *key) {
+    char hex[13];
+    snprintf(hex, sizeof(hex), "%02X%02X%02X%02X%02X%02X", key[0], key[1], key[2], key[3], key[4], key[5]);
+    return String(hex);
+}
+
+static bool hexToKey(const String &hex, uint8_t *key) {
+    if (hex.length() != 12) return false;
+    for (int i = 0; i < 6; i++) {
+        char byteHex[3] = {hex[i * 2], hex[i * 2 + 1], 0};
+        char *end;
+        key[i] = strtoul(byteHex, &end, 16);
+        if (*end != 0) return false;
+    }
+    return true;
+}
+
+MifareKeyStore &MifareKeyStore::instance() {
+    static MifareKeyStore store;
+    return store;
+}
+
+void MifareKeyStore::loadDictionary(const uint8_t (*builtIn)[6], size_t count) {
+    bool wasDirty = dirty;
+    if (!loaded) {
+        load();
+        rankDictionary();
+        loaded = true;
+        wasDirty = false;
+    }
+    // built-in and user keys are few and cheap to merge, the config menu can add keys at any time
+    for (size_t i = 0; i < count; i++) learnKey(builtIn[i]);
+    for (const auto &mifKey : bruceConfig.mifareKeys) {
+        uint8_t key[6];
+        if (hexToKey(mifKey, key)) learnKey(key);
+    }
+    dirty = wasDirty;
+}
+
+void MifareKeyStore::learnKey(const uint8_t *key) {
+    for (const auto &entry : dict) {
+        if (memcmp(entry.key, key, 6) == 0) return;
+    }
+    DictKey entry;
+    memcpy(entry.key, key, 6);
+    entry.hits = 0;
+    dict.push_back(entry);
+    dirty = true;
+}
+
+void MifareKeyStore::rankDictionary() {
+    std::stable_sort(dict.begin(), dict.end(), [](const DictKey &a, const DictKey &b) {
+        return a.hits > b.hits;
+    });
+}
+
+void MifareKeyStore::load() {
+    if (!LittleFS.exists(MIFARE_KEYS_FILE)) return;
+    File file = LittleFS.open(MIFARE_KEYS_FILE, FILE_READ);
+    if (!file) return;
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        log_w("Failed to read %s: %s", MIFARE_KEYS_FILE, error.c_str());
+        return;
+    }
+
+    for (JsonPair pair : doc["hits"].as<JsonObject>()) {
+        uint8_t key[6];
+        if (!hexToKey(pair.key().c_str(), key)) continue;
+        learnKey(key);
+        for (auto &entry : dict) {
+            if (memcmp(entry.key, key, 6) == 0) entry.hits = pair.value().as<uint16_t>();
+        }
+    }
+
+    cards.clear();
+    for (JsonObject obj : doc["cards"].as<JsonArray>()) {
+        if (cards.size() >= MIFARE_CARD_CACHE_SIZE) break;
+        CardKeys c;
+        c.uid = obj["uid"].as<String>();
+        for (JsonVariant k : obj["keys"].as<JsonArray>()) {
+            std::array<uint8_t, 6> key;
+            if (c.keys.size() >= MIFARE_CARD_MAX_KEYS) break;
+            if (hexToKey(k.as<String>(), key.data())) c.keys.push_back(key);
+        }
+        const char *sectors[2] = {obj["a"] | "", obj["b"] | ""};
+        for (int t = 0; t < 2; t++) {
+            size_t len = strlen(sectors[t]);
+            for (size_t s = 0; s < MIFARE_MAX_SECTORS; s++) {
+                const char *idx = s < len ? strchr(sectorKeyChars, sectors[t][s]) : nullptr;
+                int i = idx != nullptr ? idx - sectorKeyChars : -1;
+                c.sectorKey[t][s] = i < (int)c.keys.size() ? i : -1;
+            }
+        }
+        cards.push_back(c);
+    }
+}
+
+void MifareKeyStore::save() {
+    JsonDocument doc;
+    JsonObject hits = doc["hits"].to<JsonObject>();
+    for (const auto &entry : dict) hits[keyToHex(entry.key)] = entry.hits;
+
+    JsonArray cardsArr = doc["cards"].to<JsonArray>();
+    for (const auto &c : cards) {
+        JsonObject obj = cardsArr.add<JsonObject>();
+        obj["uid"] = c.uid;
+        JsonArray keys = obj["keys"].to<JsonArray>();
+        for (const auto &key : c.keys) keys.add(keyToHex(key.data()));
+        for (int t = 0; t < 2; t++) {
+            char sectors[MIFARE_MAX_SECTORS + 1];
+            for (int s = 0; s < MIFARE_MAX_SECTORS; s++) {
+                sectors[s] = c.sectorKey[t][s] < 0 ? '-' : sectorKeyChars[c.sectorKey[t][s]];
+            }
+            sectors[MIFARE_MAX_SECTORS] = 0;
+            obj[t == 0 ? "a" : "b"] = sectors;
+        }
+    }
+
+    File file = LittleFS.open(MIFARE_KEYS_FILE, FILE_WRITE);
+    if (!file) return;
+    serializeJson(doc, file);
+    file.close();
+    dirty = false;
+}
+
+void MifareKeyStore::beginCard(const uint8_t *uid, uint8_t uidSize) {
+    String uidHex = "";
+    for (uint8_t i = 0; i < uidSize; i++) {
+        if (uid[i] < 0x10) uidHex += "0";
+        uidHex += String(uid[i], HEX);
+    }
+    if (card != nullptr && card->uid == uidHex) return;
+
+    sessionKeys.clear();
+    attempts = 0;
+    CardKeys entry;
+    auto it = std::find_if(cards.begin(), cards.end(), [&](const CardKeys &c) { return c.uid == uidHex; });
+    if (it != cards.end()) {
+        entry = *it;
+        cards.erase(it);
+        for (const auto &key : entry.keys) sessionKeys.push_back(key);
+    } else {
+        entry.uid = uidHex;
+        memset(entry.sectorKey, -1, sizeof(entry.sectorKey));
+        if (cards.size() >= MIFARE_CARD_CACHE_SIZE) cards.pop_back();
+    }
+    cards.insert(cards.begin(), entry);
+    card = &cards.front();
+}
+
+void MifareKeyStore::recordHit(uint8_t sector, MifareKeyType type, const uint8_t *key) {
+    std::array<uint8_t, 6> k;
+    memcpy(k.data(), key, 6);
+
+    auto s = std::find(sessionKeys.begin(), sessionKeys.end(), k);
+    if (s != sessionKeys.end()) sessionKeys.erase(s);
+    sessionKeys.insert(sessionKeys.begin(), k);
+
+    for (auto &entry : dict) {
+        if (memcmp(entry.key, key, 6) == 0 && entry.hits < UINT16_MAX) entry.hits++;
+    }
+
+    auto c = std::find(card->keys.begin(), card->keys.end(), k);
+    int idx = c - card->keys.begin();
+    if (c == card->keys.end()) {
+        if (card->keys.size() >= MIFARE_CARD_MAX_KEYS) return;
+        card->keys.push_back(k);
+    }
+    card->sectorKey[type][sector] = idx;
+    dirty = true;
+}
+
+/*********************************************************************
+**  Function: authenticate
+**  Each distinct key is tried once per sector, in order of how likely
+**  it is to open it
+**********************************************************************/
+MifareAuthResult MifareKeyStore::authenticate(uint8_t sector, MifareKeyType type, TryKey tryKey) {
+    if (card == nullptr || sector >= MIFARE_MAX_SECTORS) return MIFARE_AUTH_FAILED;
+
+    std::vector<const uint8_t *> tried;
+    tried.reserve(dict.size() + sessionKeys.size() + 1);
+    auto attempt = [&](const uint8_t *key) -> MifareAuthResult {
+        for (const uint8_t *t : tried) {
+            if (memcmp(t, key, 6) == 0) return MIFARE_AUTH_FAILED;
+        }
+        tried.push_back(key);
+        attempts++;
+        MifareAuthResult result = tryKey(key);
+        if (result == MIFARE_AUTH_OK) recordHit(sector, type, key);
+        return result;
+    };
+
+    int8_t cached = card->sectorKey[type][sector];
+    if (cached >= 0) {
+        MifareAuthResult result = attempt(card->keys[cached].data());
+        if (result != MIFARE_AUTH_FAILED) return result;
+    }
+
+    // copy, a hit reorders the session keys
+    std::vector<std::array<uint8_t, 6>> found = sessionKeys;
+    for (const auto &key : found) {
+        MifareAuthResult result = attempt(key.data());
+        if (result != MIFARE_AUTH_FAILED) return result;
+    }
+
+    for (const auto &entry : dict) {
+        MifareAuthResult result = attempt(entry.key);
+        if (result != MIFARE_AUTH_FAILED) return result;
+    }
+    return MIFARE_AUTH_FAILED;
+}
+
+bool MifareKeyStore::sectorKey(uint8_t sector, MifareKeyType type, uint8_t *key) const {
+    if (card == nullptr || sector >= MIFARE_MAX_SECTORS) return false;
+    int8_t idx = card->sectorKey[type][sector];
+    if (idx < 0) return false;
+    memcpy(key, card->keys[idx].data(), 6);
+    return true;
+}
+
+void MifareKeyStore::endCard() {
+    if (card != nullptr) {
+        log_d("Mifare: %lu auth attempts for card %s", (unsigned long)attempts, card->uid.c_str());
+    }
+    card = nullptr;
+    sessionKeys.clear();
+    if (!dirty) return;
+    rankDictionary();
+    save();
+}
+
+void MifareKeyStore::importKey(
+    const uint8_t *uid, uint8_t uidSize, uint8_t sector, MifareKeyType type, const uint8_t *key
+) {
+    loadDictionary(nullptr, 0);
+    learnKey(key);
+    // not while a reader session owns the card pointer
+    if (card == nullptr && sector < MIFARE_MAX_SECTORS) {
+        beginCard(uid, uidSize);
+        recordHit(sector, type, key);
+        card = nullptr;
+        sessionKeys.clear();
+    }
+    rankDictionary();
+    save();
+}
@@ -0,0 +1,86 @@
+/**
+ * @file MifareKeyStore.h
+ * @brief Mifare Classic key dictionary, ranked by hits and cached per card UID
+ */
+
+#ifndef __MIFARE_KEY_STORE_H__
+#define __MIFARE_KEY_STORE_H__
+
+#include <Arduino.h>
+#include <array>
+#include <functional>
+#include <vector>
+
+#define MIFARE_KEYS_FILE "/bruce_mfkeys.json"
+#define MIFARE_MAX_SECTORS 40
+#define MIFARE_CARD_CACHE_SIZE 16 // cards remembered, the oldest is forgotten first
+#define MIFARE_CARD_MAX_KEYS 36   // distinct keys kept per card
+
+enum MifareKeyType { MIFARE_KEY_A = 0, MIFARE_KEY_B = 1 };
+
+enum MifareAuthResult {
+    MIFARE_AUTH_OK,
+    MIFARE_AUTH_FAILED, // wrong key, the reader already brought the card back
+    MIFARE_AUTH_LOST,   // the card left the field
+};
+
+class MifareKeyStore {
+public:
+    typedef std::function<MifareAuthResult(const uint8_t *key)> TryKey;
+
+    static MifareKeyStore &instance();
+
+    // Reads the saved file once, built-in and user keys are merged on every call
+    void loadDictionary(const uint8_t (*builtIn)[6], size_t count);
+
+    // Starts a session for the card, keeps the current one when the UID is the same
+    void beginCard(const uint8_t *uid, uint8_t uidSize);
+
+    // Card cache, keys found on earlier sectors, then the dictionary by hits
+    MifareAuthResult authenticate(uint8_t sector, MifareKeyType type, TryKey tryKey);
+
+    // Persists hit counts and the keys of the card
+    void endCard();
+
+    // Key that opened the sector of the current card, false when unknown
+    bool sectorKey(uint8_t sector, MifareKeyType type, uint8_t *key) const;
+
+    // Adds a key to the dictionary
+    void learnKey(const uint8_t *key);
+
+    // Saves a key recovered elsewhere (e.g. mfkey) for the dictionary and the card
+    void importKey(
+        const uint8_t *uid, uint8_t uidSize, uint8_t sector, MifareKeyType type, const uint8_t *key
+    );
+
+    static uint8_t blockToSector(uint8_t block) { return block < 128 ? block / 4 : 32 + (block - 128) / 16; }
+
+private:
+    struct DictKey {
+        uint8_t key[6];
+        uint16_t hits;
+    };
+
+    struct CardKeys {
+        String uid;
+        std::vector<std::array<uint8_t, 6>> keys;
+        int8_t sectorKey[2][MIFARE_MAX_SECTORS]; // index into keys, -1 when unknown
+    };
+
+    std::vector<DictKey> dict;
+    std::vector<CardKeys> cards; // most recent first
+    bool loaded = false;
+    bool dirty = false;
+
+    CardKeys *card = nullptr;
+    std::vector<std::array<uint8_t, 6>> sessionKeys; // most recently found first
+    uint32_t attempts = 0;
+
+    MifareKeyStore() {}
+    void load();
+    void save();
+    void rankDictionary();
+    void recordHit(uint8_t sector, MifareKeyType type, const uint8_t *key);
+};
+
+#endif
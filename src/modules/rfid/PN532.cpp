@@ -11,6 +11,7 @@
 #include "core/i2c_finder.h"
 #include "core/sd_functions.h"
 #include "core/type_convertion.h"
+#include <StreamString.h>
 
 PN532::PN532(bool use_i2c) {
     _use_i2c = use_i2c;
@@ -49,7 +50,9 @@ int PN532::read(int cardBaudRate) {
 
     displayInfo("Reading data blocks...");
     pageReadStatus = read_data_blocks();
+    MifareKeyStore::instance().endCard();
     pageReadSuccess = pageReadStatus == SUCCESS;
+    dump.end(printableUID.picc_type, pageReadSuccess);
     return SUCCESS;
 }
 
@@ -95,7 +98,9 @@ int PN532::erase() {
     if (!nfc.startPassiveTargetIDDetection()) return TAG_NOT_PRESENT;
     if (!nfc.readDetectedPassiveTargetID()) return FAILURE;
 
-    return erase_data_blocks();
+    int result = erase_data_blocks();
+    MifareKeyStore::instance().endCard();
+    return result;
 }
 
 int PN532::write(int cardBaudRate) {
@@ -113,7 +118,9 @@ int PN532::write(int cardBaudRate) {
         if (!nfc.felica_Polling(sys_code, req_code, idm, pmm, &sys_code_res)) { return TAG_NOT_PRESENT; }
     }
 
-    return write_data_blocks();
+    int result = write_data_blocks();
+    MifareKeyStore::instance().endCard();
+    return result;
 }
 
 int PN532::write_ndef() {
@@ -129,18 +136,29 @@ int PN532::load() {
     FS *fs;
 
     if (!getFsStorage(fs)) return FAILURE;
-    filepath = loopSD(*fs, true, "RFID|NFC", "/BruceRFID");
+    filepath = loopSD(*fs, true, "RFID|NFC|RFIDB", "/BruceRFID");
     file = fs->open(filepath, FILE_READ);
 
     if (!file) { return FAILURE; }
 
+    // binary dumps load through their .rfid text
+    StreamString dumpText;
+    Stream *in = &file;
+    if (filepath.endsWith(RFID_DUMP_EXT)) {
+        if (!RfidDump::exportText(file, dumpText)) {
+            file.close();
+            return FAILURE;
+        }
+        in = &dumpText;
+    }
+
     String line;
     String strData;
     strAllPages = "";
     pageReadSuccess = true;
 
-    while (file.available()) {
-        line = file.readStringUntil('\n');
+    while (in->available()) {
+        line = in->readStringUntil('\n');
         strData = line.substring(line.indexOf(":") + 1);
         strData.trim();
         if (line.startsWith("Device type:")) printableUID.picc_type = strData;
@@ -277,10 +295,14 @@ int PN532::read_data_blocks() {
         switch (uid.sak) {
             case PICC_TYPE_MIFARE_MINI:
             case PICC_TYPE_MIFARE_1K:
-            case PICC_TYPE_MIFARE_4K: readStatus = read_mifare_classic_data_blocks(); break;
+            case PICC_TYPE_MIFARE_4K:
+                readStatus = read_mifare_classic_data_blocks();
+                dump.appendPages(strAllPages);
+                break;
 
             case PICC_TYPE_MIFARE_UL:
                 readStatus = read_mifare_ultralight_data_blocks();
+                dump.appendPages(strAllPages);
                 if (totalPages == 0) totalPages = dataPages;
                 break;
 
@@ -318,6 +340,7 @@ int PN532::read_mifare_classic_data_blocks() {
     }
 
     if (no_of_sectors) {
+        dump.begin(RfidDump::makeHeader(uid.uidByte, uid.size, uid.atqaByte, uid.sak, 16, totalPages), true);
         for (int8_t i = 0; i < no_of_sectors; i++) {
             sectorReadStatus = read_mifare_classic_data_sector(i);
             if (sectorReadStatus != SUCCESS) break;
@@ -342,90 +365,79 @@ int PN532::read_mifare_classic_data_sector(byte sector) {
 
     byte buffer[18];
     byte blockAddr;
-    String strPage;
-
-    int authStatus = authenticate_mifare_classic(firstBlock);
-    if (authStatus != SUCCESS) return authStatus;
-
-    for (int8_t blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
-        strPage = "";
-        blockAddr = firstBlock + blockOffset;
-
-        if (!nfc.mifareclassic_ReadDataBlock(blockAddr, buffer)) return FAILURE;
-
-        strPage = hexToStr(buffer, 16);
 
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
-        dataPages++;
+    // saved by an interrupted read of this card, no need to authenticate again
+    bool saved = true;
+    for (byte blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
+        saved = saved && dump.has(firstBlock + blockOffset);
+    }
+    if (saved) {
+        dataPages += no_of_blocks;
+        return SUCCESS;
     }
 
-    return SUCCESS;
-}
-
-int PN532::authenticate_mifare_classic(byte block) {
-    uint8_t successA = 0;
-    uint8_t successB = 0;
-
-    for (auto key : keys) {
-        successA = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 0, key);
-        if (successA) break;
-
-        if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-            return TAG_NOT_PRESENT;
+    int authStatus = authenticate_mifare_classic(firstBlock);
+    if (authStatus != SUCCESS) {
+        for (byte blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
+            dump.append(firstBlock + blockOffset, nullptr, RFID_DUMP_BLOCK_AUTH_FAILED);
         }
+        dump.sync();
+        return authStatus;
     }
 
-    if (!successA) {
-        uint8_t keyA[6];
+    // both keys opened the sector, the blocks are read under key B
+    uint8_t key[6];
+    uint8_t keyType = MifareKeyStore::instance().sectorKey(sector, MIFARE_KEY_B, key) ? MIFARE_KEY_B
+                                                                                      : RFID_DUMP_NO_KEY;
 
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyA[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            successA = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 0, keyA);
-            if (successA) break;
+    for (int8_t blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
+        blockAddr = firstBlock + blockOffset;
 
-            if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-                return TAG_NOT_PRESENT;
-            }
+        if (!nfc.mifareclassic_ReadDataBlock(blockAddr, buffer)) {
+            dump.append(blockAddr, nullptr, RFID_DUMP_BLOCK_READ_FAILED, keyType, key);
+            dump.sync();
+            return FAILURE;
         }
-    }
-
-    for (auto key : keys) {
-        successB = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 1, key);
-        if (successB) break;
 
-        if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-            return TAG_NOT_PRESENT;
-        }
+        dump.append(blockAddr, buffer, RFID_DUMP_BLOCK_OK, keyType, key);
+        dataPages++;
     }
+    dump.sync();
 
-    if (!successB) {
-        uint8_t keyB[6];
-
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyB[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            successB = nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, 1, keyB);
-            if (successB) break;
+    return SUCCESS;
+}
 
-            if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) {
-                return TAG_NOT_PRESENT;
-            }
-        }
+MifareAuthResult PN532::try_mifare_key(byte block, uint8_t keyType, const uint8_t *key) {
+    if (nfc.mifareclassic_AuthenticateBlock(uid.uidByte, uid.size, block, keyType, (uint8_t *)key)) {
+        return MIFARE_AUTH_OK;
     }
+    // InListPassiveTarget wakes and selects the card again in a single command
+    if (!nfc.startPassiveTargetIDDetection() || !nfc.readDetectedPassiveTargetID()) return MIFARE_AUTH_LOST;
+    return MIFARE_AUTH_FAILED;
+}
 
-    return (successA && successB) ? SUCCESS : TAG_AUTH_ERROR;
+int PN532::authenticate_mifare_classic(byte block) {
+    MifareKeyStore &store = MifareKeyStore::instance();
+    store.loadDictionary(keys, sizeof(keys) / sizeof(keys[0]));
+    store.beginCard(uid.uidByte, uid.size);
+    byte sector = MifareKeyStore::blockToSector(block);
+
+    MifareAuthResult statusA = store.authenticate(sector, MIFARE_KEY_A, [&](const uint8_t *key) {
+        return try_mifare_key(block, 0, key);
+    });
+    if (statusA == MIFARE_AUTH_LOST) return TAG_NOT_PRESENT;
+
+    MifareAuthResult statusB = store.authenticate(sector, MIFARE_KEY_B, [&](const uint8_t *key) {
+        return try_mifare_key(block, 1, key);
+    });
+    if (statusB == MIFARE_AUTH_LOST) return TAG_NOT_PRESENT;
+
+    return (statusA == MIFARE_AUTH_OK && statusB == MIFARE_AUTH_OK) ? SUCCESS : TAG_AUTH_ERROR;
 }
 
 int PN532::read_mifare_ultralight_data_blocks() {
     uint8_t success;
     byte buffer[18];
-    byte i;
-    String strPage = "";
 
     uint8_t buf[4];
     nfc.mifareultralight_ReadPage(3, buf);
@@ -439,25 +451,18 @@ int PN532::read_mifare_ultralight_data_blocks() {
         // MIFARE UL
         default: totalPages = 64; break;
     }
+    dump.begin(RfidDump::makeHeader(uid.uidByte, uid.size, uid.atqaByte, uid.sak, 4, totalPages), false);
 
     for (byte page = 0; page < totalPages; page += 4) {
         success = nfc.ntag2xx_ReadPage(page, buffer);
         if (!success) return FAILURE;
 
         for (byte offset = 0; offset < 4; offset++) {
-            strPage = "";
-            for (byte index = 0; index < 4; index++) {
-                i = 4 * offset + index;
-                strPage += buffer[i] < 0x10 ? F(" 0") : F(" ");
-                strPage += String(buffer[i], HEX);
-            }
-            strPage.trim();
-            strPage.toUpperCase();
-
-            strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+            dump.append(dataPages, buffer + 4 * offset);
             dataPages++;
             if (dataPages >= totalPages) break;
         }
+        if (page % 16 == 12) dump.sync();
     }
 
     return SUCCESS;
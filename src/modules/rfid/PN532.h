@@ -6,6 +6,7 @@
  * @date 2024-08-19
  */
 
+#include "MifareKeyStore.h"
 #include "RFIDInterface.h"
 #include <Adafruit_PN532.h>
 
@@ -67,6 +68,7 @@ private:
     int read_mifare_classic_data_blocks();
     int read_mifare_classic_data_sector(byte sector);
     int authenticate_mifare_classic(byte block);
+    MifareAuthResult try_mifare_key(byte block, uint8_t keyType, const uint8_t *key);
     int read_mifare_ultralight_data_blocks();
 
     int write_data_blocks();
@@ -6,6 +6,7 @@
 #include "core/scrollableTextArea.h"
 #include "core/sd_functions.h"
 #include "driver/uart.h"
+#include "mfkey.h"
 #include <NimBLEDevice.h>
 #include <WiFi.h>
 #include <WiFiUdp.h>
@@ -142,13 +143,14 @@ void PN532KillerTools::snifferMenu() {
          [&]() {
              _snifferType = PN532KillerCmd::SnifferType::MFKey32v2;
              setSnifferMode();
-         }                             },
+         }                                       },
         {"MFKey64",
          [&]() {
              _snifferType = PN532KillerCmd::SnifferType::MFKey64;
              setSnifferMode();
-         }                             },
-        {"Return",    [&]() { return; }}
+         }                                       },
+        {"Recover Keys", [&]() { recoverKeys(); }},
+        {"Return",       [&]() { return; }       }
     };
 
     loopOptions(options);
@@ -191,6 +193,74 @@ void PN532KillerTools::setSnifferUid() {
     displayError("No tag found");
 }
 
+/*********************************************************************
+**  Function: recoverKeys
+**  Recovers the keys of a nonce log saved from the sniffer, one line
+**  per authentication, and adds them to the Mifare key dictionary
+**********************************************************************/
+void PN532KillerTools::recoverKeys() {
+    FS *fs;
+    if (!getFsStorage(fs)) return;
+    String path = loopSD(*fs, true, "LOG|TXT");
+    if (path == "") return;
+
+    std::vector<MfkeyNonces> nonces;
+    File file = fs->open(path, FILE_READ);
+    while (file && file.available()) {
+        MfkeyNonces n;
+        if (mfkeyParseLine(file.readStringUntil('\n'), n)) nonces.push_back(n);
+    }
+    file.close();
+    if (nonces.empty()) {
+        displayError("No nonces found", true);
+        return;
+    }
+
+    MfkeyTask task;
+    if (!task.start(nonces)) {
+        displayError("Failed to start", true);
+        return;
+    }
+    size_t job = SIZE_MAX;
+    while (task.running()) {
+        if (check(EscPress)) {
+            task.cancel();
+            displayInfo("Cancelling...");
+            while (task.running()) vTaskDelay(pdMS_TO_TICKS(50));
+            return;
+        }
+        uint16_t permille = task.progress();
+        // a new job restarts the bar
+        if (task.current() != job) {
+            job = task.current();
+            progressHandler(0, 1000, "Nonces " + String(job + 1) + "/" + String(task.size()));
+        }
+        progressHandler(permille, 1000, "Nonces " + String(job + 1) + "/" + String(task.size()));
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+
+    ScrollableTextArea area = ScrollableTextArea("MFKEY");
+    for (const auto &r : task.results()) {
+        const MfkeyNonces &n = r.nonces;
+        String line = "Sec " + String(n.sector) + (n.keyType == MIFARE_KEY_A ? " A: " : " B: ");
+        if (r.found) {
+            uint8_t uid[4] = {
+                (uint8_t)(n.uid >> 24), (uint8_t)(n.uid >> 16), (uint8_t)(n.uid >> 8), (uint8_t)n.uid
+            };
+            MifareKeyStore::instance().importKey(uid, sizeof(uid), n.sector, n.keyType, r.key);
+            for (int i = 0; i < 6; i++) {
+                if (r.key[i] < 0x10) line += "0";
+                line += String(r.key[i], HEX);
+            }
+            line.toUpperCase();
+        } else {
+            line += "not found";
+        }
+        area.addLine(line + " (" + String(r.elapsedMs / 1000.0, 1) + "s)");
+    }
+    area.show();
+}
+
 void PN532KillerTools::setReaderMode() {
     displayBanner();
     drawCreditCard(tftWidth / 4 - 40, (tftHeight) / 2 - 10);
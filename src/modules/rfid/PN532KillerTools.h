@@ -29,6 +29,7 @@ private:
     void setEmulatorNextSlot(bool reverse = false, bool redrawTypeName = true);
     void setSnifferMode();
     void setSnifferUid();
+    void recoverKeys();
     void mainMenu();
     void emulatorMenu();
     void snifferMenu();
@@ -7,12 +7,14 @@
  */
 
 #include "RFID2.h"
+#include "MifareKeyStore.h"
 #include "core/display.h"
 #include "core/i2c_finder.h"
 #include "core/sd_functions.h"
 #include <MFRC522DriverI2C.h>
 #include <MFRC522DriverSPI.h>
 #include <MFRC522Hack.h>
+#include <StreamString.h>
 
 #define RFID2_I2C_ADDRESS 0x28
 
@@ -48,6 +50,9 @@ bool RFID2::PICC_IsNewCardPresent() {
         }
         printableUID.atqa.trim();
         printableUID.atqa.toUpperCase();
+        // swapped like the printable ATQA once formatted
+        uid.atqaByte[0] = bufferATQA[1];
+        uid.atqaByte[1] = bufferATQA[0];
     }
     return bl_result;
 }
@@ -59,9 +64,11 @@ int RFID2::read(int cardBaudRate) {
 
     displayInfo("Reading data blocks...");
     pageReadStatus = read_data_blocks();
+    MifareKeyStore::instance().endCard();
     pageReadSuccess = pageReadStatus == SUCCESS;
     format_data();
     set_uid();
+    dump.end(printableUID.picc_type, pageReadSuccess);
     return SUCCESS;
 }
 
@@ -82,6 +89,7 @@ int RFID2::erase() {
     if (!mfrc522.PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
 
     int result = erase_data_blocks();
+    MifareKeyStore::instance().endCard();
     mfrc522.PICC_HaltA();
     mfrc522.PCD_StopCrypto1();
     return result;
@@ -93,6 +101,7 @@ int RFID2::write(int cardBaudRate) {
     if (mfrc522.uid.sak != uid.sak) return TAG_NOT_MATCH;
 
     int result = write_data_blocks();
+    MifareKeyStore::instance().endCard();
 
     mfrc522.PICC_HaltA();
     mfrc522.PCD_StopCrypto1();
@@ -115,18 +124,29 @@ int RFID2::load() {
     FS *fs;
 
     if (!getFsStorage(fs)) return FAILURE;
-    filepath = loopSD(*fs, true, "RFID|NFC", "/BruceRFID");
+    filepath = loopSD(*fs, true, "RFID|NFC|RFIDB", "/BruceRFID");
     file = fs->open(filepath, FILE_READ);
 
     if (!file) { return FAILURE; }
 
+    // binary dumps load through their .rfid text
+    StreamString dumpText;
+    Stream *in = &file;
+    if (filepath.endsWith(RFID_DUMP_EXT)) {
+        if (!RfidDump::exportText(file, dumpText)) {
+            file.close();
+            return FAILURE;
+        }
+        in = &dumpText;
+    }
+
     String line;
     String strData;
     strAllPages = "";
     pageReadSuccess = true;
 
-    while (file.available()) {
-        line = file.readStringUntil('\n');
+    while (in->available()) {
+        line = in->readStringUntil('\n');
         strData = line.substring(line.indexOf(":") + 1);
         strData.trim();
         if (line.startsWith("Device type:")) printableUID.picc_type = strData;
@@ -255,10 +275,12 @@ int RFID2::read_data_blocks() {
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_1K:
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_4K:
             readStatus = read_mifare_classic_data_blocks(piccType);
+            dump.appendPages(strAllPages);
             break;
 
         case MFRC522::PICC_Type::PICC_TYPE_MIFARE_UL:
             readStatus = read_mifare_ultralight_data_blocks();
+            dump.appendPages(strAllPages);
             dataPages = (readStatus == SUCCESS && dataPages > 0) ? dataPages - 1 : dataPages;
             if (totalPages == 0) totalPages = dataPages;
             break;
@@ -295,6 +317,10 @@ int RFID2::read_mifare_classic_data_blocks(byte piccType) {
     }
 
     if (no_of_sectors) {
+        RfidDumpHeader header = RfidDump::makeHeader(
+            mfrc522.uid.uidByte, mfrc522.uid.size, uid.atqaByte, mfrc522.uid.sak, 16, totalPages
+        );
+        dump.begin(header, true);
         for (int8_t i = 0; i < no_of_sectors; i++) {
             sectorReadStatus = read_mifare_classic_data_sector(i);
             if (sectorReadStatus != SUCCESS) break;
@@ -323,105 +349,100 @@ int RFID2::read_mifare_classic_data_sector(byte sector) {
     byte byteCount;
     byte buffer[18];
     byte blockAddr;
-    String strPage;
+
+    // saved by an interrupted read of this card, no need to authenticate again
+    bool saved = true;
+    for (byte blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
+        saved = saved && dump.has(firstBlock + blockOffset);
+    }
+    if (saved) {
+        dataPages += no_of_blocks;
+        return SUCCESS;
+    }
 
     int authStatus = authenticate_mifare_classic(firstBlock);
-    if (authStatus != SUCCESS) return authStatus;
+    if (authStatus != SUCCESS) {
+        for (byte blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
+            dump.append(firstBlock + blockOffset, nullptr, RFID_DUMP_BLOCK_AUTH_FAILED);
+        }
+        dump.sync();
+        return authStatus;
+    }
+
+    // both keys opened the sector, the blocks are read under key B
+    uint8_t key[6];
+    uint8_t keyType = MifareKeyStore::instance().sectorKey(sector, MIFARE_KEY_B, key) ? MIFARE_KEY_B
+                                                                                      : RFID_DUMP_NO_KEY;
 
     for (int8_t blockOffset = 0; blockOffset < no_of_blocks; blockOffset++) {
-        strPage = "";
         blockAddr = firstBlock + blockOffset;
         byteCount = sizeof(buffer);
 
         status = mfrc522.MIFARE_Read(blockAddr, buffer, &byteCount);
-        if (status != MFRC522::StatusCode::STATUS_OK) { return FAILURE; }
-
-        for (byte index = 0; index < 16; index++) {
-            strPage += buffer[index] < 0x10 ? F(" 0") : F(" ");
-            strPage += String(buffer[index], HEX);
+        if (status != MFRC522::StatusCode::STATUS_OK) {
+            dump.append(blockAddr, nullptr, RFID_DUMP_BLOCK_READ_FAILED, keyType, key);
+            dump.sync();
+            return FAILURE;
         }
 
-        strPage.trim();
-        strPage.toUpperCase();
-
-        strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+        dump.append(blockAddr, buffer, RFID_DUMP_BLOCK_OK, keyType, key);
         dataPages++;
     }
+    dump.sync();
 
     return SUCCESS;
 }
 
-int RFID2::authenticate_mifare_classic(byte block) {
-    byte statusA = 0;
-    byte statusB = 0;
-
-    MFRC522::MIFARE_Key keyA;
-    MFRC522::MIFARE_Key keyB;
-
-    for (auto key : keys) {
-        memcpy(keyA.keyByte, key, 6);
-
-        statusA = mfrc522.PCD_Authenticate(
-            MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, block, &keyA, &mfrc522.uid
-        );
-        if (statusA == MFRC522::StatusCode::STATUS_OK) break;
-
-        if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
+MifareAuthResult RFID2::try_mifare_key(byte command, byte block, const uint8_t *key) {
+    MFRC522::MIFARE_Key mfKey;
+    memcpy(mfKey.keyByte, key, 6);
+    if (mfrc522.PCD_Authenticate(command, block, &mfKey, &mfrc522.uid) == MFRC522::StatusCode::STATUS_OK) {
+        return MIFARE_AUTH_OK;
     }
 
-    if (statusA != MFRC522::StatusCode::STATUS_OK) {
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyA.keyByte[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            statusA = mfrc522.PCD_Authenticate(
-                MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, block, &keyA, &mfrc522.uid
-            );
-            if (statusA == MFRC522::StatusCode::STATUS_OK) break;
-
-            if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
-        }
+    // A failed auth drops the card out of the selected state, HALT + WUPA and select it by its known UID
+    mfrc522.PCD_StopCrypto1();
+    mfrc522.PICC_HaltA();
+    byte bufferATQA[2];
+    byte bufferSize = sizeof(bufferATQA);
+    byte result = mfrc522.PICC_WakeupA(bufferATQA, &bufferSize);
+    if (result != MFRC522::StatusCode::STATUS_OK && result != MFRC522::StatusCode::STATUS_COLLISION) {
+        return MIFARE_AUTH_LOST;
     }
-
-    for (auto key : keys) {
-        memcpy(keyB.keyByte, key, 6);
-
-        statusB = mfrc522.PCD_Authenticate(
-            MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_B, block, &keyB, &mfrc522.uid
-        );
-        if (statusB == MFRC522::StatusCode::STATUS_OK) break;
-
-        if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
-    }
-
-    if (statusB != MFRC522::StatusCode::STATUS_OK) {
-        for (const auto &mifKey : bruceConfig.mifareKeys) {
-            for (size_t i = 0; i < mifKey.length(); i += 2) {
-                keyB.keyByte[i / 2] = strtoul(mifKey.substring(i, i + 2).c_str(), NULL, 16);
-            }
-
-            statusB = mfrc522.PCD_Authenticate(
-                MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, block, &keyB, &mfrc522.uid
-            );
-            if (statusB == MFRC522::StatusCode::STATUS_OK) break;
-
-            if (!PICC_IsNewCardPresent() || !mfrc522.PICC_ReadCardSerial()) { return TAG_NOT_PRESENT; }
-        }
+    if (mfrc522.PICC_Select(&mfrc522.uid, mfrc522.uid.size * 8) != MFRC522::StatusCode::STATUS_OK) {
+        return MIFARE_AUTH_LOST;
     }
+    return MIFARE_AUTH_FAILED;
+}
 
-    return (statusA == MFRC522::StatusCode::STATUS_OK && statusB == MFRC522::StatusCode::STATUS_OK)
-               ? SUCCESS
-               : TAG_AUTH_ERROR;
+int RFID2::authenticate_mifare_classic(byte block) {
+    MifareKeyStore &store = MifareKeyStore::instance();
+    store.loadDictionary(keys, sizeof(keys) / sizeof(keys[0]));
+    store.beginCard(mfrc522.uid.uidByte, mfrc522.uid.size);
+    byte sector = MifareKeyStore::blockToSector(block);
+
+    MifareAuthResult statusA = store.authenticate(sector, MIFARE_KEY_A, [&](const uint8_t *key) {
+        return try_mifare_key(MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_A, block, key);
+    });
+    if (statusA == MIFARE_AUTH_LOST) return TAG_NOT_PRESENT;
+
+    MifareAuthResult statusB = store.authenticate(sector, MIFARE_KEY_B, [&](const uint8_t *key) {
+        return try_mifare_key(MFRC522::PICC_Command::PICC_CMD_MF_AUTH_KEY_B, block, key);
+    });
+    if (statusB == MIFARE_AUTH_LOST) return TAG_NOT_PRESENT;
+
+    return (statusA == MIFARE_AUTH_OK && statusB == MIFARE_AUTH_OK) ? SUCCESS : TAG_AUTH_ERROR;
 }
 
 int RFID2::read_mifare_ultralight_data_blocks() {
     byte status;
     byte byteCount;
     byte buffer[18];
-    byte i;
     byte cc;
-    String strPage = "";
+
+    RfidDumpHeader header =
+        RfidDump::makeHeader(mfrc522.uid.uidByte, mfrc522.uid.size, uid.atqaByte, mfrc522.uid.sak, 4, 0);
+    dump.begin(header, false);
 
     for (byte page = 0; page <= 252; page += 4) {
         byteCount = sizeof(buffer);
@@ -430,7 +451,6 @@ int RFID2::read_mifare_ultralight_data_blocks() {
             return status == MFRC522::StatusCode::STATUS_MIFARE_NACK ? SUCCESS : FAILURE;
         }
         for (byte offset = 0; offset < 4; offset++) {
-            strPage = "";
             if (page + offset == 3) {
                 cc = buffer[4 * offset + 2];
                 switch (cc) {
@@ -443,17 +463,10 @@ int RFID2::read_mifare_ultralight_data_blocks() {
                     default: break;
                 }
             }
-            for (byte index = 0; index < 4; index++) {
-                i = 4 * offset + index;
-                strPage += buffer[i] < 0x10 ? F(" 0") : F(" ");
-                strPage += String(buffer[i], HEX);
-            }
-            strPage.trim();
-            strPage.toUpperCase();
-
-            strAllPages += "Page " + String(dataPages) + ": " + strPage + "\n";
+            dump.append(dataPages, buffer + 4 * offset);
             dataPages++;
         }
+        if (page % 16 == 12) dump.sync();
     }
 
     return SUCCESS;
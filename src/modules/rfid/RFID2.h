@@ -6,6 +6,7 @@
  * @date 2024-08-19
  */
 
+#include "MifareKeyStore.h"
 #include "RFIDInterface.h"
 #include <MFRC522Driver.h>
 #include <MFRC522DriverPinSimple.h>
@@ -59,6 +60,7 @@ private:
     int read_mifare_classic_data_blocks(byte piccType);
     int read_mifare_classic_data_sector(byte sector);
     int authenticate_mifare_classic(byte block);
+    MifareAuthResult try_mifare_key(byte command, byte block, const uint8_t *key);
     int read_mifare_ultralight_data_blocks();
 
     int write_data_blocks();
@@ -9,6 +9,7 @@
 #ifndef __RFID_INTERFACE_H__
 #define __RFID_INTERFACE_H__
 
+#include "RfidDump.h"
 #include <globals.h>
 
 class RFIDInterface {
@@ -72,6 +73,7 @@ public:
     PrintableUID printableUID;
     NdefMessage ndefMessage;
     String strAllPages = "";
+    RfidDump dump; // blocks as they are read, strAllPages is built from it at the end
     int totalPages = 0;
     int dataPages = 0;
     bool pageReadSuccess = false;
@@ -0,0 +1,221 @@
+/**
+ * @file RfidDump.cpp
+ * @brief Binary card dump, written block by block while the card is read
+ */
+
+#include "RfidDump.h"
+#include "core/sd_functions.h"
+#include "core/type_convertion.h"
+
+RfidDumpHeader RfidDump::makeHeader(
+    const uint8_t *uid, uint8_t uidSize, const uint8_t *atqa, uint8_t sak, uint8_t blockSize,
+    uint16_t totalBlocks
+) {
+    RfidDumpHeader h = {};
+    memcpy(h.magic, RFID_DUMP_MAGIC, sizeof(h.magic));
+    h.version = RFID_DUMP_VERSION;
+    h.uidSize = min(uidSize, (uint8_t)sizeof(h.uid));
+    memcpy(h.uid, uid, h.uidSize);
+    if (atqa != nullptr) memcpy(h.atqa, atqa, sizeof(h.atqa));
+    h.sak = sak;
+    h.blockSize = blockSize;
+    h.totalBlocks = totalBlocks;
+    return h;
+}
+
+String RfidDump::path(const RfidDumpHeader &header) {
+    char name[2 * sizeof(header.uid) + 1] = {};
+    for (uint8_t i = 0; i < header.uidSize; i++) sprintf(name + 2 * i, "%02X", header.uid[i]);
+    return String(RFID_DUMP_DIR) + "/" + name + RFID_DUMP_EXT;
+}
+
+/*********************************************************************
+**  Function: begin
+**  A partial dump of the same card is picked up where it stopped, a
+**  complete one is replaced since the card may have changed since
+**********************************************************************/
+bool RfidDump::begin(const RfidDumpHeader &h, bool resume) {
+    close();
+    header = h;
+    memset(offsets, 0, sizeof(offsets));
+    resumedBlocks = 0;
+    size = sizeof(RfidDumpHeader);
+    if (header.blockSize == 0 || header.blockSize > RFID_DUMP_MAX_BLOCK_SIZE) return false;
+
+    FS *fs;
+    if (getFsStorage(fs)) {
+        if (!fs->exists("/BruceRFID")) fs->mkdir("/BruceRFID");
+        if (!fs->exists(RFID_DUMP_DIR)) fs->mkdir(RFID_DUMP_DIR);
+        String dumpPath = path(header);
+
+        if (resume && fs->exists(dumpPath)) {
+            file = fs->open(dumpPath, "r+");
+            RfidDumpHeader saved;
+            bool same = file && file.read((uint8_t *)&saved, sizeof(saved)) == sizeof(saved) &&
+                        memcmp(saved.magic, header.magic, sizeof(saved.magic)) == 0 &&
+                        saved.version == header.version && !(saved.flags & RFID_DUMP_COMPLETE) &&
+                        saved.uidSize == header.uidSize &&
+                        memcmp(saved.uid, header.uid, header.uidSize) == 0 && saved.sak == header.sak &&
+                        saved.blockSize == header.blockSize;
+            if (same && scan()) {
+                for (uint16_t i = 0; i < RFID_DUMP_MAX_BLOCKS; i++) resumedBlocks += offsets[i] != 0;
+                log_i("RFID dump: resuming %s, %u blocks saved", dumpPath.c_str(), resumedBlocks);
+                return true;
+            }
+            if (file) file.close();
+            memset(offsets, 0, sizeof(offsets));
+            size = sizeof(RfidDumpHeader);
+        }
+
+        file = fs->open(dumpPath, "w+");
+        if (file && file.write((uint8_t *)&header, sizeof(header)) == sizeof(header)) return true;
+        if (file) file.close();
+    }
+
+    // no storage, keep the records in RAM for this read
+    inMemory = true;
+    memory.assign((uint8_t *)&header, (uint8_t *)&header + sizeof(header));
+    return true;
+}
+
+bool RfidDump::scan() {
+    uint32_t total = inMemory ? memory.size() : file.size();
+    uint32_t offset = sizeof(RfidDumpHeader);
+    RfidDumpRecord record;
+    while (offset + sizeof(record) + header.blockSize <= total) {
+        if (!readAt(offset, (uint8_t *)&record, sizeof(record))) return false;
+        offset += sizeof(record);
+        if (record.block < RFID_DUMP_MAX_BLOCKS) {
+            offsets[record.block] = record.status == RFID_DUMP_BLOCK_OK ? offset : 0;
+        }
+        offset += header.blockSize;
+    }
+    // a record cut short by a reset is overwritten by the next one
+    size = offset;
+    return true;
+}
+
+bool RfidDump::readAt(uint32_t offset, uint8_t *buf, size_t len) {
+    if (inMemory) {
+        if (offset + len > memory.size()) return false;
+        memcpy(buf, memory.data() + offset, len);
+        return true;
+    }
+    return file && file.seek(offset) && file.read(buf, len) == len;
+}
+
+bool RfidDump::append(
+    uint16_t block, const uint8_t *data, uint8_t status, uint8_t keyType, const uint8_t *key
+) {
+    if (block >= RFID_DUMP_MAX_BLOCKS || (!file && !inMemory)) return false;
+
+    uint8_t buf[sizeof(RfidDumpRecord) + RFID_DUMP_MAX_BLOCK_SIZE] = {};
+    RfidDumpRecord *record = (RfidDumpRecord *)buf;
+    record->block = block;
+    record->status = status;
+    record->keyType = keyType;
+    if (key != nullptr) memcpy(record->key, key, sizeof(record->key));
+    if (data != nullptr) memcpy(buf + sizeof(RfidDumpRecord), data, header.blockSize);
+    size_t len = sizeof(RfidDumpRecord) + header.blockSize;
+
+    if (inMemory) memory.insert(memory.end(), buf, buf + len);
+    else if (!file.seek(size) || file.write(buf, len) != len) return false;
+
+    offsets[block] = status == RFID_DUMP_BLOCK_OK ? size + sizeof(RfidDumpRecord) : 0;
+    size += len;
+    return true;
+}
+
+void RfidDump::sync() {
+    if (file) file.flush();
+}
+
+void RfidDump::end(const String &type, bool complete) {
+    strncpy(header.type, type.c_str(), sizeof(header.type) - 1);
+    if (complete) header.flags |= RFID_DUMP_COMPLETE;
+    if (file && file.seek(0)) file.write((uint8_t *)&header, sizeof(header));
+    close();
+}
+
+void RfidDump::close() {
+    if (file) file.close();
+    inMemory = false;
+    memory.clear();
+    memory.shrink_to_fit();
+}
+
+bool RfidDump::has(uint16_t block) const { return block < RFID_DUMP_MAX_BLOCKS && offsets[block] != 0; }
+
+uint16_t RfidDump::contiguousBlocks() const {
+    uint16_t count = 0;
+    while (count < RFID_DUMP_MAX_BLOCKS && offsets[count] != 0) count++;
+    return count;
+}
+
+size_t RfidDump::formatPage(char *line, uint16_t page, const uint8_t *data) const {
+    size_t len = sprintf(line, "Page %u:", page);
+    for (uint8_t i = 0; i < header.blockSize; i++) len += sprintf(line + len, " %02X", data[i]);
+    line[len++] = '\n';
+    line[len] = 0;
+    return len;
+}
+
+uint16_t RfidDump::appendPages(String &out) {
+    uint16_t count = contiguousBlocks();
+    uint8_t data[RFID_DUMP_MAX_BLOCK_SIZE] = {};
+    char line[16 + RFID_DUMP_MAX_BLOCK_SIZE * 3];
+    // one allocation for the whole text instead of growing it line by line
+    out.reserve(out.length() + count * formatPage(line, count, data));
+    for (uint16_t i = 0; i < count; i++) {
+        if (!readAt(offsets[i], data, header.blockSize)) return i;
+        formatPage(line, i, data);
+        out += line;
+    }
+    return count;
+}
+
+/*********************************************************************
+**  Function: exportText
+**  Same layout as the save() of the readers, so dumps load like any
+**  .rfid file. A partial dump is marked as such.
+**********************************************************************/
+bool RfidDump::exportText(File &dumpFile, Print &out) {
+    RfidDump dump;
+    RfidDumpHeader &h = dump.header;
+    if (!dumpFile.seek(0) || dumpFile.read((uint8_t *)&h, sizeof(h)) != sizeof(h)) return false;
+    if (memcmp(h.magic, RFID_DUMP_MAGIC, sizeof(h.magic)) != 0) return false;
+    if (h.version != RFID_DUMP_VERSION) return false;
+    if (h.blockSize == 0 || h.blockSize > RFID_DUMP_MAX_BLOCK_SIZE || h.uidSize > sizeof(h.uid)) return false;
+
+    dump.file = dumpFile;
+    bool ok = dump.scan();
+    uint16_t count = dump.contiguousBlocks();
+    char type[sizeof(h.type) + 1] = {};
+    memcpy(type, h.type, sizeof(h.type));
+
+    if (ok) {
+        out.println("Filetype: Bruce RFID File");
+        out.println("Version 1");
+        out.println("Device type: " + String(type));
+        out.println("# UID, ATQA and SAK are common for all formats");
+        out.println("UID: " + hexToStr(h.uid, h.uidSize));
+        out.println("SAK: " + hexToStr(&h.sak, 1));
+        out.println("ATQA: " + hexToStr(h.atqa, 2));
+        out.println("# Memory dump");
+        out.println("Pages total: " + String(count));
+        if (!(h.flags & RFID_DUMP_COMPLETE)) out.println("Pages read: " + String(count));
+
+        uint8_t data[RFID_DUMP_MAX_BLOCK_SIZE];
+        char line[16 + RFID_DUMP_MAX_BLOCK_SIZE * 3];
+        for (uint16_t i = 0; i < count && ok; i++) {
+            ok = dump.readAt(dump.offsets[i], data, h.blockSize);
+            if (ok) {
+                dump.formatPage(line, i, data);
+                out.print(line);
+            }
+        }
+    }
+    // the file belongs to the caller
+    dump.file = File();
+    return ok;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file RfidDump.h
+ * @brief Binary card dump, written block by block while the card is read
+ */
+
+#ifndef __RFID_DUMP_H__
+#define __RFID_DUMP_H__
+
+#include <Arduino.h>
+#include <FS.h>
+#include <vector>
+
+#define RFID_DUMP_DIR "/BruceRFID/Dumps"
+#define RFID_DUMP_EXT ".rfidb"
+#define RFID_DUMP_MAGIC "BRFD"
+#define RFID_DUMP_VERSION 1
+#define RFID_DUMP_MAX_BLOCKS 256 // Mifare Classic 4K, NTAG216 has 231 pages
+#define RFID_DUMP_MAX_BLOCK_SIZE 16
+#define RFID_DUMP_NO_KEY 0xFF
+#define RFID_DUMP_COMPLETE 0x01 // header flag, every block of the card was read
+
+enum RfidDumpBlockStatus : uint8_t {
+    RFID_DUMP_BLOCK_OK = 0,
+    RFID_DUMP_BLOCK_AUTH_FAILED = 1,
+    RFID_DUMP_BLOCK_READ_FAILED = 2,
+};
+
+struct __attribute__((packed)) RfidDumpHeader {
+    char magic[4];
+    uint8_t version;
+    uint8_t flags;
+    uint8_t uidSize;
+    uint8_t uid[10];
+    uint8_t atqa[2]; // in the order the .rfid files show it
+    uint8_t sak;
+    uint8_t blockSize; // 16 for Mifare Classic blocks, 4 for Ultralight/NTAG pages
+    uint16_t totalBlocks;
+    char type[24];
+};
+
+struct __attribute__((packed)) RfidDumpRecord {
+    uint16_t block;
+    uint8_t status;
+    uint8_t keyType; // MIFARE_KEY_A, MIFARE_KEY_B or RFID_DUMP_NO_KEY
+    uint8_t key[6];
+}; // followed by blockSize bytes of data
+
+/*
+ * A header followed by a record and the block data for every block read,
+ * appended as the card is read so an interrupted read keeps what it got.
+ * Reading the same card again resumes a partial dump, a later record of a
+ * block replaces an earlier one. Without storage the records stay in RAM,
+ * still far smaller than the hex text of the card.
+ */
+class RfidDump {
+public:
+    ~RfidDump() { close(); }
+
+    static RfidDumpHeader makeHeader(
+        const uint8_t *uid, uint8_t uidSize, const uint8_t *atqa, uint8_t sak, uint8_t blockSize,
+        uint16_t totalBlocks
+    );
+
+    // Opens the dump of the card, keeping the blocks of a partial dump when resume is set
+    bool begin(const RfidDumpHeader &header, bool resume);
+
+    bool append(
+        uint16_t block, const uint8_t *data, uint8_t status = RFID_DUMP_BLOCK_OK,
+        uint8_t keyType = RFID_DUMP_NO_KEY, const uint8_t *key = nullptr
+    );
+
+    // Makes the records appended so far survive a reset
+    void sync();
+
+    // Stores the card type, only known once the read is done, and closes the file
+    void end(const String &type = "", bool complete = false);
+
+    bool has(uint16_t block) const;
+    uint16_t resumed() const { return resumedBlocks; }
+
+    // "Page N: XX XX .." lines of the blocks read from 0 without a gap, as .rfid files store them
+    uint16_t appendPages(String &out);
+
+    // Writes a dump file as .rfid text
+    static bool exportText(File &dumpFile, Print &out);
+
+private:
+    File file;
+    bool inMemory = false;
+    std::vector<uint8_t> memory; // records when there is no storage
+    RfidDumpHeader header = {};
+    uint32_t size = 0;
+    uint32_t offsets[RFID_DUMP_MAX_BLOCKS] = {}; // data of the latest readable record per block, 0 when none
+    uint16_t resumedBlocks = 0;
+
+    void close();
+    bool scan();
+    bool readAt(uint32_t offset, uint8_t *buf, size_t len);
+    uint16_t contiguousBlocks() const;
+    size_t formatPage(char *line, uint16_t page, const uint8_t *data) const;
+    static String path(const RfidDumpHeader &header);
+};
+
+#endif
@@ -0,0 +1,436 @@
+/**
+ * @file mfkey.cpp
+ * @brief Mifare Classic key recovery from sniffed authentications (mfkey32v2 and mfkey64)
+ *
+ * Crypto1 state recovery after crapto1 by bla, with the state list replaced by
+ * an inline check of each candidate and the search tables split in chunks.
+ */
+
+#include "mfkey.h"
+#include <algorithm>
+#include <esp_heap_caps.h>
+
+#define LF_POLY_ODD 0x29CE5C
+#define LF_POLY_EVEN 0x870804
+
+struct Crypto1State {
+    uint32_t odd;
+    uint32_t even;
+};
+
+struct MfkeyRange {
+    uint32_t oddLo, oddHi;
+    uint32_t evenLo, evenHi;
+};
+
+struct MfkeySearch {
+    const MfkeyNonces *n;
+    uint32_t ks3; // mfkey64 only
+    uint32_t *oddLimit;
+    uint32_t *evenLimit;
+    bool overflow;
+    bool cancelled;
+    bool found;
+    uint64_t key;
+    std::function<bool(uint32_t, uint32_t)> onTopProgress; // buckets done, buckets total
+};
+
+static inline uint32_t bit(uint32_t x, int n) { return x >> n & 1; }
+static inline uint32_t bebit(uint32_t x, int n) { return bit(x, n ^ 24); }
+static inline uint32_t parity(uint32_t x) { return __builtin_parity(x); }
+
+static inline uint32_t filter(uint32_t x) {
+    uint32_t f;
+    f = 0xf22c0 >> (x & 0xf) & 16;
+    f |= 0x6c9c0 >> (x >> 4 & 0xf) & 8;
+    f |= 0x3c8b0 >> (x >> 8 & 0xf) & 4;
+    f |= 0x1e458 >> (x >> 12 & 0xf) & 2;
+    f |= 0x0d938 >> (x >> 16 & 0xf) & 1;
+    return bit(0xEC57E80A, f);
+}
+
+static uint32_t prngSuccessor(uint32_t x, uint32_t n) {
+    x = __builtin_bswap32(x);
+    while (n--) x = x >> 1 | (x >> 16 ^ x >> 18 ^ x >> 19 ^ x >> 21) << 31;
+    return __builtin_bswap32(x);
+}
+
+static uint32_t crypto1Bit(Crypto1State &s, uint32_t in, bool encrypted) {
+    uint32_t ret = filter(s.odd);
+    uint32_t feedin = (ret & encrypted) ^ (in != 0);
+    feedin ^= LF_POLY_ODD & s.odd;
+    feedin ^= LF_POLY_EVEN & s.even;
+    s.even = s.even << 1 | parity(feedin);
+    std::swap(s.odd, s.even);
+    return ret;
+}
+
+static uint32_t crypto1Word(Crypto1State &s, uint32_t in, bool encrypted) {
+    uint32_t ret = 0;
+    for (int i = 0; i < 32; i++) ret |= crypto1Bit(s, bebit(in, i), encrypted) << (i ^ 24);
+    return ret;
+}
+
+static void lfsrRollbackBit(Crypto1State &s, uint32_t in, bool encrypted) {
+    s.odd &= 0xffffff;
+    std::swap(s.odd, s.even);
+    uint32_t out = s.even & 1;
+    out ^= LF_POLY_EVEN & (s.even >>= 1);
+    out ^= LF_POLY_ODD & s.odd;
+    out ^= (in != 0);
+    out ^= filter(s.odd) & encrypted;
+    s.even |= parity(out) << 23;
+}
+
+static void lfsrRollbackWord(Crypto1State &s, uint32_t in, bool encrypted) {
+    for (int i = 31; i >= 0; i--) lfsrRollbackBit(s, bebit(in, i), encrypted);
+}
+
+static uint64_t crypto1Key(const Crypto1State &s) {
+    uint64_t lfsr = 0;
+    for (int i = 23; i >= 0; i--) {
+        lfsr = lfsr << 1 | bit(s.odd, i ^ 3);
+        lfsr = lfsr << 1 | bit(s.even, i ^ 3);
+    }
+    return lfsr;
+}
+
+/*********************************************************************
+**  Function: checkCandidate
+**  Rolls a state that produced ks2 back to the key and replays the
+**  other authentication (mfkey32v2) or the tag answer (mfkey64)
+**********************************************************************/
+static bool checkCandidate(MfkeySearch &s, Crypto1State t) {
+    const MfkeyNonces &n = *s.n;
+    if (n.mfkey64) {
+        // cheapest filter first, 32 more keystream bits leave a single state
+        Crypto1State next = t;
+        if (crypto1Word(next, 0, false) != s.ks3) return false;
+    }
+    lfsrRollbackWord(t, 0, false);
+    lfsrRollbackWord(t, n.nr0, true);
+    lfsrRollbackWord(t, n.uid ^ n.nt0, false);
+    uint64_t key = crypto1Key(t);
+    if (!n.mfkey64) {
+        crypto1Word(t, n.uid ^ n.nt1, false);
+        crypto1Word(t, n.nr1, true);
+        if (n.ar1 != (crypto1Word(t, 0, false) ^ prngSuccessor(n.nt1, 64))) return false;
+    }
+    s.key = key;
+    s.found = true;
+    return true;
+}
+
+static inline void updateContribution(uint32_t *item, uint32_t mask1, uint32_t mask2) {
+    uint32_t p = *item >> 25;
+    p = p << 1 | parity(*item & mask1);
+    p = p << 1 | parity(*item & mask2);
+    *item = p << 24 | (*item & 0xffffff);
+}
+
+// Appends one more bit to every entry, dropping the ones that do not produce the keystream bit
+static inline bool
+extendTable(uint32_t *tbl, uint32_t **end, uint32_t *limit, uint32_t b, uint32_t m1, uint32_t m2) {
+    for (*tbl <<= 1; tbl <= *end; *++tbl <<= 1) {
+        if (filter(*tbl) ^ filter(*tbl | 1)) {
+            *tbl |= filter(*tbl) ^ b;
+            updateContribution(tbl, m1, m2);
+        } else if (filter(*tbl) == b) {
+            if (*end + 2 >= limit) return false;
+            *++*end = tbl[1];
+            tbl[1] = tbl[0] | 1;
+            updateContribution(tbl, m1, m2);
+            tbl++;
+            updateContribution(tbl, m1, m2);
+        } else {
+            *tbl-- = *(*end)--;
+        }
+    }
+    return true;
+}
+
+static inline bool extendTableSimple(uint32_t *tbl, uint32_t **end, uint32_t *limit, uint32_t b) {
+    for (*tbl <<= 1; tbl <= *end; *++tbl <<= 1) {
+        if (filter(*tbl) ^ filter(*tbl | 1)) {
+            *tbl |= filter(*tbl) ^ b;
+        } else if (filter(*tbl) == b) {
+            if (*end + 2 >= limit) return false;
+            *++*end = *++tbl;
+            *tbl = tbl[-1] | 1;
+        } else {
+            *tbl-- = *(*end)--;
+        }
+    }
+    return true;
+}
+
+// First entry of the sorted run sharing the feedback contribution (top byte) of *tail
+static inline uint32_t *runStart(uint32_t *head, uint32_t *tail) {
+    return std::lower_bound(head, tail, *tail & 0xff000000);
+}
+
+static void recover(
+    MfkeySearch &s, uint32_t *oHead, uint32_t *oTail, uint32_t oks, uint32_t *eHead, uint32_t *eTail,
+    uint32_t eks, int rem, bool top
+) {
+    if (rem == -1) {
+        for (uint32_t *e = eHead; e <= eTail; e++) {
+            *e = *e << 1 ^ parity(*e & LF_POLY_EVEN);
+            for (uint32_t *o = oHead; o <= oTail; o++) {
+                if (checkCandidate(s, {*e ^ parity(*o & LF_POLY_ODD), *o})) return;
+            }
+        }
+        return;
+    }
+
+    for (int i = 0; i < 4 && rem--; i++) {
+        oks >>= 1;
+        eks >>= 1;
+        if (!extendTable(oHead, &oTail, s.oddLimit, oks & 1, LF_POLY_EVEN << 1 | 1, LF_POLY_ODD << 1)) {
+            s.overflow = true;
+            return;
+        }
+        if (oHead > oTail) return;
+        if (!extendTable(eHead, &eTail, s.evenLimit, eks & 1, LF_POLY_ODD, LF_POLY_EVEN << 1 | 1)) {
+            s.overflow = true;
+            return;
+        }
+        if (eHead > eTail) return;
+    }
+
+    std::sort(oHead, oTail + 1);
+    std::sort(eHead, eTail + 1);
+
+    uint32_t total = oTail - oHead + 1;
+    while (oTail >= oHead && eTail >= eHead && !s.found && !s.overflow && !s.cancelled) {
+        if (((*oTail ^ *eTail) >> 24) == 0) {
+            uint32_t *o = oTail, *e = eTail;
+            oTail = runStart(oHead, oTail);
+            eTail = runStart(eHead, eTail);
+            recover(s, oTail, o, oks, eTail, e, eks, rem, false);
+            oTail--;
+            eTail--;
+            if (top && s.onTopProgress && !s.onTopProgress(total - (oTail + 1 - oHead), total)) {
+                s.cancelled = true;
+            }
+        } else if (*oTail > *eTail) {
+            oTail = runStart(oHead, oTail) - 1;
+        } else {
+            eTail = runStart(eHead, eTail) - 1;
+        }
+    }
+}
+
+// Candidates of one LFSR half in [lo, hi) matching the first 5 keystream bits of the half
+static uint32_t *fillTable(uint32_t *head, uint32_t *limit, uint32_t lo, uint32_t hi, uint32_t &ks) {
+    uint32_t *tail = head - 1;
+    for (uint32_t i = lo; i < hi; i++) {
+        if (filter(i) != (ks & 1)) continue;
+        if (tail + 2 >= limit) return nullptr;
+        *++tail = i;
+    }
+    for (int i = 0; i < 4; i++) {
+        ks >>= 1;
+        if (!extendTableSimple(head, &tail, limit, ks & 1)) return nullptr;
+    }
+    return tail;
+}
+
+static uint32_t *allocTable(size_t entries) {
+    size_t bytes = entries * sizeof(uint32_t);
+    if (psramFound()) {
+        uint32_t *table = (uint32_t *)ps_malloc(bytes);
+        if (table != nullptr) return table;
+    }
+    if (heap_caps_get_free_size(MALLOC_CAP_INTERNAL) < bytes + MFKEY_HEAP_RESERVE) return nullptr;
+    return (uint32_t *)malloc(bytes);
+}
+
+/*********************************************************************
+**  Function: mfkeyRecover
+**  Each half of the LFSR is searched in chunks, every pair of odd and
+**  even chunks is an independent search, so a small heap only costs
+**  time. A pair whose tables outgrow the buffers is split in two.
+**********************************************************************/
+bool mfkeyRecover(const MfkeyNonces &n, uint8_t *key, std::function<bool(uint16_t)> onProgress) {
+    uint32_t ks2 = n.ar0 ^ prngSuccessor(n.nt0, 64);
+    uint32_t oks = 0, eks = 0;
+    for (int i = 31; i >= 0; i -= 2) oks = oks << 1 | bebit(ks2, i);
+    for (int i = 30; i >= 0; i -= 2) eks = eks << 1 | bebit(ks2, i);
+
+    uint32_t chunks = 1;
+    size_t capacity = 0;
+    uint32_t *odd = nullptr, *even = nullptr;
+    for (; chunks <= MFKEY_MAX_CHUNKS; chunks <<= 1) {
+        // about half of the values of a chunk match a keystream bit, twice that fits most chunks
+        capacity = (1 << 20) / chunks + MFKEY_TABLE_SLACK;
+        odd = allocTable(capacity);
+        even = odd != nullptr ? allocTable(capacity) : nullptr;
+        if (even != nullptr) break;
+        free(odd);
+        odd = nullptr;
+    }
+    if (odd == nullptr) {
+        log_e("mfkey: not enough memory for the search tables");
+        return false;
+    }
+    log_i("mfkey: %u chunks of %u entries per LFSR half", chunks, (unsigned)capacity);
+
+    MfkeySearch s = {};
+    s.n = &n;
+    s.ks3 = n.at ^ prngSuccessor(n.nt0, 96);
+    s.oddLimit = odd + capacity;
+    s.evenLimit = even + capacity;
+
+    // the searched values are 21 bits wide, 1 << 20 included
+    const uint32_t range = (1 << 20) + 1;
+    uint32_t chunkSize = (range + chunks - 1) / chunks;
+    std::vector<MfkeyRange> work;
+    for (uint32_t oc = 0; oc < chunks; oc++) {
+        for (uint32_t ec = 0; ec < chunks; ec++) {
+            uint32_t oddHi = min((oc + 1) * chunkSize, range), evenHi = min((ec + 1) * chunkSize, range);
+            work.push_back({oc * chunkSize, oddHi, ec * chunkSize, evenHi});
+        }
+    }
+
+    const double total = (double)range * range;
+    double searched = 0, area = 0;
+    uint16_t reported = 0;
+    auto report = [&](double progress) {
+        uint16_t permille = progress * 1000 / total;
+        if (permille <= reported) return true;
+        reported = permille;
+        return onProgress(permille);
+    };
+    if (onProgress) {
+        s.onTopProgress = [&](uint32_t doneBuckets, uint32_t totalBuckets) {
+            return report(searched + area * doneBuckets / totalBuckets);
+        };
+    }
+
+    uint32_t splits = 0;
+    while (!work.empty() && !s.found && !s.cancelled) {
+        MfkeyRange r = work.back();
+        work.pop_back();
+        area = (double)(r.oddHi - r.oddLo) * (r.evenHi - r.evenLo);
+        s.overflow = false;
+
+        uint32_t oksChunk = oks, eksChunk = eks;
+        uint32_t *oddTail = fillTable(odd, s.oddLimit, r.oddLo, r.oddHi, oksChunk);
+        uint32_t *evenTail = fillTable(even, s.evenLimit, r.evenLo, r.evenHi, eksChunk);
+        if (oddTail == nullptr || evenTail == nullptr) s.overflow = true;
+        else if (oddTail >= odd && evenTail >= even) {
+            recover(s, odd, oddTail, oksChunk, even, evenTail, eksChunk, 11, true);
+        }
+
+        if (s.overflow) {
+            // partitions of either half give the same candidates, redo the pair in two halves
+            bool splitOdd = r.oddHi - r.oddLo >= r.evenHi - r.evenLo;
+            uint32_t lo = splitOdd ? r.oddLo : r.evenLo, hi = splitOdd ? r.oddHi : r.evenHi;
+            if (hi - lo < 2) break;
+            MfkeyRange upper = r;
+            (splitOdd ? r.oddHi : r.evenHi) = lo + (hi - lo) / 2;
+            (splitOdd ? upper.oddLo : upper.evenLo) = lo + (hi - lo) / 2;
+            work.push_back(upper);
+            work.push_back(r);
+            splits++;
+            continue;
+        }
+        searched += area;
+        if (onProgress && !s.found && !report(searched)) s.cancelled = true;
+    }
+    if (splits > 0) log_i("mfkey: %u chunk pairs split", splits);
+    free(odd);
+    free(even);
+
+    if (s.overflow) log_e("mfkey: search table overflow");
+    if (!s.found) return false;
+    for (int i = 0; i < 6; i++) key[i] = s.key >> (40 - 8 * i);
+    return true;
+}
+
+bool mfkeyParseLine(const String &line, MfkeyNonces &n) {
+    n = {};
+    n.keyType = MIFARE_KEY_A;
+    uint8_t fields = 0; // bit per nonce, cuid nt0 nr0 ar0 nt1 nr1 ar1 at
+    const char *names[] = {"cuid", "nt0", "nr0", "ar0", "nt1", "nr1", "ar1", "at", "nt", "nr", "ar"};
+    uint32_t *values[] = {
+        &n.uid, &n.nt0, &n.nr0, &n.ar0, &n.nt1, &n.nr1, &n.ar1, &n.at, &n.nt0, &n.nr0, &n.ar0
+    };
+
+    int start = 0;
+    String name = "";
+    while (start < (int)line.length()) {
+        int end = line.indexOf(' ', start);
+        if (end < 0) end = line.length();
+        String token = line.substring(start, end);
+        start = end + 1;
+        token.trim();
+        if (token.isEmpty()) continue;
+        if (name.isEmpty()) {
+            name = token;
+            continue;
+        }
+
+        if (name.equalsIgnoreCase("sec")) {
+            n.sector = token.toInt();
+        } else if (name.equalsIgnoreCase("key")) {
+            n.keyType = toupper(token[0]) == 'B' ? MIFARE_KEY_B : MIFARE_KEY_A;
+        }
+        for (int i = 0; i < 11; i++) {
+            if (!name.equalsIgnoreCase(names[i])) continue;
+            *values[i] = strtoul(token.c_str(), nullptr, 16);
+            fields |= 1 << (i < 8 ? i : i - 7);
+        }
+        name = "";
+    }
+
+    n.mfkey64 = (fields & 0x80) != 0;
+    return n.mfkey64 ? (fields & 0x8f) == 0x8f : (fields & 0x7f) == 0x7f;
+}
+
+MfkeyTask::~MfkeyTask() {
+    cancel();
+    while (!finished) vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+bool MfkeyTask::start(const std::vector<MfkeyNonces> &nonces) {
+    if (!finished || nonces.empty()) return false;
+    jobs = nonces;
+    done.clear();
+    job = 0;
+    permille = 0;
+    cancelled = false;
+    finished = false;
+    if (xTaskCreate(taskMain, "mfkey", 6144, this, 1, NULL) != pdPASS) {
+        finished = true;
+        return false;
+    }
+    return true;
+}
+
+void MfkeyTask::taskMain(void *arg) {
+    MfkeyTask *self = (MfkeyTask *)arg;
+    for (size_t i = 0; i < self->jobs.size() && !self->cancelled; i++) {
+        self->job = i;
+        self->permille = 0;
+        MfkeyResult result = {};
+        result.nonces = self->jobs[i];
+        unsigned long start = millis();
+        result.found = mfkeyRecover(result.nonces, result.key, [self](uint16_t permille) {
+            self->permille = permille;
+            return !self->cancelled;
+        });
+        result.elapsedMs = millis() - start;
+        log_d(
+            "mfkey: sector %u key %c %s in %lu ms",
+            result.nonces.sector,
+            result.nonces.keyType == MIFARE_KEY_A ? 'A' : 'B',
+            result.found ? "recovered" : "not found",
+            (unsigned long)result.elapsedMs
+        );
+        if (!self->cancelled) self->done.push_back(result);
+    }
+    self->finished = true;
+    vTaskDelete(NULL);
+}
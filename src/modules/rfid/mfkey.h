@@ -0,0 +1,74 @@
+/**
+ * @file mfkey.h
+ * @brief Mifare Classic key recovery from sniffed authentications (mfkey32v2 and mfkey64)
+ */
+
+#ifndef __MFKEY_H__
+#define __MFKEY_H__
+
+#include "MifareKeyStore.h"
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+#define MFKEY_MAX_CHUNKS 512     // split of each LFSR half search table, the smallest needs ~12kB
+#define MFKEY_TABLE_SLACK 1024   // entries above the expected table size, tables grow while extended
+#define MFKEY_HEAP_RESERVE 49152 // internal heap left to the system on boards without PSRAM
+
+struct MfkeyNonces {
+    uint32_t uid;
+    uint32_t nt0, nr0, ar0; // nr and ar as sniffed, encrypted
+    uint32_t nt1, nr1, ar1; // mfkey32v2: a second authentication to the same sector
+    uint32_t at;            // mfkey64: encrypted tag answer of the single authentication
+    bool mfkey64;
+    uint8_t sector;
+    MifareKeyType keyType;
+};
+
+struct MfkeyResult {
+    MfkeyNonces nonces;
+    bool found;
+    uint8_t key[6];
+    uint32_t elapsedMs;
+};
+
+// Parses "Sec 1 key A cuid .. nt0 .. nr0 .. ar0 .. nt1 .. nr1 .. ar1 .." (mfkey32v2)
+// or "Sec 1 key A cuid .. nt .. nr .. ar .. at .." (mfkey64), values in hex
+bool mfkeyParseLine(const String &line, MfkeyNonces &n);
+
+// Blocking recovery, onProgress gets permille and cancels by returning false
+bool mfkeyRecover(const MfkeyNonces &n, uint8_t *key, std::function<bool(uint16_t)> onProgress = nullptr);
+
+/*
+ * Runs the recoveries one after the other on a background task. The Crypto1
+ * state search is split in chunks sized to the free PSRAM, or to the internal
+ * heap, and every candidate state is checked against the nonces as soon as it
+ * is found instead of being stored.
+ */
+class MfkeyTask {
+public:
+    ~MfkeyTask();
+
+    bool start(const std::vector<MfkeyNonces> &nonces);
+    void cancel() { cancelled = true; }
+
+    bool running() const { return !finished; }
+    size_t current() const { return job; }
+    size_t size() const { return jobs.size(); }
+    uint16_t progress() const { return permille; } // of the current job
+
+    // Only valid once the task is not running
+    const std::vector<MfkeyResult> &results() const { return done; }
+
+private:
+    std::vector<MfkeyNonces> jobs;
+    std::vector<MfkeyResult> done;
+    volatile size_t job = 0;
+    volatile uint16_t permille = 0;
+    volatile bool cancelled = false;
+    volatile bool finished = true;
+
+    static void taskMain(void *arg);
+};
+
+#endif
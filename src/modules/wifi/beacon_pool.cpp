@@ -0,0 +1,180 @@
+#include "beacon_pool.h"
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <esp_wifi.h>
+
+#define BEACON_SEQ_CTL 22
+#define BEACON_TIMESTAMP 24
+#define BEACON_SSID_TAG 36
+
+static const uint8_t beaconChannels[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t beaconHeader[BEACON_SSID_TAG] = {
+    0x80, 0x00, 0x00, 0x00,             // Type/Subtype: management beacon frame, duration
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // Destination: broadcast
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, // Source
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, // BSSID
+    0x00, 0x00,                         // Fragment & sequence number, patched per transmit
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Timestamp, patched per transmit
+    0xe8, 0x03,                                     // Interval: 0xe8, 0x03 => every 1s
+    0x31, 0x00                                      // Capabilities: ESS, privacy, short preamble
+};
+
+static const uint8_t beaconRates[] = {
+    0x01, 0x08,                                    // Tag: Supported Rates, Tag length: 8
+    0x82, 0x84, 0x8b, 0x96, 0x24, 0x30, 0x48, 0x6c // 1(B) 2(B) 5.5(B) 11(B) 18 24 36 54
+};
+
+static const uint8_t beaconRsn[] = {
+    0x30, 0x18,             // Tag: RSN information, Tag length: 24
+    0x01, 0x00,             // Version
+    0x00, 0x0f, 0xac, 0x02, // Group cipher: TKIP
+    0x02, 0x00,             // Pairwise cipher count
+    0x00, 0x0f, 0xac, 0x04, // CCMP, WPA2 with TKIP only is not supported by many devices
+    0x00, 0x0f, 0xac, 0x04, // CCMP
+    0x01, 0x00,             // AKM count
+    0x00, 0x0f, 0xac, 0x02, // PSK
+    0x00, 0x00              // RSN capabilities
+};
+
+BeaconPool::BeaconPool() {
+    frames = (uint8_t *)heap_caps_malloc(
+        BEACON_POOL_MAX_FRAMES * BEACON_FRAME_MAX_LEN, MALLOC_CAP_DMA | MALLOC_CAP_8BIT
+    );
+}
+
+BeaconPool::~BeaconPool() {
+    stop();
+    if (frames != nullptr) heap_caps_free(frames);
+}
+
+/*********************************************************************
+**  Function: build
+**  Lays out every frame once: random locally administered BSSID, the
+**  SSID at its real length and the current channel
+**********************************************************************/
+size_t BeaconPool::build(const char *list) {
+    count = 0;
+    next = 0;
+    passes = 0;
+    if (frames == nullptr || list == nullptr) return 0;
+
+    const char *p = list;
+    while (*p != '\0' && count < BEACON_POOL_MAX_FRAMES) {
+        const char *end = strchr(p, '\n');
+        if (end == nullptr) end = p + strlen(p);
+        size_t ssidLen = min((size_t)(end - p), (size_t)32);
+
+        if (ssidLen > 0) {
+            uint8_t *f = frames + count * BEACON_FRAME_MAX_LEN;
+            uint8_t *w = f;
+            memcpy(w, beaconHeader, sizeof(beaconHeader));
+            esp_fill_random(w + 10, 6);
+            w[10] = (w[10] & 0xFC) | 0x02;
+            memcpy(w + 16, w + 10, 6);
+            w += sizeof(beaconHeader);
+
+            *w++ = 0x00; // Tag: SSID
+            *w++ = ssidLen;
+            memcpy(w, p, ssidLen);
+            w += ssidLen;
+
+            memcpy(w, beaconRates, sizeof(beaconRates));
+            w += sizeof(beaconRates);
+
+            *w++ = 0x03; // Tag: DS parameter set
+            *w++ = 0x01;
+            slots[count].channelAt = w - f;
+            *w++ = channel;
+
+            memcpy(w, beaconRsn, sizeof(beaconRsn));
+            w += sizeof(beaconRsn);
+            slots[count].len = w - f;
+            count++;
+        }
+        p = *end == '\n' ? end + 1 : end;
+    }
+    if (*p != '\0') log_w("Beacon pool full, SSIDs past %d are left out", BEACON_POOL_MAX_FRAMES);
+    return count;
+}
+
+void BeaconPool::onTimer(void *arg) {
+    BeaconPool *pool = (BeaconPool *)arg;
+    xTaskNotifyGive(pool->txTask);
+}
+
+bool BeaconPool::start(uint32_t intervalUs) {
+    if (count == 0 || timer != nullptr) return false;
+    txTask = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    esp_timer_create_args_t args = {};
+    args.callback = onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "beaconTx";
+    args.skip_unhandled_events = true;
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        timer = nullptr;
+        return false;
+    }
+
+    channelIdx = 0;
+    channelSweeps = 0;
+    setChannel(beaconChannels[0]);
+    sent = 0;
+    startUs = esp_timer_get_time();
+    esp_timer_start_periodic(timer, intervalUs);
+    return true;
+}
+
+void BeaconPool::setChannel(uint8_t ch) {
+    channel = ch;
+    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+    for (size_t i = 0; i < count; i++) frames[i * BEACON_FRAME_MAX_LEN + slots[i].channelAt] = channel;
+}
+
+uint32_t BeaconPool::pump(uint32_t waitMs) {
+    if (timer == nullptr) return 0;
+    uint32_t due = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+    if (due > BEACON_TX_MAX_BURST) due = BEACON_TX_MAX_BURST;
+
+    for (uint32_t i = 0; i < due; i++) {
+        uint8_t *f = frames + next * BEACON_FRAME_MAX_LEN;
+        uint16_t seqCtl = seq++ << 4;
+        f[BEACON_SEQ_CTL] = seqCtl & 0xFF;
+        f[BEACON_SEQ_CTL + 1] = seqCtl >> 8;
+        uint64_t ts = esp_timer_get_time() - startUs;
+        memcpy(f + BEACON_TIMESTAMP, &ts, 8); // little endian, as on the air
+        esp_wifi_80211_tx(WIFI_IF_STA, f, slots[next].len, false);
+        sent++;
+
+        if (++next < count) continue;
+        next = 0;
+        if (++passes < BEACON_PASSES_PER_CHANNEL) continue;
+        passes = 0;
+        if (++channelIdx == sizeof(beaconChannels)) {
+            channelIdx = 0;
+            channelSweeps++;
+        }
+        setChannel(beaconChannels[channelIdx]);
+    }
+    return due;
+}
+
+void BeaconPool::stop() {
+    if (timer == nullptr) return;
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    timer = nullptr;
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    unsigned long elapsed = max((esp_timer_get_time() - startUs) / 1000, (int64_t)1);
+    log_d(
+        "Beacon spam: %lu frames from a pool of %u in %lu ms (%.1f/s)",
+        (unsigned long)sent,
+        count,
+        elapsed,
+        sent * 1000.0 / elapsed
+    );
+}
@@ -0,0 +1,63 @@
+#ifndef __BEACON_POOL_H__
+#define __BEACON_POOL_H__
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+#define BEACON_POOL_MAX_FRAMES 128
+#define BEACON_FRAME_MAX_LEN 109    // header + 32 byte SSID + rates + DS + RSN
+#define BEACON_TX_INTERVAL_US 1000  // pacing timer period, one frame per tick
+#define BEACON_TX_MAX_BURST 8       // ticks caught up at once after the task was held back
+#define BEACON_PASSES_PER_CHANNEL 3 // every frame goes out this many times before hopping
+#define BEACON_RANDOM_SSIDS 32      // pool size of the random SSID mode
+
+/*
+ * Complete beacon frames built once when the attack starts, only the sequence
+ * control and timestamp are patched per transmit and the DS channel on each hop.
+ * Frames live in DMA capable memory and are paced by an esp_timer (hardware timer
+ * backed) that wakes the sending task.
+ */
+class BeaconPool {
+public:
+    BeaconPool();
+    ~BeaconPool();
+
+    // One frame per newline separated SSID, returns how many fit in the pool
+    size_t build(const char *list);
+
+    bool start(uint32_t intervalUs = BEACON_TX_INTERVAL_US);
+
+    // Sends the frames that are due, waiting at most waitMs for the next tick
+    uint32_t pump(uint32_t waitMs);
+
+    void stop();
+
+    size_t size() const { return count; }
+    uint32_t sweeps() const { return channelSweeps; } // full channel rotations so far
+
+private:
+    struct Slot {
+        uint8_t len;
+        uint8_t channelAt;
+    };
+
+    uint8_t *frames = nullptr;
+    Slot slots[BEACON_POOL_MAX_FRAMES];
+    size_t count = 0;
+    size_t next = 0;
+    uint16_t seq = 0;
+    uint8_t passes = 0;
+    uint8_t channelIdx = 0;
+    uint8_t channel = 1;
+    uint32_t channelSweeps = 0;
+
+    esp_timer_handle_t timer = nullptr;
+    TaskHandle_t txTask = nullptr;
+    uint32_t sent = 0;
+    int64_t startUs = 0;
+
+    static void onTimer(void *arg);
+    void setChannel(uint8_t ch);
+};
+
+#endif
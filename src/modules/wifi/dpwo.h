@@ -1,9 +1,20 @@
 #include "core/display.h"
+#include "wpa_handshake.h"
+#include <vector>
 
-void parse_BSSID(char *bssid_without_colon, const char *bssid);
+#define DPWO_ASSOC_TIMEOUT_MS 8000 // upper bound, the connection events usually end it much earlier
+
+struct DpwoTarget {
+    String ssid;
+    uint8_t bssid[6];
+    int32_t channel = 0;
+    std::vector<String> candidates;
+    WpaHandshake *handshake = nullptr; // from the sniffer captures, when available
+    volatile int found = -1;           // index of the candidate matching the handshake
+};
 
-void net_ap(int i);
+void parse_BSSID(char *bssid_without_colon, const char *bssid);
 
-void claro_ap(int i);
+std::vector<String> dpwo_candidates(const String &ssid, const String &bssidStr);
 
 void dpwo_setup();
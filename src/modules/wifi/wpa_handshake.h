@@ -0,0 +1,27 @@
+#ifndef __WPA_HANDSHAKE_H__
+#define __WPA_HANDSHAKE_H__
+
+#include <Arduino.h>
+#include <FS.h>
+
+#define WPA_EAPOL_MAX_LEN 256
+
+// Messages 1 and 2 of a WPA/WPA2-PSK 4-way handshake, enough to check a passphrase offline
+struct WpaHandshake {
+    uint8_t ap[6];
+    uint8_t sta[6];
+    uint8_t anonce[32];
+    uint8_t snonce[32];
+    uint8_t mic[16];
+    uint8_t keyVersion; // 1: HMAC-MD5, 2: HMAC-SHA1, 3 (AES-CMAC) is not supported
+    uint16_t eapolLen;
+    uint8_t eapol[WPA_EAPOL_MAX_LEN]; // message 2 with its MIC field zeroed
+};
+
+// Reads the first matching M1/M2 pair for the AP from a handshake pcap saved by the sniffer
+bool wpaLoadHandshake(FS &fs, const String &path, const uint8_t *bssid, WpaHandshake &hs);
+
+// PBKDF2-SHA1 (4096 rounds), PTK and MIC check, mbedtls uses the SHA accelerator when available
+bool wpaCheckPassphrase(const WpaHandshake &hs, const String &ssid, const String &passphrase);
+
+#endif
@@ -0,0 +1,104 @@
+// Host check of the USB mass storage sector cache against a RAM disk: pio test -e native
+#include <core/mscSectorCache.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+
+#define SEC_SIZE 512
+#define DISK_SECTORS 4096 // 2 MB
+#define HOST_CHUNK 8      // sectors per request, TinyUSB hands over 4 KB
+
+static uint8_t disk[DISK_SECTORS * SEC_SIZE];  // what is on the card
+static uint8_t model[DISK_SECTORS * SEC_SIZE]; // what the host wrote last
+static uint32_t diskReads = 0;
+static uint32_t diskWrites = 0;
+
+static bool ramRead(uint8_t *buffer, uint32_t lba, uint32_t count) {
+    if (lba + count > DISK_SECTORS) return false;
+    memcpy(buffer, disk + lba * SEC_SIZE, count * SEC_SIZE);
+    diskReads++;
+    return true;
+}
+
+static bool ramWrite(const uint8_t *buffer, uint32_t lba, uint32_t count) {
+    if (lba + count > DISK_SECTORS) return false;
+    memcpy(disk + lba * SEC_SIZE, buffer, count * SEC_SIZE);
+    diskWrites++;
+    return true;
+}
+
+static MscSectorCache cache(ramRead, ramWrite);
+static uint8_t pattern = 0;
+
+static void hostWrite(uint32_t lba, uint32_t count) {
+    uint8_t buffer[MSC_WRITE_SECTORS * 2 * SEC_SIZE];
+    for (uint32_t i = 0; i < count * SEC_SIZE; i++) buffer[i] = pattern + i * 7;
+    pattern++;
+    TEST_ASSERT_TRUE(cache.write(lba, buffer, count));
+    memcpy(model + lba * SEC_SIZE, buffer, count * SEC_SIZE);
+}
+
+static void hostRead(uint32_t lba, uint32_t count) {
+    uint8_t buffer[MSC_WRITE_SECTORS * 2 * SEC_SIZE];
+    TEST_ASSERT_TRUE(cache.read(lba, buffer, count));
+    TEST_ASSERT_EQUAL_MEMORY(model + lba * SEC_SIZE, buffer, count * SEC_SIZE);
+}
+
+void setUp() {
+    for (uint32_t i = 0; i < sizeof(disk); i++) disk[i] = i * 31;
+    memcpy(model, disk, sizeof(disk));
+    diskReads = 0;
+    diskWrites = 0;
+    TEST_ASSERT_TRUE(cache.begin(SEC_SIZE, DISK_SECTORS));
+}
+
+void tearDown() { cache.end(); }
+
+// the read-ahead window started at 96 reaches the sectors still in the write buffer
+void test_read_ahead_over_pending_writes() {
+    hostRead(92, 4);
+    hostWrite(100, 4);
+    hostRead(96, 4);
+    hostRead(100, 4);
+}
+
+void test_random_patterns() {
+    srand(1234);
+    uint32_t next = 0;
+    for (int op = 0; op < 20000; op++) {
+        uint32_t count = 1 + rand() % (MSC_WRITE_SECTORS * 2);
+        // half the requests continue the previous one, so both buffers fill and get cut short
+        uint32_t lba = rand() % 2 ? next : rand() % DISK_SECTORS;
+        if (lba + count > DISK_SECTORS) lba = DISK_SECTORS - count;
+        if (rand() % 4 == 0) hostWrite(lba, count);
+        else hostRead(lba, count);
+        next = lba + count;
+    }
+    TEST_ASSERT_TRUE(cache.flush());
+    TEST_ASSERT_EQUAL_MEMORY(model, disk, sizeof(disk));
+}
+
+void test_sequential_patterns() {
+    for (uint32_t lba = 0; lba < DISK_SECTORS; lba += HOST_CHUNK) hostWrite(lba, HOST_CHUNK);
+    TEST_ASSERT_TRUE(cache.flush());
+    uint32_t writesPerMb = diskWrites * (1024 * 1024 / SEC_SIZE) / DISK_SECTORS;
+
+    for (uint32_t lba = 0; lba < DISK_SECTORS; lba += HOST_CHUNK) hostRead(lba, HOST_CHUNK);
+    uint32_t readsPerMb = diskReads * (1024 * 1024 / SEC_SIZE) / DISK_SECTORS;
+
+    TEST_ASSERT_EQUAL_MEMORY(model, disk, sizeof(disk));
+    TEST_MESSAGE(("card writes/MB: " + std::to_string(writesPerMb)).c_str());
+    TEST_MESSAGE(("card reads/MB: " + std::to_string(readsPerMb)).c_str());
+    // one command per full buffer instead of one per sector
+    TEST_ASSERT_LESS_OR_EQUAL(1024 * 1024 / SEC_SIZE / MSC_WRITE_SECTORS, writesPerMb);
+    TEST_ASSERT_LESS_OR_EQUAL(1024 * 1024 / SEC_SIZE / MSC_CACHE_SECTORS + 1, readsPerMb);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_read_ahead_over_pending_writes);
+    RUN_TEST(test_random_patterns);
+    RUN_TEST(test_sequential_patterns);
+    return UNITY_END();
+}